@@ -7,9 +7,20 @@
 #include "pin.H"
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include "ScopeFilter.h"
+#include "SelfProf.h"
+#include "Attach.h"
+#include "ProfileFormats.h"
 using std::cerr;
 using std::string;
 using std::endl;
+using std::vector;
+using std::map;
 /* ================================================================== */
 // Global variables 
 /* ================================================================== */
@@ -18,6 +29,87 @@ PIN_LOCK lock;
 UINT64 bblCount = 0;        //number of dynamically executed basic blocks
 
 std::ostream * out = &cerr;
+UINT32 profCountBbl, profCoverBbl, profBbl, profTaken, profCall, profTrace;   // kinds of the -selfprof report
+
+// -coverage: a basic block of an image, as the first trace holding it found it.
+struct COVER_BLOCK
+{
+    UINT32  offset;         // start, from the low address of the image
+    UINT32  firstLine;      // its source lines, in sourceLines
+    UINT32  numLines;
+};
+
+// A source line, for -coverage, -afdo and -lcov.
+struct SOURCE_LINE
+{
+    UINT32  file;           // index in sourceFiles
+    UINT32  line;           // 0 if unknown
+};
+
+// -coverage: an image and the basic blocks of it that ran. Images are kept
+// after they are unloaded; analysis calls point into their bitmaps.
+struct COVER_IMAGE
+{
+    string              name;
+    ADDRINT             low;
+    ADDRINT             high;
+    UINT32              id;         // IMG_Id()
+    BOOL                loaded;
+    BOOL                written;    // its .cov file is out
+    vector<UINT8>       ran;        // bit i set: a block starting at low + i ran
+    vector<UINT8>       seen;       // bit i set: that block is in blocks
+    vector<COVER_BLOCK> blocks;
+};
+
+vector<COVER_IMAGE *> coverImages;          // every image, in load order
+vector<SOURCE_LINE> sourceLines;          // lines of the blocks, a run per block
+vector<string> sourceFiles;
+map<string, UINT32> sourceFileIds;
+map<string, UINT32> coverNames;             // .cov file names used so far
+
+#define NO_FUNCTION 0xffffffff
+
+// -afdo, -lcov: a function, as its first block found it.
+struct PROFILE_FUNCTION
+{
+    string      name;       // mangled
+    SOURCE_LINE start;      // line of its first instruction, standing for its declaration line; 0 if unknown
+};
+
+// -afdo, -lcov: a basic block, by the address it starts at, and how often
+// it ran. The same block in several traces has one entry.
+struct PROFILE_BLOCK
+{
+    UINT64                  count;      // times it ran
+    UINT64                  taken;      // times the conditional branch ending it was taken
+    UINT32                  function;   // in profileFunctions, NO_FUNCTION if none
+    BOOL                    entry;      // it starts the function
+    ADDRINT                 end;        // address past its last instruction
+    ADDRINT                 branch;     // conditional branch ending it, 0 if none
+    SOURCE_LINE             branchLine;
+    ADDRINT                 call;       // call ending it, 0 if none
+    SOURCE_LINE             callLine;
+    string                  callee;     // direct call: the function called
+    map<ADDRINT, UINT64>    targets;    // indirect call: calls by target, under profileLock
+};
+
+map<ADDRINT, PROFILE_BLOCK *> profileBlocks;
+map<ADDRINT, SOURCE_LINE> profileLines;     // source line of every instruction of the blocks
+vector<PROFILE_FUNCTION> profileFunctions;
+map<string, UINT32> profileFunctionIds;
+PIN_LOCK profileLock;
+
+// -coverage file header, followed by the path of the image and the bitmap
+// of the blocks that ran: bit i (byte i / 8, bit i % 8) stands for the
+// block starting i bytes above the low address of the image.
+struct BBCOV_HEADER
+{
+    char    magic[8];       // "BBCOV1"
+    UINT64  size;           // bytes from the low to the high address of the image
+    UINT64  blocks;         // bits set
+    UINT32  pathLength;     // bytes of the path, without a NUL
+    UINT32  reserved;
+};
 
 /* ===================================================================== */
 // Command line switches
@@ -28,6 +120,19 @@ KNOB<string> KnobOutputFile(KNOB_MODE_WRITEONCE,  "pintool",
 KNOB<BOOL>   KnobCount(KNOB_MODE_WRITEONCE,  "pintool",
     "count", "1", "count instructions, basic blocks and threads in the application");
 
+KNOB<string> KnobAfdo(KNOB_MODE_WRITEONCE,  "pintool",
+    "afdo", "", "write exact per-line and call counts as an AFDO text sample profile to this file");
+
+KNOB<string> KnobLcov(KNOB_MODE_WRITEONCE,  "pintool",
+    "lcov", "", "write exact per-line, per-branch and per-function counts as an lcov trace file to this file");
+
+KNOB<BOOL>   KnobMerge(KNOB_MODE_WRITEONCE,  "pintool",
+    "merge", "0", "add the counts of the -afdo and -lcov files of earlier runs instead of replacing them");
+
+KNOB<string> KnobCoverage(KNOB_MODE_WRITEONCE,  "pintool",
+    "coverage", "", "record which basic blocks ran instead of counting them, into <prefix>.<image>.cov "
+    "and the lcov file <prefix>.info; %p in the prefix is the process id");
+
 
 /* ===================================================================== */
 // Utilities
@@ -58,11 +163,75 @@ INT32 Usage()
  */
 VOID CountBbl(UINT32 numInstInBbl, THREADID threadid)
 {
+    SELFPROF_CALL_SCOPE(profCountBbl);
     PIN_GetLock(&lock, threadid);
     bblCount++;
     PIN_ReleaseLock(&lock);
 }
 
+/*!
+ * -afdo, -lcov: count one run of a basic block.
+ * @param[in]   count   counter of the block
+ */
+VOID ProfileBbl(UINT64 * count)
+{
+    __sync_fetch_and_add(count, 1);
+}
+
+/*!
+ * -afdo, -lcov: count one taken conditional branch.
+ * @param[in]   taken   counter of the block the branch ends
+ */
+VOID ProfileTaken(UINT64 * taken)
+{
+    __sync_fetch_and_add(taken, 1);
+}
+
+/*!
+ * ProfileBbl() and ProfileTaken() under -selfprof. The plain ones stay inlinable.
+ */
+VOID ProfileBblProf(UINT64 * count)
+{
+    SELFPROF_CALL_SCOPE(profBbl);
+    ProfileBbl(count);
+}
+
+VOID ProfileTakenProf(UINT64 * taken)
+{
+    SELFPROF_CALL_SCOPE(profTaken);
+    ProfileTaken(taken);
+}
+
+/*!
+ * -afdo, -lcov: count an indirect call by its target.
+ * @param[in]   block   block the call ends
+ * @param[in]   target  function called
+ */
+VOID ProfileCall(PROFILE_BLOCK * block, ADDRINT target, THREADID threadid)
+{
+    SELFPROF_CALL_SCOPE(profCall);
+    PIN_GetLock(&profileLock, threadid+1);
+    block->targets[target]++;
+    PIN_ReleaseLock(&profileLock);
+}
+
+/*!
+ * -coverage: mark a basic block as run, the first time it runs, and drop
+ * its instrumentation, so that it runs clean from then on.
+ * @param[in]   byte    byte of the bitmap that holds the block
+ * @param[in]   mask    bit of the block in that byte
+ * @param[in]   start   first byte of the block
+ * @param[in]   end     last byte of the block
+ */
+VOID CoverBbl(UINT8 * byte, UINT32 mask, ADDRINT start, ADDRINT end)
+{
+    SELFPROF_CALL_SCOPE(profCoverBbl);
+
+    // Threads may run the block before it is gone; the first one removes it.
+    if (__sync_fetch_and_or(byte, (UINT8)mask) & mask) { return; }
+    PIN_RemoveInstrumentationInRange(start, end);
+}
+
 /* ===================================================================== */
 // Instrumentation callbacks
 /* ===================================================================== */
@@ -77,6 +246,11 @@ VOID CountBbl(UINT32 numInstInBbl, THREADID threadid)
  */
 VOID Trace(TRACE trace, VOID *v)
 {
+    SELFPROF_INSTRUMENT_SCOPE(profTrace);
+
+    // Code outside -include_img, -exclude_img and -rtn runs without counting.
+    if (!ScopeTrace(trace)) { return; }
+
     // Visit every basic block in the trace
     for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl))
     {
@@ -86,6 +260,442 @@ VOID Trace(TRACE trace, VOID *v)
 }
 
 
+/*!
+ * -coverage: start the bitmaps of a newly loaded image.
+ */
+VOID CoverImageLoad(IMG img, VOID *v)
+{
+    COVER_IMAGE * image = new COVER_IMAGE();
+
+    image->name = IMG_Name(img);
+    image->low = IMG_LowAddress(img);
+    image->high = IMG_HighAddress(img);
+    image->id = IMG_Id(img);
+    image->loaded = true;
+    image->written = false;
+    image->ran.resize((image->high - image->low) / 8 + 1);
+    image->seen.resize(image->ran.size());
+    coverImages.push_back(image);
+}
+
+/*!
+ * @return the loaded image holding an address, NULL if none
+ */
+COVER_IMAGE * CoverFind(ADDRINT addr)
+{
+    for (size_t i = 0; i < coverImages.size(); i++)
+    {
+        COVER_IMAGE * image = coverImages[i];
+        if (image->loaded && image->low <= addr && addr <= image->high) { return image; }
+    }
+    return 0;
+}
+
+/*!
+ * @return the source line of an address; line 0 if it has none
+ */
+SOURCE_LINE SourceLine(ADDRINT addr)
+{
+    INT32 column = 0, line = 0;
+    string file;
+    PIN_GetSourceLocation(addr, &column, &line, &file);
+
+    SOURCE_LINE source = { 0, 0 };
+    if (file.empty() || line <= 0) { return source; }
+
+    map<string, UINT32>::iterator it = sourceFileIds.find(file);
+    if (it == sourceFileIds.end())
+    {
+        it = sourceFileIds.insert(std::make_pair(file, (UINT32)sourceFiles.size())).first;
+        sourceFiles.push_back(file);
+    }
+    source.file = it->second;
+    source.line = line;
+    return source;
+}
+
+/*!
+ * Append the source lines of a basic block to sourceLines.
+ * @param[out]  numLines    how many were appended
+ * @return index of the first one
+ */
+UINT32 SourceLines(BBL bbl, UINT32 * numLines)
+{
+    UINT32 first = sourceLines.size();
+
+    *numLines = 0;
+    for (INS ins = BBL_InsHead(bbl); INS_Valid(ins); ins = INS_Next(ins))
+    {
+        SOURCE_LINE source = SourceLine(INS_Address(ins));
+        if (source.line == 0) { continue; }
+
+        // Consecutive instructions mostly share a line.
+        if (*numLines != 0 && sourceLines.back().file == source.file && sourceLines.back().line == source.line)
+        {
+            continue;
+        }
+        sourceLines.push_back(source);
+        (*numLines)++;
+    }
+    return first;
+}
+
+/*!
+ * -coverage: remember a basic block and its source lines, for the lcov file.
+ */
+VOID CoverLines(COVER_IMAGE * image, BBL bbl, UINT32 offset)
+{
+    COVER_BLOCK block = { offset, 0, 0 };
+    block.firstLine = SourceLines(bbl, &block.numLines);
+    image->blocks.push_back(block);
+}
+
+/*!
+ * -coverage: insert a call to CoverBbl() before every basic block of the
+ * trace that has not run yet. Blocks that ran get no instrumentation.
+ */
+VOID CoverTrace(TRACE trace, VOID *v)
+{
+    SELFPROF_INSTRUMENT_SCOPE(profTrace);
+
+    if (!ScopeTrace(trace)) { return; }
+
+    for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl))
+    {
+        ADDRINT addr = BBL_Address(bbl);
+        COVER_IMAGE * image = CoverFind(addr);
+        if (image == 0) { continue; }
+
+        UINT32 offset = addr - image->low;
+        UINT8 mask = 1 << (offset & 7);
+        if (!(image->seen[offset / 8] & mask))
+        {
+            image->seen[offset / 8] |= mask;
+            CoverLines(image, bbl, offset);
+        }
+        if (image->ran[offset / 8] & mask) { continue; }
+
+        BBL_InsertCall(bbl, IPOINT_BEFORE, (AFUNPTR)CoverBbl, IARG_PTR, &image->ran[offset / 8],
+                       IARG_UINT32, (UINT32)mask, IARG_ADDRINT, addr,
+                       IARG_ADDRINT, addr + BBL_Size(bbl) - 1, IARG_END);
+    }
+}
+
+/*!
+ * The AFDO line offsets of a function are counted from the line of its
+ * first instruction: Pin has no DW_AT_decl_line, which clang counts them
+ * from (see ProfileFormats.h).
+ * @return the entry of a routine in profileFunctions, NO_FUNCTION if none
+ */
+UINT32 ProfileFunction(RTN rtn)
+{
+    if (!RTN_Valid(rtn)) { return NO_FUNCTION; }
+
+    map<string, UINT32>::iterator it = profileFunctionIds.find(RTN_Name(rtn));
+    if (it != profileFunctionIds.end()) { return it->second; }
+
+    PROFILE_FUNCTION function = { RTN_Name(rtn), SourceLine(RTN_Address(rtn)) };
+    profileFunctions.push_back(function);
+    profileFunctionIds[function.name] = profileFunctions.size() - 1;
+    return profileFunctions.size() - 1;
+}
+
+/*!
+ * -afdo, -lcov: the entry of a basic block seen for the first time.
+ */
+PROFILE_BLOCK * ProfileNewBlock(BBL bbl)
+{
+    PROFILE_BLOCK * block = new PROFILE_BLOCK();
+    ADDRINT addr = BBL_Address(bbl);
+    RTN rtn = RTN_FindByAddress(addr);
+    INS tail = BBL_InsTail(bbl);
+
+    block->count = block->taken = 0;
+    block->function = ProfileFunction(rtn);
+    block->entry = RTN_Valid(rtn) && RTN_Address(rtn) == addr;
+    block->end = addr + BBL_Size(bbl);
+    block->branch = block->call = 0;
+
+    // Blocks that overlap share the lines of their common instructions.
+    for (INS ins = BBL_InsHead(bbl); INS_Valid(ins); ins = INS_Next(ins))
+    {
+        if (profileLines.find(INS_Address(ins)) == profileLines.end())
+        {
+            profileLines[INS_Address(ins)] = SourceLine(INS_Address(ins));
+        }
+    }
+
+    if (INS_IsBranch(tail) && INS_HasFallThrough(tail))
+    {
+        block->branch = INS_Address(tail);
+        block->branchLine = SourceLine(block->branch);
+    }
+    if (INS_IsCall(tail))
+    {
+        block->call = INS_Address(tail);
+        block->callLine = SourceLine(block->call);
+        if (INS_IsDirectControlFlow(tail))
+        {
+            block->callee = RTN_FindNameByAddress(INS_DirectControlFlowTargetAddress(tail));
+        }
+    }
+    return block;
+}
+
+/*!
+ * -afdo, -lcov: count every basic block of the trace, the taken branches
+ * that end blocks, and the targets of indirect calls.
+ */
+VOID ProfileTrace(TRACE trace, VOID *v)
+{
+    SELFPROF_INSTRUMENT_SCOPE(profTrace);
+
+    if (!ScopeTrace(trace)) { return; }
+
+    BOOL prof = SelfProfOn();
+    for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl))
+    {
+        PROFILE_BLOCK *& block = profileBlocks[BBL_Address(bbl)];
+        if (block == 0) { block = ProfileNewBlock(bbl); }
+
+        BBL_InsertCall(bbl, IPOINT_BEFORE, prof ? (AFUNPTR)ProfileBblProf : (AFUNPTR)ProfileBbl,
+                       IARG_PTR, &block->count, IARG_END);
+
+        INS tail = BBL_InsTail(bbl);
+        if (block->branch != 0 && block->branch == INS_Address(tail))
+        {
+            INS_InsertCall(tail, IPOINT_TAKEN_BRANCH, prof ? (AFUNPTR)ProfileTakenProf : (AFUNPTR)ProfileTaken,
+                           IARG_PTR, &block->taken, IARG_END);
+        }
+        if (block->call != 0 && block->call == INS_Address(tail) && block->callee.empty())
+        {
+            INS_InsertCall(tail, IPOINT_BEFORE, (AFUNPTR)ProfileCall, IARG_PTR, block,
+                           IARG_BRANCH_TARGET_ADDR, IARG_THREAD_ID, IARG_END);
+        }
+    }
+}
+
+/*!
+ * -afdo, -lcov: turn the block counts into the counts of the profile files,
+ * add those of earlier runs with -merge, and write them.
+ * An instruction ran as often as all the blocks holding it; a line has the
+ * count of the instruction of it that ran most often, as AutoFDO reads
+ * counts. The branches of a line are numbered in address order.
+ */
+VOID ProfileWrite()
+{
+    AFDO_PROFILE afdo;
+    LCOV_PROFILE lcov;
+    map<ADDRINT, std::pair<UINT64, UINT64> > branches;     // runs and taken, by branch
+    map<ADDRINT, SOURCE_LINE> branchLines;
+    map<ADDRINT, std::pair<UINT64, UINT32> > instructions;  // runs and function, by instruction
+
+    // Names of the targets of indirect calls.
+    PIN_LockClient();
+
+    for (map<ADDRINT, PROFILE_BLOCK *>::iterator it = profileBlocks.begin(); it != profileBlocks.end(); ++it)
+    {
+        const PROFILE_BLOCK * block = it->second;
+        const PROFILE_FUNCTION * function = block->function == NO_FUNCTION ? 0 : &profileFunctions[block->function];
+        AFDO_FUNCTION * samples = function != 0 && function->start.line != 0 ? &afdo[function->name] : 0;
+
+        // A block that jumps into another one shares its tail.
+        map<ADDRINT, SOURCE_LINE>::const_iterator ins = profileLines.lower_bound(it->first);
+        for (; ins != profileLines.end() && ins->first < block->end; ++ins)
+        {
+            instructions[ins->first].first += block->count;
+            instructions[ins->first].second = block->function;
+        }
+
+        if (samples != 0 && block->entry)
+        {
+            samples->head += block->count;
+            std::pair<UINT32, UINT64> & calls = lcov[sourceFiles[function->start.file]].functions[function->name];
+            calls.first = function->start.line;
+            calls.second += block->count;
+        }
+
+        if (samples != 0 && block->call != 0 && block->callLine.line != 0
+            && block->callLine.file == function->start.file && block->callLine.line >= function->start.line)
+        {
+            map<string, UINT64> & callees = samples->calls[AFDO_KEY(block->callLine.line - function->start.line, 0)];
+            if (!block->callee.empty()) { callees[block->callee] += block->count; }
+            for (map<ADDRINT, UINT64>::const_iterator t = block->targets.begin(); t != block->targets.end(); ++t)
+            {
+                string callee = RTN_FindNameByAddress(t->first);
+                if (!callee.empty()) { callees[callee] += t->second; }
+            }
+        }
+
+        if (block->branch != 0 && block->branchLine.line != 0)
+        {
+            branches[block->branch].first += block->count;
+            branches[block->branch].second += block->taken;
+            branchLines[block->branch] = block->branchLine;
+        }
+    }
+
+    PIN_UnlockClient();
+
+    for (map<ADDRINT, std::pair<UINT64, UINT32> >::iterator it = instructions.begin(); it != instructions.end(); ++it)
+    {
+        const SOURCE_LINE & source = profileLines[it->first];
+        if (source.line == 0) { continue; }
+
+        UINT64 & count = lcov[sourceFiles[source.file]].lines[source.line];
+        count = std::max(count, it->second.first);
+
+        const PROFILE_FUNCTION * function = it->second.second == NO_FUNCTION ? 0 : &profileFunctions[it->second.second];
+        if (function != 0 && function->start.line != 0
+            && source.file == function->start.file && source.line >= function->start.line)
+        {
+            UINT64 & body = afdo[function->name].body[AFDO_KEY(source.line - function->start.line, 0)];
+            body = std::max(body, it->second.first);
+        }
+    }
+
+    // Every conditional branch is two lcov branches: taken, then not taken.
+    map<std::pair<UINT32, UINT32>, UINT32> numbers;     // branches so far by file and line
+    for (map<ADDRINT, std::pair<UINT64, UINT64> >::iterator it = branches.begin(); it != branches.end(); ++it)
+    {
+        const SOURCE_LINE & source = branchLines[it->first];
+        UINT32 & number = numbers[std::make_pair(source.file, source.line)];
+        LCOV_FILE & file = lcov[sourceFiles[source.file]];
+
+        file.branches[std::make_pair(source.line, number++)] += it->second.second;
+        file.branches[std::make_pair(source.line, number++)] += it->second.first - it->second.second;
+    }
+
+    if (!KnobAfdo.Value().empty())
+    {
+        if (KnobMerge) { AfdoRead(KnobAfdo.Value(), afdo); }
+        if (!AfdoWrite(KnobAfdo.Value(), afdo)) { cerr << "BBCountTool: cannot write " << KnobAfdo.Value() << endl; }
+    }
+    if (!KnobLcov.Value().empty())
+    {
+        if (KnobMerge) { LcovRead(KnobLcov.Value(), lcov); }
+        if (!LcovWrite(KnobLcov.Value(), lcov)) { cerr << "BBCountTool: cannot write " << KnobLcov.Value() << endl; }
+    }
+}
+
+/*!
+ * @return the -coverage prefix, with %p replaced by the process id
+ */
+string CoverPrefix()
+{
+    string prefix = KnobCoverage.Value();
+    size_t at = prefix.find("%p");
+    if (at != string::npos) { prefix.replace(at, 2, decstr(PIN_GetPid())); }
+    return prefix;
+}
+
+/*!
+ * @return how many blocks of an image ran
+ */
+UINT64 CoverCount(const COVER_IMAGE * image)
+{
+    UINT64 blocks = 0;
+    for (size_t i = 0; i < image->ran.size(); i++) { blocks += __builtin_popcount(image->ran[i]); }
+    return blocks;
+}
+
+/*!
+ * -coverage: write <prefix>.<image file name>.cov, once per image.
+ */
+VOID CoverWrite(COVER_IMAGE * image)
+{
+    if (image->written) { return; }
+    image->written = true;
+
+    // Two images of the same file name get the image id as well.
+    string base = image->name.substr(image->name.rfind('/') + 1);
+    if (coverNames[base]++ != 0) { base += "." + decstr(image->id); }
+    string fileName = CoverPrefix() + "." + base + ".cov";
+
+    BBCOV_HEADER header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "BBCOV1", 6);
+    header.size = image->high - image->low + 1;
+    header.blocks = CoverCount(image);
+    header.pathLength = image->name.size();
+
+    FILE * file = fopen(fileName.c_str(), "wb");
+    if (file == 0)
+    {
+        cerr << "BBCountTool: cannot write " << fileName << endl;
+        return;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(image->name.c_str(), 1, image->name.size(), file);
+    fwrite(&image->ran[0], 1, image->ran.size(), file);
+    fclose(file);
+}
+
+/*!
+ * -coverage: write the image's file when it is unloaded; its addresses may
+ * be reused by the next image.
+ */
+VOID CoverImageUnload(IMG img, VOID *v)
+{
+    for (size_t i = 0; i < coverImages.size(); i++)
+    {
+        if (coverImages[i]->loaded && coverImages[i]->id == IMG_Id(img))
+        {
+            coverImages[i]->loaded = false;
+            CoverWrite(coverImages[i]);
+        }
+    }
+}
+
+/*!
+ * -coverage: write <prefix>.info, the lcov trace file. Lines of blocks that
+ * were instrumented but never ran are listed with 0 hits; a line that ran
+ * has 1, as the count stops at the first run.
+ */
+VOID CoverWriteLcov()
+{
+    // Hits by file and line; a line in several blocks ran if any of them did.
+    vector<map<UINT32, UINT32> > hits(sourceFiles.size());
+
+    for (size_t i = 0; i < coverImages.size(); i++)
+    {
+        const COVER_IMAGE * image = coverImages[i];
+        for (size_t b = 0; b < image->blocks.size(); b++)
+        {
+            const COVER_BLOCK & block = image->blocks[b];
+            UINT32 ran = (image->ran[block.offset / 8] >> (block.offset & 7)) & 1;
+            for (UINT32 l = block.firstLine; l < block.firstLine + block.numLines; l++)
+            {
+                UINT32 & hit = hits[sourceLines[l].file][sourceLines[l].line];
+                hit |= ran;
+            }
+        }
+    }
+
+    string fileName = CoverPrefix() + ".info";
+    FILE * file = fopen(fileName.c_str(), "w");
+    if (file == 0)
+    {
+        cerr << "BBCountTool: cannot write " << fileName << endl;
+        return;
+    }
+    fprintf(file, "TN:\n");
+    for (size_t f = 0; f < sourceFiles.size(); f++)
+    {
+        UINT32 found = 0, hit = 0;
+
+        fprintf(file, "SF:%s\n", sourceFiles[f].c_str());
+        for (map<UINT32, UINT32>::iterator it = hits[f].begin(); it != hits[f].end(); ++it)
+        {
+            fprintf(file, "DA:%u,%u\n", it->first, it->second);
+            found++;
+            hit += it->second;
+        }
+        fprintf(file, "LF:%u\nLH:%u\nend_of_record\n", found, hit);
+    }
+    fclose(file);
+}
+
 /*!
  * Print out analysis results.
  * This function is called when the application exits.
@@ -95,7 +705,36 @@ VOID Trace(TRACE trace, VOID *v)
  */
 VOID Fini(INT32 code, VOID *v)
 {
-    *out <<  "Number of basic blocks executed: " << bblCount  << endl;
+    if (!KnobCoverage.Value().empty())
+    {
+        UINT64 covered = 0, instrumented = 0;
+        for (size_t i = 0; i < coverImages.size(); i++)
+        {
+            CoverWrite(coverImages[i]);
+            covered += CoverCount(coverImages[i]);
+            instrumented += coverImages[i]->blocks.size();
+        }
+        CoverWriteLcov();
+
+        *out << "Number of basic blocks covered: " << covered << " of " << instrumented
+             << " seen, in " << coverImages.size() << " images" << endl;
+        *out << "Coverage written to " << CoverPrefix() << ".<image>.cov and " << CoverPrefix() << ".info" << endl;
+    }
+    else
+    {
+        if (!KnobAfdo.Value().empty() || !KnobLcov.Value().empty())
+        {
+            for (map<ADDRINT, PROFILE_BLOCK *>::iterator it = profileBlocks.begin(); it != profileBlocks.end(); ++it)
+            {
+                bblCount += it->second->count;
+            }
+            ProfileWrite();
+        }
+        *out <<  "Number of basic blocks executed: " << bblCount  << endl;
+    }
+    *out << ScopeReport();
+    *out << SelfProfReport();
+    out->flush();
 }
 /*!
  * The main procedure of the tool.
@@ -106,6 +745,9 @@ VOID Fini(INT32 code, VOID *v)
  */
 int main(int argc, char *argv[])
 {
+    // Routine names for -rtn.
+    PIN_InitSymbols();
+
     // Initialize PIN library. Print help message if -h(elp) is specified
     // in the command line or the command line is invalid 
     if( PIN_Init(argc,argv) )
@@ -117,13 +759,50 @@ int main(int argc, char *argv[])
 
     if (!fileName.empty()) { out = new std::ofstream(fileName.c_str());}
 
+    if (!KnobCoverage.Value().empty() && (!KnobAfdo.Value().empty() || !KnobLcov.Value().empty()))
+    {
+        cerr << "BBCountTool: -coverage stops counting a block after its first run; use -lcov alone for counts" << endl;
+        return Usage();
+    }
+
+    ScopeInit();
+    SelfProfInit();
+    profCountBbl = SelfProfKind("CountBbl");
+    profCoverBbl = SelfProfKind("CoverBbl");
+    profBbl = SelfProfKind("ProfileBbl");
+    profTaken = SelfProfKind("ProfileTaken");
+    profCall = SelfProfKind("ProfileCall");
+    profTrace = SelfProfCallback("traces");
+
     if (KnobCount)
     {
-        // Register function to be called to instrument traces
-        TRACE_AddInstrumentFunction(Trace, 0);
+        if (!KnobCoverage.Value().empty())
+        {
+            // Blocks are instrumented until they first run, image by image.
+            IMG_AddInstrumentFunction(CoverImageLoad, 0);
+            IMG_AddUnloadFunction(CoverImageUnload, 0);
+            TRACE_AddInstrumentFunction(CoverTrace, 0);
+        }
+        else if (!KnobAfdo.Value().empty() || !KnobLcov.Value().empty())
+        {
+            // A counter per block, where Trace has one for the whole program.
+            PIN_InitLock(&profileLock);
+            TRACE_AddInstrumentFunction(ProfileTrace, 0);
+        }
+        else
+        {
+            // Register function to be called to instrument traces
+            TRACE_AddInstrumentFunction(Trace, 0);
+        }
         
         // Register function to be called when the application exits
         PIN_AddFiniFunction(Fini, 0);
+
+        if (!AttachInit(Fini))
+        {
+            cerr << "Cannot start the detach timer thread." << endl;
+            return 1;
+        }
     }
    
    /*
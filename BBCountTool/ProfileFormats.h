@@ -0,0 +1,272 @@
+/*! @file
+ *  Profile files BBCountTool writes for the compiler and for coverage
+ *  viewers, and reads back to add up several runs.
+ *
+ *  AFDO: the text sample profile of LLVM, which clang reads with
+ *  -fprofile-sample-use. One record per function:
+ *
+ *      <mangled name>:<total samples>:<samples at entry>
+ *       <line offset>[.<discriminator>]: <samples> [<callee>:<samples> ...]
+ *
+ *  where the line offset is counted from the line the function starts on.
+ *  clang counts it from the line the function is declared on (the
+ *  DW_AT_decl_line of its subprogram), which Pin does not tell; the writer
+ *  takes the line of the function's first instruction instead. The two are
+ *  the same when the prologue is on the line of the declaration, as clang
+ *  puts it, but not when the declaration spans several lines or the first
+ *  instruction comes from the body, and then the offsets are off by the
+ *  difference.
+ *
+ *  LCOV: the trace file of lcov/genhtml, with per-line (DA), per-branch
+ *  (BRDA) and per-function (FN, FNDA) execution counts.
+ *
+ *  Both readers only know what the writers here produce (no inlined call
+ *  sites in AFDO, no test names in LCOV).
+ */
+
+#ifndef PROFILE_FORMATS_H
+#define PROFILE_FORMATS_H
+
+#include "pin.H"
+#include <string>
+#include <map>
+#include <utility>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ================================================================== */
+// AFDO
+/* ================================================================== */
+
+// Key of a body line: line offset in the upper bits, discriminator below.
+#define AFDO_KEY(offset, discriminator)     (((UINT64)(offset) << 32) | (discriminator))
+
+struct AFDO_FUNCTION
+{
+    UINT64                                          head;   // samples at entry
+    std::map<UINT64, UINT64>                        body;   // samples by AFDO_KEY
+    std::map<UINT64, std::map<std::string, UINT64> > calls; // callees by AFDO_KEY
+
+    AFDO_FUNCTION() : head(0) {}
+};
+
+typedef std::map<std::string, AFDO_FUNCTION> AFDO_PROFILE;
+
+/*!
+ * Add the counts of an AFDO text profile to a profile.
+ * @return FALSE if the file cannot be read
+ */
+inline BOOL AfdoRead(const std::string & path, AFDO_PROFILE & profile)
+{
+    FILE * file = fopen(path.c_str(), "r");
+    if (file == 0) { return FALSE; }
+
+    char line[4096];
+    AFDO_FUNCTION * function = 0;
+    while (fgets(line, sizeof(line), file) != 0)
+    {
+        if (line[0] != ' ')
+        {
+            // "name:total:head"; the name itself has no ':' once mangled.
+            char * head = strrchr(line, ':');
+            if (head == 0) { function = 0; continue; }
+            *head = '\0';
+            char * total = strrchr(line, ':');
+            if (total == 0) { function = 0; continue; }
+            *total = '\0';
+            function = &profile[line];
+            function->head += strtoull(head + 1, 0, 10);
+            continue;
+        }
+
+        // Only " offset[.discriminator]: samples callee:samples ..." at depth 1.
+        if (function == 0 || line[1] == ' ') { continue; }
+
+        char * end;
+        UINT64 offset = strtoull(line + 1, &end, 10);
+        UINT64 discriminator = 0;
+        if (*end == '.') { discriminator = strtoull(end + 1, &end, 10); }
+        if (*end != ':') { continue; }
+
+        UINT64 key = AFDO_KEY(offset, discriminator);
+        function->body[key] += strtoull(end + 1, &end, 10);
+
+        for (char * callee = strtok(end, " \n"); callee != 0; callee = strtok(0, " \n"))
+        {
+            char * samples = strrchr(callee, ':');
+            if (samples == 0) { continue; }
+            *samples = '\0';
+            function->calls[key][callee] += strtoull(samples + 1, 0, 10);
+        }
+    }
+    fclose(file);
+    return TRUE;
+}
+
+/*!
+ * Write a profile as an AFDO text profile.
+ * @return FALSE if the file cannot be written
+ */
+inline BOOL AfdoWrite(const std::string & path, const AFDO_PROFILE & profile)
+{
+    FILE * file = fopen(path.c_str(), "w");
+    if (file == 0) { return FALSE; }
+
+    for (AFDO_PROFILE::const_iterator f = profile.begin(); f != profile.end(); ++f)
+    {
+        const AFDO_FUNCTION & function = f->second;
+        UINT64 total = 0;
+        for (std::map<UINT64, UINT64>::const_iterator b = function.body.begin(); b != function.body.end(); ++b)
+        {
+            total += b->second;
+        }
+        if (total == 0 && function.head == 0) { continue; }
+
+        fprintf(file, "%s:%llu:%llu\n", f->first.c_str(), (unsigned long long)total,
+                (unsigned long long)function.head);
+        for (std::map<UINT64, UINT64>::const_iterator b = function.body.begin(); b != function.body.end(); ++b)
+        {
+            UINT32 offset = b->first >> 32, discriminator = b->first & 0xffffffff;
+            if (discriminator != 0) { fprintf(file, " %u.%u: %llu", offset, discriminator, (unsigned long long)b->second); }
+            else                    { fprintf(file, " %u: %llu", offset, (unsigned long long)b->second); }
+
+            std::map<UINT64, std::map<std::string, UINT64> >::const_iterator c = function.calls.find(b->first);
+            if (c != function.calls.end())
+            {
+                for (std::map<std::string, UINT64>::const_iterator t = c->second.begin(); t != c->second.end(); ++t)
+                {
+                    if (t->second != 0) { fprintf(file, " %s:%llu", t->first.c_str(), (unsigned long long)t->second); }
+                }
+            }
+            fprintf(file, "\n");
+        }
+    }
+    fclose(file);
+    return TRUE;
+}
+
+/* ================================================================== */
+// LCOV
+/* ================================================================== */
+
+struct LCOV_FILE
+{
+    std::map<UINT32, UINT64>                            lines;      // DA: count by line
+    std::map<std::pair<UINT32, UINT32>, UINT64>         branches;   // BRDA: taken by line and branch
+    std::map<std::string, std::pair<UINT32, UINT64> >   functions;  // FN, FNDA: line and calls by name
+};
+
+typedef std::map<std::string, LCOV_FILE> LCOV_PROFILE;
+
+/*!
+ * Add the counts of an lcov trace file to a profile.
+ * @return FALSE if the file cannot be read
+ */
+inline BOOL LcovRead(const std::string & path, LCOV_PROFILE & profile)
+{
+    FILE * file = fopen(path.c_str(), "r");
+    if (file == 0) { return FALSE; }
+
+    char line[4096];
+    LCOV_FILE * source = 0;
+    while (fgets(line, sizeof(line), file) != 0)
+    {
+        line[strcspn(line, "\n")] = '\0';
+        char * value = strchr(line, ':');
+        if (value == 0) { continue; }
+        *value++ = '\0';
+
+        if (strcmp(line, "SF") == 0)
+        {
+            source = &profile[value];
+        }
+        else if (source == 0)
+        {
+            continue;
+        }
+        else if (strcmp(line, "DA") == 0)
+        {
+            unsigned int number;
+            unsigned long long count;
+            if (sscanf(value, "%u,%llu", &number, &count) == 2) { source->lines[number] += count; }
+        }
+        else if (strcmp(line, "BRDA") == 0)
+        {
+            // "-" for a branch that never ran counts as 0.
+            unsigned int number, block, branch;
+            unsigned long long taken = 0;
+            if (sscanf(value, "%u,%u,%u,%llu", &number, &block, &branch, &taken) >= 3)
+            {
+                source->branches[std::make_pair(number, branch)] += taken;
+            }
+        }
+        else if (strcmp(line, "FN") == 0)
+        {
+            char * name = strchr(value, ',');
+            if (name != 0) { source->functions[name + 1].first = atoi(value); }
+        }
+        else if (strcmp(line, "FNDA") == 0)
+        {
+            char * name = strchr(value, ',');
+            if (name != 0) { source->functions[name + 1].second += strtoull(value, 0, 10); }
+        }
+    }
+    fclose(file);
+    return TRUE;
+}
+
+/*!
+ * Write a profile as an lcov trace file.
+ * @return FALSE if the file cannot be written
+ */
+inline BOOL LcovWrite(const std::string & path, const LCOV_PROFILE & profile)
+{
+    FILE * file = fopen(path.c_str(), "w");
+    if (file == 0) { return FALSE; }
+
+    fprintf(file, "TN:\n");
+    for (LCOV_PROFILE::const_iterator s = profile.begin(); s != profile.end(); ++s)
+    {
+        const LCOV_FILE & source = s->second;
+        UINT32 found = 0, hit = 0;
+
+        fprintf(file, "SF:%s\n", s->first.c_str());
+        for (std::map<std::string, std::pair<UINT32, UINT64> >::const_iterator f = source.functions.begin();
+             f != source.functions.end(); ++f)
+        {
+            fprintf(file, "FN:%u,%s\n", f->second.first, f->first.c_str());
+        }
+        for (std::map<std::string, std::pair<UINT32, UINT64> >::const_iterator f = source.functions.begin();
+             f != source.functions.end(); ++f)
+        {
+            fprintf(file, "FNDA:%llu,%s\n", (unsigned long long)f->second.second, f->first.c_str());
+            found++;
+            if (f->second.second != 0) { hit++; }
+        }
+        fprintf(file, "FNF:%u\nFNH:%u\n", found, hit);
+
+        found = hit = 0;
+        for (std::map<std::pair<UINT32, UINT32>, UINT64>::const_iterator b = source.branches.begin();
+             b != source.branches.end(); ++b)
+        {
+            fprintf(file, "BRDA:%u,0,%u,%llu\n", b->first.first, b->first.second, (unsigned long long)b->second);
+            found++;
+            if (b->second != 0) { hit++; }
+        }
+        fprintf(file, "BRF:%u\nBRH:%u\n", found, hit);
+
+        found = hit = 0;
+        for (std::map<UINT32, UINT64>::const_iterator l = source.lines.begin(); l != source.lines.end(); ++l)
+        {
+            fprintf(file, "DA:%u,%llu\n", l->first, (unsigned long long)l->second);
+            found++;
+            if (l->second != 0) { hit++; }
+        }
+        fprintf(file, "LF:%u\nLH:%u\nend_of_record\n", found, hit);
+    }
+    fclose(file);
+    return TRUE;
+}
+
+#endif // PROFILE_FORMATS_H
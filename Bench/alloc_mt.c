@@ -0,0 +1,44 @@
+/*
+ * Allocation-heavy multithreaded program: every thread keeps a window of
+ * live blocks of mixed sizes and replaces one of them on every step, so
+ * malloc and free are called from all threads at once.
+ *
+ * usage: alloc_mt.out [threads] [allocations per thread]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define WINDOW 64
+
+static long count;
+
+void * allocate(void * arg) {
+  void * live[WINDOW] = { 0 };
+  unsigned seed = (unsigned)(long)arg;
+
+  for (long i = 0; i < count; i++) {
+    int slot = rand_r(&seed) % WINDOW;
+    free(live[slot]);
+    live[slot] = malloc(16 + rand_r(&seed) % 4096);
+  }
+  for (int i = 0; i < WINDOW; i++) {
+    free(live[i]);
+  }
+  return NULL;
+}
+
+int main (int argc, char ** argv) {
+
+  int nthreads = argc > 1 ? atoi(argv[1]) : 8;
+  count = argc > 2 ? atol(argv[2]) : 200000;
+  pthread_t * t = malloc(nthreads * sizeof(pthread_t));
+
+  for (int i = 0; i < nthreads; i++) {
+    pthread_create(&t[i], NULL, allocate, (void *)(long)(i + 1));
+  }
+  for (int i = 0; i < nthreads; i++) {
+    pthread_join(t[i], NULL);
+  }
+  return 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * Run a command a number of times and print the shortest wall-clock time in
+ * seconds and the largest peak resident set size in KB as "seconds kb".
+ * The peak covers the whole process tree, Pin and its tool included. The
+ * command's output is discarded.
+ *
+ * usage: benchrun.out <runs> <command> [arguments...]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+int main (int argc, char ** argv) {
+
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <runs> <command> [arguments...]\n", argv[0]);
+    return 2;
+  }
+
+  int runs = atoi(argv[1]);
+  double best = -1;
+
+  for (int i = 0; i < runs; i++) {
+    struct timespec start, end;
+    int status;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t pid = fork();
+    if (pid == 0) {
+      int null = open("/dev/null", O_WRONLY);
+      dup2(null, 1);
+      execvp(argv[2], argv + 2);
+      perror(argv[2]);
+      _exit(127);
+    }
+    waitpid(pid, &status, 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "%s: failed with status 0x%x\n", argv[2], status);
+      return 1;
+    }
+
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    if (best < 0 || seconds < best) {
+      best = seconds;
+    }
+  }
+
+  // ru_maxrss of the children is the largest peak of any of them.
+  struct rusage usage;
+  getrusage(RUSAGE_CHILDREN, &usage);
+  printf("%.3f %ld\n", best, usage.ru_maxrss);
+  return 0;
+}
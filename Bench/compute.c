@@ -0,0 +1,37 @@
+/*
+ * Compute kernel: dense matrix multiply. Tight loops over a few basic
+ * blocks, so the cost is all in per-instruction and per-block callbacks.
+ *
+ * usage: compute.out [n] [rounds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+int main (int argc, char ** argv) {
+
+  int n = argc > 1 ? atoi(argv[1]) : 300;
+  int rounds = argc > 2 ? atoi(argv[2]) : 20;
+  double * a = malloc(n * n * sizeof(double));
+  double * b = malloc(n * n * sizeof(double));
+  double * c = malloc(n * n * sizeof(double));
+
+  for (int i = 0; i < n * n; i++) {
+    a[i] = i % 7;
+    b[i] = i % 5;
+  }
+
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < n; j++) {
+        double sum = 0;
+        for (int k = 0; k < n; k++) {
+          sum += a[i * n + k] * b[k * n + j];
+        }
+        c[i * n + j] = sum + r;
+      }
+    }
+  }
+
+  printf("%f\n", c[n * n - 1]);
+  return 0;
+}
@@ -0,0 +1,45 @@
+/*
+ * Pointer chasing: follow a random cycle through a list much larger than
+ * the caches. Every step is a dependent load, so memory instrumentation
+ * shows up against a workload that is already bound by memory latency.
+ *
+ * usage: pointer_chase.out [nodes] [steps]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+struct node {
+  struct node * next;
+  long pad[7];
+};
+
+int main (int argc, char ** argv) {
+
+  long nodes = argc > 1 ? atol(argv[1]) : 1 << 20;
+  long steps = argc > 2 ? atol(argv[2]) : 5000000;
+  struct node * list = malloc(nodes * sizeof(struct node));
+  long * order = malloc(nodes * sizeof(long));
+
+  // A fixed seed keeps the cycle, and so the work, the same on every run.
+  srand(1);
+  for (long i = 0; i < nodes; i++) {
+    order[i] = i;
+  }
+  for (long i = nodes - 1; i > 0; i--) {
+    long j = rand() % (i + 1);
+    long t = order[i];
+    order[i] = order[j];
+    order[j] = t;
+  }
+  for (long i = 0; i < nodes; i++) {
+    list[order[i]].next = &list[order[(i + 1) % nodes]];
+  }
+
+  struct node * p = &list[order[0]];
+  for (long i = 0; i < steps; i++) {
+    p = p->next;
+  }
+
+  printf("%ld\n", (long)(p - list));
+  return 0;
+}
@@ -0,0 +1,33 @@
+/*
+ * Deep recursion: descend thousands of frames and come back, many times
+ * over. Calls, returns and stack pointer changes dominate, which is where
+ * the call tracing and stack tools do their work.
+ *
+ * usage: recursion.out [depth] [rounds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+long descend(long depth) {
+  volatile char frame[64];
+
+  frame[0] = (char)depth;
+  if (depth == 0) {
+    return frame[0];
+  }
+  return descend(depth - 1) + frame[0];
+}
+
+int main (int argc, char ** argv) {
+
+  long depth = argc > 1 ? atol(argv[1]) : 10000;
+  long rounds = argc > 2 ? atol(argv[2]) : 2000;
+  long sum = 0;
+
+  for (long r = 0; r < rounds; r++) {
+    sum += descend(depth);
+  }
+
+  printf("%ld\n", sum);
+  return 0;
+}
@@ -0,0 +1,41 @@
+/*
+ * System call heavy I/O loop: small writes to a temporary file, then small
+ * reads of it back, one system call per block. The time goes into kernel
+ * entries and exits, which is what the system call tools hook.
+ *
+ * usage: syscall_io.out [blocks] [block size]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+int main (int argc, char ** argv) {
+
+  long blocks = argc > 1 ? atol(argv[1]) : 100000;
+  int size = argc > 2 ? atoi(argv[2]) : 128;
+  char path[] = "/tmp/syscall_io.XXXXXX";
+  char * buffer = malloc(size);
+  long total = 0;
+
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    perror(path);
+    return 1;
+  }
+  unlink(path);
+  memset(buffer, 'x', size);
+
+  for (long i = 0; i < blocks; i++) {
+    total += write(fd, buffer, size);
+  }
+  lseek(fd, 0, SEEK_SET);
+  for (long i = 0; i < blocks; i++) {
+    total += read(fd, buffer, size);
+  }
+  close(fd);
+
+  printf("%ld\n", total);
+  return 0;
+}
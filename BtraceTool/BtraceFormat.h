@@ -0,0 +1,333 @@
+/*! @file
+ *  Record format shared by BtraceTool and btrace-decode.
+ *
+ *  Every system call is kept as one fixed-size BTRACE_RECORD followed by an
+ *  optional payload holding the memory the call referenced (path strings and
+ *  data buffers). In binary mode the tool writes the records unchanged after
+ *  a BTRACE_FILE_HEADER; in text mode and in the decoder the same functions
+ *  below render a record, so both print identical strace-style lines.
+ *
+ *  The payload is a sequence of items, each a BTRACE_ITEM header followed by
+ *  len bytes of data. The whole record (header and payload) is padded to a
+ *  multiple of 8 bytes.
+ *
+ *  Data buffers are kept only up to a limit. When the tool writes complete
+ *  buffers to a separate payload file, the argument gets a second item with
+ *  BTRACE_EXTERNAL set whose data is a BTRACE_PAYLOAD_REF into that file.
+ */
+
+#ifndef BTRACE_FORMAT_H
+#define BTRACE_FORMAT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include "SyscallTable.h"
+
+#define BTRACE_MAGIC        "BTRACE1"
+#define BTRACE_MAX_ARGS     6
+#define BTRACE_MAX_PAYLOAD  8192    // payload bytes kept per record
+#define BTRACE_MAX_STRING   4096    // longest string kept per argument
+
+#define BTRACE_ABI_I386     32
+#define BTRACE_ABI_X86_64   64
+
+// BTRACE_RECORD::flags
+#define BTRACE_NORETURN     0x1     // call does not return, ret is meaningless
+
+// BTRACE_ITEM::flags
+#define BTRACE_TRUNCATED    0x1     // data is longer than what was kept
+#define BTRACE_FAULT        0x2     // memory could not be read
+#define BTRACE_EXTERNAL     0x4     // data is a BTRACE_PAYLOAD_REF
+
+struct BTRACE_FILE_HEADER
+{
+    char     magic[8];      // BTRACE_MAGIC
+    uint32_t abi;           // BTRACE_ABI_I386 or BTRACE_ABI_X86_64
+    uint32_t recordSize;    // sizeof(BTRACE_RECORD) of the writer
+};
+
+struct BTRACE_RECORD
+{
+    uint64_t tsc;                       // cycle counter at system call entry
+    uint32_t tid;                       // OS thread id of the caller
+    uint32_t num;                       // system call number
+    uint64_t args[BTRACE_MAX_ARGS];     // raw argument values
+    int64_t  ret;                       // raw return value, sign extended
+    uint32_t payload;                   // payload bytes following the record
+    uint32_t flags;                     // BTRACE_NORETURN
+};
+
+struct BTRACE_ITEM
+{
+    uint8_t  arg;           // index of the argument the data belongs to
+    uint8_t  flags;         // BTRACE_TRUNCATED, BTRACE_FAULT
+    uint16_t len;           // bytes of data following the item
+};
+
+struct BTRACE_PAYLOAD_REF
+{
+    uint64_t offset;        // offset of the data in the payload file
+    uint64_t size;          // bytes of data stored there
+};
+
+/*!
+ * @return the size of a record and its payload as stored in a buffer or file
+ */
+inline size_t BtraceRecordSize(const BTRACE_RECORD * rec)
+{
+    return (sizeof(BTRACE_RECORD) + rec->payload + 7) & ~(size_t)7;
+}
+
+/*!
+ * Find the payload item of one argument.
+ * @param[in]   rec         record the payload belongs to
+ * @param[in]   arg         argument index
+ * @param[in]   external    TRUE to find the reference into the payload file
+ *                          instead of the data kept in the record
+ * @return the item, or NULL if the argument has no such payload
+ */
+inline const BTRACE_ITEM * BtraceFindItem(const BTRACE_RECORD * rec, unsigned arg, bool external = false)
+{
+    const char * p = reinterpret_cast<const char *>(rec + 1);
+    const char * end = p + rec->payload;
+
+    while (p + sizeof(BTRACE_ITEM) <= end)
+    {
+        const BTRACE_ITEM * item = reinterpret_cast<const BTRACE_ITEM *>(p);
+        if (item->arg == arg && ((item->flags & BTRACE_EXTERNAL) != 0) == external)
+            return item;
+        p += sizeof(BTRACE_ITEM) + item->len;
+    }
+    return 0;
+}
+
+#ifdef PIN_H
+/*!
+ * Copy a NUL-terminated string of the application into a payload item.
+ * The string is fetched with PIN_SafeCopy in small chunks, so that a bad
+ * pointer or an unmapped page behind the terminating NUL does no harm.
+ * Only the tools have it; the decoder is built without Pin.
+ * @param[out]  data    destination
+ * @param[in]   addr    address of the string in the application
+ * @param[in]   max     room at data
+ * @param[out]  flags   BTRACE_TRUNCATED or BTRACE_FAULT as needed
+ * @return length of the copied string
+ */
+inline size_t BtraceCopyString(char * data, ADDRINT addr, size_t max, uint8_t * flags)
+{
+    size_t len = 0;
+
+    while (len < max)
+    {
+        size_t chunk = max - len < 64 ? max - len : 64;
+        size_t copied = PIN_SafeCopy(data + len, reinterpret_cast<VOID *>(addr + len), chunk);
+        size_t nul = strnlen(data + len, copied);
+
+        len += nul;
+        if (nul < chunk)
+        {
+            if (len == 0 && copied == 0) { *flags |= BTRACE_FAULT; }
+            return len;
+        }
+    }
+
+    *flags |= BTRACE_TRUNCATED;
+    return len;
+}
+#endif
+
+/*!
+ * Print the data of a payload item as a quoted string, escaped the way
+ * strace does: C escapes for the usual control characters, octal for the
+ * other bytes that are not printable.
+ */
+inline void BtracePrintItem(FILE * out, const BTRACE_ITEM * item)
+{
+    const unsigned char * data = reinterpret_cast<const unsigned char *>(item + 1);
+
+    fputc('"', out);
+    for (unsigned i = 0; i < item->len; i++)
+    {
+        unsigned char c = data[i];
+        switch (c)
+        {
+          case '\n': fputs("\\n", out); break;
+          case '\t': fputs("\\t", out); break;
+          case '\r': fputs("\\r", out); break;
+          case '\v': fputs("\\v", out); break;
+          case '\f': fputs("\\f", out); break;
+          case '"':  fputs("\\\"", out); break;
+          case '\\': fputs("\\\\", out); break;
+          default:
+            if (c >= ' ' && c < 0x7f)
+                fputc(c, out);
+            // Pad to three digits when a digit follows, so it is not read as part of the escape.
+            else if (i + 1 < item->len && data[i + 1] >= '0' && data[i + 1] <= '7')
+                fprintf(out, "\\%03o", c);
+            else
+                fprintf(out, "\\%o", c);
+            break;
+        }
+    }
+    fputc('"', out);
+    if (item->flags & BTRACE_TRUNCATED)
+        fprintf(out, "...");
+}
+
+/*!
+ * Print the flags argument of open(2) and its relatives.
+ */
+inline void BtracePrintOpenFlags(FILE * out, uint64_t flags)
+{
+    static const struct { int flag; const char * name; } names[] =
+    {
+        { O_CREAT, "O_CREAT" }, { O_EXCL, "O_EXCL" }, { O_NOCTTY, "O_NOCTTY" },
+        { O_TRUNC, "O_TRUNC" }, { O_APPEND, "O_APPEND" }, { O_NONBLOCK, "O_NONBLOCK" },
+        { O_SYNC, "O_SYNC" }, { O_DIRECTORY, "O_DIRECTORY" }, { O_NOFOLLOW, "O_NOFOLLOW" },
+        { O_CLOEXEC, "O_CLOEXEC" }
+    };
+
+    int mode = (int)flags & O_ACCMODE;
+    int rest = (int)flags & ~O_ACCMODE;
+
+    if (mode == O_RDONLY)       { fprintf(out, "O_RDONLY"); }
+    else if (mode == O_WRONLY)  { fprintf(out, "O_WRONLY"); }
+    else                        { fprintf(out, "O_RDWR"); }
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        if ((rest & names[i].flag) == names[i].flag)
+        {
+            fprintf(out, "|%s", names[i].name);
+            rest &= ~names[i].flag;
+        }
+    }
+
+    if (rest != 0) { fprintf(out, "|0x%x", rest); }
+}
+
+/*!
+ * Print one argument of a system call according to its type character.
+ * @param[in]   type    type character from the system call table
+ * @param[in]   rec     record holding the argument
+ * @param[in]   i       index of the argument
+ * @param[in]   abi     BTRACE_ABI_I386 or BTRACE_ABI_X86_64, the width of a long
+ */
+inline void BtracePrintArgument(FILE * out, char type, const BTRACE_RECORD * rec, unsigned i, uint32_t abi)
+{
+    uint64_t arg = rec->args[i];
+    const BTRACE_ITEM * item;
+
+    switch (type)
+    {
+      case 'd': fprintf(out, "%d", (int)arg); break;
+      case 'l':
+        if (abi == BTRACE_ABI_I386) { fprintf(out, "%lld", (long long)(int32_t)arg); }
+        else                        { fprintf(out, "%lld", (long long)arg); }
+        break;
+      case 'L':
+        arg = (arg & 0xffffffffULL) | (i + 1 < BTRACE_MAX_ARGS ? rec->args[i + 1] << 32 : 0);
+        fprintf(out, "%lld", (long long)arg);
+        break;
+      case 'u': fprintf(out, "%llu", (unsigned long long)arg); break;
+      case 'x': fprintf(out, "0x%llx", (unsigned long long)arg); break;
+      case 'm': fprintf(out, "0%o", (unsigned int)arg); break;
+      case 'z': fprintf(out, "%llu", (unsigned long long)arg); break;
+      case 'o': BtracePrintOpenFlags(out, arg); break;
+      case 's':
+      case 'b':
+      case 'B':
+        item = BtraceFindItem(rec, i);
+        if (item != 0 && !(item->flags & BTRACE_FAULT))
+            BtracePrintItem(out, item);
+        else if (arg == 0)
+            fprintf(out, "NULL");
+        else
+            fprintf(out, "0x%llx", (unsigned long long)arg);
+
+        item = BtraceFindItem(rec, i, true);
+        if (item != 0 && item->len == sizeof(BTRACE_PAYLOAD_REF))
+        {
+            BTRACE_PAYLOAD_REF ref;
+            memcpy(&ref, item + 1, sizeof(ref));
+            fprintf(out, " <payload %llu+%llu>", (unsigned long long)ref.offset, (unsigned long long)ref.size);
+        }
+        break;
+      case 'f':
+        if ((int)arg == AT_FDCWD)   { fprintf(out, "AT_FDCWD"); }
+        else                        { fprintf(out, "%d", (int)arg); }
+        break;
+      case 'p':
+      default:
+        if (arg == 0)   { fprintf(out, "NULL"); }
+        else            { fprintf(out, "0x%llx", (unsigned long long)arg); }
+        break;
+    }
+}
+
+/*!
+ * Print a system call and its arguments, "name(arg, ...)".
+ * @param[in]   desc    table entry of the call, NULL if the number is unknown
+ * @param[in]   rec     record of the call
+ * @param[in]   abi     BTRACE_ABI_I386 or BTRACE_ABI_X86_64
+ */
+inline void BtracePrintCall(FILE * out, const SYSCALL_DESC * desc, const BTRACE_RECORD * rec, uint32_t abi)
+{
+    if (desc == 0)
+    {
+        fprintf(out, "%u(0x%llx, 0x%llx, 0x%llx, 0x%llx, 0x%llx, 0x%llx)", rec->num,
+                (unsigned long long)rec->args[0], (unsigned long long)rec->args[1],
+                (unsigned long long)rec->args[2], (unsigned long long)rec->args[3],
+                (unsigned long long)rec->args[4], (unsigned long long)rec->args[5]);
+        return;
+    }
+
+    fprintf(out, "%s(", desc->name);
+    for (unsigned i = 0; desc->args[i] != '\0' && i < BTRACE_MAX_ARGS; i++)
+    {
+        // The high half of a split offset was printed with its low half.
+        if (desc->args[i] == 'h') { continue; }
+        if (i > 0) { fprintf(out, ", "); }
+        BtracePrintArgument(out, desc->args[i], rec, i, abi);
+    }
+    fprintf(out, ")");
+}
+
+/*!
+ * Print the return value of a system call, " = value".
+ * Values in the kernel's error range are printed as -1 and the errno.
+ * @param[in]   desc    table entry of the call, NULL if the number is unknown
+ * @param[in]   rec     record of the call
+ * @param[in]   abi     BTRACE_ABI_I386 or BTRACE_ABI_X86_64, the width of the value
+ */
+inline void BtracePrintReturn(FILE * out, const SYSCALL_DESC * desc, const BTRACE_RECORD * rec, uint32_t abi)
+{
+    char type = desc != 0 ? desc->ret : 'x';
+    uint64_t uret = abi == BTRACE_ABI_I386 ? (uint64_t)rec->ret & 0xffffffffULL : (uint64_t)rec->ret;
+
+    if (rec->flags & BTRACE_NORETURN)
+    {
+        fprintf(out, " = ?");
+        return;
+    }
+
+    if (rec->ret < 0 && rec->ret >= -4095)
+    {
+        fprintf(out, " = -1 errno %lld", (long long)-rec->ret);
+        return;
+    }
+
+    switch (type)
+    {
+      case 'p':
+      case 'x': fprintf(out, " = 0x%llx", (unsigned long long)uret); break;
+      case 'm': fprintf(out, " = 0%o", (unsigned int)uret); break;
+      case 'u':
+      case 'z': fprintf(out, " = %llu", (unsigned long long)uret); break;
+      default:  fprintf(out, " = %lld", (long long)rec->ret); break;
+    }
+}
+
+#endif // BTRACE_FORMAT_H
@@ -8,76 +8,328 @@
 #include <iostream>
 #include <fstream>
 #include <sys/syscall.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <time.h>
+#include <vector>
 #include <map>
+#include <algorithm>
+#include "BtraceFormat.h"
+#include "SelfProf.h"
+#include "Attach.h"
+#include "OutputFile.h"
 
 using namespace std;
 using std::cerr;
 using std::string;
 using std::endl;
-using std::map;
 /* ================================================================== */
 // Global variables 
 /* ================================================================== */
 
-map<THREADID, BOOL> syscall_encountered_map;
-map<THREADID, ADDRINT> syscall_num_map;
-
-BOOL syscall_encountered = false; // if previous instruction was system call
-ADDRINT syscall_num = -1;   // system call number of last system call executed
-
-FILE * trace;
-
-bool create_map (map<ADDRINT, string> &m) {
-
-m[SYS_exit] = string("exit");
-m[SYS_fork] = string("fork");
-m[SYS_read] = string("read");
-m[SYS_write] = string("write");
-m[SYS_stat] = string("stat");
-m[SYS_getpid] = string("getpid");
-m[SYS_setuid] = string("setuid");
-m[SYS_open] = string("open");
-m[SYS_close] = string("close");
-m[SYS_creat] = string("creat");
-m[SYS_execve] = string("execve");
-m[SYS_chdir] = string("chdir");
-m[SYS_time] = string("time");
-m[SYS_chmod] = string("chmod");
-m[SYS_getuid] = string("getuid");
-m[SYS_access] = string("access");
-m[SYS_kill] = string("kill");
-m[SYS_rename] = string("rename");
-m[SYS_mkdir] = string("mkdir");
-m[SYS_rmdir] = string("rmdir");
-m[SYS_brk] = string("brk");
-m[SYS_chroot] = string("chroot");
-m[SYS_reboot] = string("reboot");
-m[SYS_mprotect] = string("mprotect");
-m[SYS_chown] = string("chown");
-m[SYS_mmap2] = string("mmap2");
-m[SYS_exit_group] = string("exit_group");
-m[SYS_fstat] = string("fstat");
-m[SYS_fstat64] = string("fstat64");
-m[SYS_getdents] = string("getdents");
-m[SYS_getdents64] = string("getdents64");
-m[SYS_ioctl] = string("ioctl");
-return true;
-}
-
-static map<ADDRINT, string> syscall_map;
-static bool _dummy = create_map(syscall_map);
-
-// std::ostream * out = &cerr;
+// A chunk of binary records on its way to the trace file. Every thread fills
+// its own buffer; full buffers are queued for the writer thread.
+struct TRACE_BUFFER
+{
+    char *         data;    // records, back to back
+    size_t         used;    // bytes of data in use
+    TRACE_BUFFER * next;    // next buffer in the queue or free list
+};
+
+// Summary mode: counters of one system call number. Latencies are measured
+// in cycles from entry to exit; hist[i] counts the calls that took
+// [2^(i-1), 2^i) cycles.
+#define HIST_BUCKETS 40
+
+struct SYSCALL_STATS
+{
+    UINT64 calls;               // number of calls
+    UINT64 errors;              // calls that returned an error
+    UINT64 cycles;              // total latency
+    UINT64 maxCycles;           // longest latency
+    UINT64 hist[HIST_BUCKETS];  // log2-bucketed latencies
+};
+
+// -fdstats: what was done through one file descriptor, from the call that
+// created it to the call that closed it. sizes[i] counts the transfers of
+// [2^(i-1), 2^i) bytes.
+#define FD_SIZE_BUCKETS 32
+
+enum FD_KIND { FD_KIND_FILE, FD_KIND_SOCKET, FD_KIND_PIPE, FD_KIND_INHERITED };
+
+struct FD_INFO
+{
+    BOOL   open;                    // the descriptor is in use
+    UINT32 fd;                      // descriptor number
+    UINT32 kind;                    // FD_KIND_*
+    BOOL   cloexec;                 // closed by a successful exec
+    string path;                    // what was opened
+    string closedBy;                // call that retired the descriptor
+    UINT64 reads, writes, seeks;    // operations by kind
+    UINT64 others, errors;          // other calls on the descriptor, failed calls
+    UINT64 readBytes, writeBytes;   // bytes transferred
+    UINT64 sequential, random;      // transfers that did and did not continue the previous one
+    UINT64 position;                // file position, as far as the calls tell
+    UINT64 next;                    // offset right after the previous transfer
+    UINT64 cycles;                  // time spent in calls on the descriptor
+    UINT64 sizes[FD_SIZE_BUCKETS];  // log2-bucketed transfer sizes
+};
+
+// -fdstats: opens and stats of one path name.
+struct PATH_STATS
+{
+    UINT64 opens;
+    UINT64 stats;
+};
+
+// -callsites: one distinct user-space backtrace and the system calls made
+// from it, by slot.
+#define MAX_DEPTH 16
+
+struct CALL_SITE
+{
+    vector<ADDRINT>             frames;     // innermost first
+    UINT64                      calls;      // system calls made from here
+    UINT64                      cycles;     // their total latency
+    map<UINT32, SYSCALL_STATS>  bySlot;     // the same by system call
+};
+
+// -vmap: one mapping made by the application, keyed by its start address.
+struct REGION
+{
+    ADDRINT end;        // first address past the mapping
+    UINT32  prot;       // PROT_* flags
+    BOOL    anon;       // not backed by a file
+    UINT64  born;       // monotonic time it was mapped at
+};
+
+// Per-thread record of the system call that is in flight between the
+// entry and the exit callback.
+struct SYSCALL_STATE
+{
+    BOOL            pending;    // entry has been recorded, return value still due
+    UINT32          tid;        // OS thread id
+    TRACE_BUFFER *  buffer;     // binary mode: buffer the records are appended to
+    SYSCALL_STATS * stats;      // summary mode: counters indexed by system call number
+    UINT32          site;       // -callsites: call site of the pending call
+    UINT64          startNs;    // -replay_log: monotonic time at entry
+
+    // The record of the pending call, followed by room for its payload.
+    UINT64 staging[(sizeof(BTRACE_RECORD) + BTRACE_MAX_PAYLOAD + 7) / 8];
+
+    BTRACE_RECORD * Record() { return reinterpret_cast<BTRACE_RECORD *>(staging); }
+};
+
+static TLS_KEY tls_key;
+
+#if defined(TARGET_IA32E)
+#define SYSCALL_TABLE SyscallTableX86_64
+#define SYSCALL_ABI   BTRACE_ABI_X86_64
+#else
+#define SYSCALL_TABLE SyscallTableI386
+#define SYSCALL_ABI   BTRACE_ABI_I386
+#endif
+
+// Per-syscall arrays have one slot per table entry, plus one shared by
+// all numbers outside the table.
+#define NUM_SLOTS (SYSCALL_TABLE_SIZE(SYSCALL_TABLE) + 1)
+
+PIN_LOCK lock;
+FILE * trace = stderr;
+
+// State of every live thread, so that Fini can collect what they hold.
+static SYSCALL_STATE * thread_states[PIN_MAX_THREADS];
+
+// Summary mode: counters of the threads that have terminated.
+static SYSCALL_STATS summary[NUM_SLOTS];
+
+// Bitset of the slots selected by -e, one bit per slot.
+static UINT64 trace_set[(NUM_SLOTS + 63) / 64];
+
+// Binary mode: the writer thread and the buffers it drains.
+static TRACE_BUFFER * full_head = 0;
+static TRACE_BUFFER ** full_tail = &full_head;
+static TRACE_BUFFER * free_list = 0;
+static size_t buffer_size;
+static PIN_LOCK queue_lock;
+static PIN_SEMAPHORE queue_sem;
+static PIN_THREAD_UID writer_uid;
+static volatile BOOL writer_exit = false;
+
+// -payload_file: complete data buffers, referenced from the records by offset.
+static FILE * payload = 0;
+static UINT64 payload_offset = 0;
+static PIN_LOCK payload_lock;
+
+// -fdstats: what every system call does to file descriptors, by slot.
+enum FD_OP
+{
+    FD_OP_NONE, FD_OP_OTHER, FD_OP_OPEN, FD_OP_STAT, FD_OP_SOCKET, FD_OP_PIPE,
+    FD_OP_PAIR, FD_OP_DUP, FD_OP_DUP2, FD_OP_FCNTL, FD_OP_CLOSE, FD_OP_READ,
+    FD_OP_WRITE, FD_OP_PREAD, FD_OP_PWRITE, FD_OP_SEEK, FD_OP_LLSEEK, FD_OP_EXEC
+};
+
+static const struct { const char * name; UINT8 op; INT8 flagsArg; } FdCalls[] =
+{
+    { "open", FD_OP_OPEN, 1 },          { "openat", FD_OP_OPEN, 2 },
+    { "creat", FD_OP_OPEN, -1 },        { "open_by_handle_at", FD_OP_OPEN, 2 },
+    { "stat", FD_OP_STAT, -1 },         { "lstat", FD_OP_STAT, -1 },
+    { "stat64", FD_OP_STAT, -1 },       { "lstat64", FD_OP_STAT, -1 },
+    { "oldstat", FD_OP_STAT, -1 },      { "oldlstat", FD_OP_STAT, -1 },
+    { "newfstatat", FD_OP_STAT, -1 },   { "fstatat64", FD_OP_STAT, -1 },
+    { "statx", FD_OP_STAT, -1 },        { "access", FD_OP_STAT, -1 },
+    { "faccessat", FD_OP_STAT, -1 },
+    { "socket", FD_OP_SOCKET, 1 },      { "accept", FD_OP_SOCKET, -1 },
+    { "accept4", FD_OP_SOCKET, 3 },
+    { "pipe", FD_OP_PIPE, -1 },         { "pipe2", FD_OP_PIPE, 1 },
+    { "socketpair", FD_OP_PAIR, 1 },
+    { "dup", FD_OP_DUP, -1 },           { "dup2", FD_OP_DUP2, -1 },
+    { "dup3", FD_OP_DUP2, 2 },
+    { "fcntl", FD_OP_FCNTL, -1 },       { "fcntl64", FD_OP_FCNTL, -1 },
+    { "close", FD_OP_CLOSE, -1 },
+    { "read", FD_OP_READ, -1 },         { "readv", FD_OP_READ, -1 },
+    { "recvfrom", FD_OP_READ, -1 },     { "recvmsg", FD_OP_READ, -1 },
+    { "write", FD_OP_WRITE, -1 },       { "writev", FD_OP_WRITE, -1 },
+    { "sendto", FD_OP_WRITE, -1 },      { "sendmsg", FD_OP_WRITE, -1 },
+    { "pread64", FD_OP_PREAD, -1 },     { "preadv", FD_OP_PREAD, -1 },
+    { "pwrite64", FD_OP_PWRITE, -1 },   { "pwritev", FD_OP_PWRITE, -1 },
+    { "lseek", FD_OP_SEEK, -1 },        { "_llseek", FD_OP_LLSEEK, -1 },
+    { "execve", FD_OP_EXEC, -1 },       { "execveat", FD_OP_EXEC, -1 }
+};
+
+// Thresholds of the -fdstats findings.
+#define FD_TINY_BYTES   64      // average transfer below this is tiny...
+#define FD_TINY_CALLS   16      // ...once there are this many transfers
+#define FD_REPEAT_PATH  3       // opens plus stats of one path worth a mention
+
+static UINT8 fd_ops[NUM_SLOTS];
+static INT8 fd_flags_arg[NUM_SLOTS];
+static vector<FD_INFO> fd_table;            // indexed by descriptor number
+static vector<FD_INFO> fd_retired;          // descriptors that were closed
+static map<string, PATH_STATS> path_stats;
+static volatile BOOL exec_pending = false;  // an exec was entered and has not failed
+static PIN_LOCK fd_lock;
+
+// -replay_log: the file system calls btrace-replay can issue again, and the
+// name each one has in the log.
+enum REPLAY_OP
+{
+    RP_NONE, RP_OPEN, RP_CLOSE, RP_READ, RP_WRITE, RP_PREAD, RP_PWRITE, RP_LSEEK, RP_FSYNC,
+    RP_FDATASYNC, RP_FTRUNCATE, RP_STAT, RP_UNLINK, RP_MKDIR, RP_RMDIR, RP_RENAME
+};
+
+static const char * ReplayNames[] =
+{
+    "", "open", "close", "read", "write", "pread", "pwrite", "lseek", "fsync",
+    "fdatasync", "ftruncate", "stat", "unlink", "mkdir", "rmdir", "rename"
+};
+
+static const struct { const char * name; UINT8 op; } ReplayCalls[] =
+{
+    { "open", RP_OPEN },            { "openat", RP_OPEN },          { "creat", RP_OPEN },
+    { "close", RP_CLOSE },
+    { "read", RP_READ },            { "readv", RP_READ },
+    { "write", RP_WRITE },          { "writev", RP_WRITE },
+    { "pread64", RP_PREAD },        { "preadv", RP_PREAD },
+    { "pwrite64", RP_PWRITE },      { "pwritev", RP_PWRITE },
+    { "lseek", RP_LSEEK },          { "fsync", RP_FSYNC },          { "fdatasync", RP_FDATASYNC },
+    { "ftruncate", RP_FTRUNCATE },
+    { "stat", RP_STAT },            { "lstat", RP_STAT },           { "stat64", RP_STAT },
+    { "lstat64", RP_STAT },         { "newfstatat", RP_STAT },      { "fstatat64", RP_STAT },
+    { "statx", RP_STAT },           { "access", RP_STAT },          { "faccessat", RP_STAT },
+    { "unlink", RP_UNLINK },        { "unlinkat", RP_UNLINK },
+    { "mkdir", RP_MKDIR },          { "mkdirat", RP_MKDIR },        { "rmdir", RP_RMDIR },
+    { "rename", RP_RENAME },        { "renameat", RP_RENAME },      { "renameat2", RP_RENAME }
+};
+
+static UINT8 replay_ops[NUM_SLOTS];
+static FILE * replay = 0;
+static PIN_LOCK replay_lock;
+
+// -callsites: every backtrace seen so far, interned to an index into sites.
+static map<vector<ADDRINT>, UINT32> site_index;
+static vector<CALL_SITE> sites;
+static PIN_LOCK site_lock;
+
+// -vmap: the calls that change the address space, by slot.
+enum VM_OP { VM_NONE, VM_MMAP, VM_MUNMAP, VM_MREMAP, VM_MPROTECT, VM_BRK, VM_OPS };
+
+static const struct { const char * name; UINT8 op; } VmCalls[] =
+{
+    { "mmap", VM_MMAP },            { "mmap2", VM_MMAP },           { "munmap", VM_MUNMAP },
+    { "mremap", VM_MREMAP },        { "mprotect", VM_MPROTECT },    { "pkey_mprotect", VM_MPROTECT },
+    { "brk", VM_BRK }
+};
+
+#define VM_PAGE         4096ULL
+#define VM_SHORT_LIVED  10000000ULL     // ns; a mapping unmapped sooner is churn
+#define VM_POLL_MS      100             // longest the timer thread sleeps at a time
+
+static UINT8 vm_ops[NUM_SLOTS];
+static map<ADDRINT, REGION> regions;        // mappings made since the tool started
+static UINT64 vm_anon, vm_file;             // bytes in regions
+static ADDRINT heap_start, heap_end;        // the brk heap, once the first brk told where
+static UINT64 vm_peak;                      // most bytes mapped at any time
+static UINT64 vm_start_ns, vm_last_ns;      // start of the timeline, time of the last row
+static UINT64 vm_rows;                      // rows printed
+static UINT64 vm_calls[VM_OPS];             // calls since the last row, by VM_*
+static UINT64 vm_mapped, vm_unmapped;       // bytes since the last row
+static UINT64 vm_total_calls[VM_OPS];       // the same since the start
+static UINT64 vm_total_mapped, vm_total_unmapped;
+static UINT64 vm_short, vm_short_bytes;     // mappings that lived less than VM_SHORT_LIVED
+static map<UINT64, UINT64> vm_short_sizes;  // their count by size
+static PIN_LOCK vm_lock;
+static PIN_THREAD_UID vm_uid;               // the timer thread printing the rows
+static volatile BOOL vm_exit = false;
+
+// Kinds of the -selfprof report.
+static UINT32 prof_before, prof_after, prof_emit, prof_drain;
 
 /* ===================================================================== */
 // Command line switches
 /* ===================================================================== */
 KNOB<string> KnobOutputFile(KNOB_MODE_WRITEONCE,  "pintool",
-    "o", "", "specify file name for BtraceTool output");
+    "o", "", "specify file name for BtraceTool output, %p is replaced by the process id; "
+             "forked children without %p write to <file>.<pid>");
 
 KNOB<BOOL>   KnobCount(KNOB_MODE_WRITEONCE,  "pintool",
     "count", "1", "count instructions, basic blocks and threads in the application");
 
+KNOB<BOOL>   KnobBinary(KNOB_MODE_WRITEONCE,  "pintool",
+    "binary", "0", "write binary records for btrace-decode instead of text (needs -o)");
+
+KNOB<UINT32> KnobBufferSize(KNOB_MODE_WRITEONCE,  "pintool",
+    "bufsize", "256", "size in KB of the per-thread record buffers in binary mode");
+
+KNOB<BOOL>   KnobSummary(KNOB_MODE_WRITEONCE,  "pintool",
+    "summary", "0", "print only per-syscall counts, errors and latency histograms at exit");
+
+KNOB<string> KnobFilter(KNOB_MODE_WRITEONCE,  "pintool",
+    "e", "", "trace only the given system calls, strace style: trace=[!]name|class[,...], "
+             "classes are file, desc, network, memory, process, signal, ipc and all");
+
+KNOB<BOOL>   KnobFdStats(KNOB_MODE_WRITEONCE,  "pintool",
+    "fdstats", "0", "print only a per file descriptor I/O report at exit");
+
+KNOB<BOOL>   KnobCallSites(KNOB_MODE_WRITEONCE,  "pintool",
+    "callsites", "0", "report system call counts and latency per user-space call site at exit");
+
+KNOB<UINT32> KnobDepth(KNOB_MODE_WRITEONCE,  "pintool",
+    "depth", "4", "frames kept of every call-site backtrace, at most 16");
+
+KNOB<string> KnobReplayLog(KNOB_MODE_WRITEONCE,  "pintool",
+    "replay_log", "", "record the file I/O of the application in this file for btrace-replay; %p as in -o");
+
+KNOB<UINT32> KnobStringSize(KNOB_MODE_WRITEONCE,  "pintool",
+    "s", "32", "bytes of read and write buffers to keep in the trace");
+
+KNOB<string> KnobPayloadFile(KNOB_MODE_WRITEONCE,  "pintool",
+    "payload_file", "", "append complete read and write buffers to this file, "
+                        "the trace refers to them by offset; %p as in -o");
+
+KNOB<UINT32> KnobVmap(KNOB_MODE_WRITEONCE,  "pintool",
+    "vmap", "0", "print only a timeline of the address space, one row every N ms, and a report at exit");
+
 
 /* ===================================================================== */
 // Utilities
@@ -96,549 +348,1877 @@ INT32 Usage()
     return -1;
 }
 
-/* ===================================================================== */
-// Analysis routines
-/* ===================================================================== */
+/*!
+ * Open an output file for this process, named as OutputFile.h tells.
+ * @param[in]   templ   file name given on the command line
+ * @param[in]   mode    fopen() mode
+ * @param[in]   child   TRUE in a child process created by fork
+ * @return the open file, or NULL
+ */
+static FILE * OpenOutput(const string & templ, const char * mode, BOOL child)
+{
+    return fopen(OutputFileName(templ, child).c_str(), mode);
+}
 
 /*!
- * Increase counter of the executed basic blocks and instructions.
- * This function is called for every basic block when it is about to be executed.
- * @param[in]   numInstInBbl    number of instructions in the basic block
- * @note use atomic operations for multi-threaded applications
+ * A forked child cannot open one of its output files: report it, as main
+ * does, and exit rather than trace into a closed file.
+ * @param[in]   templ   file name given on the command line
  */
+static VOID ChildOpenFailed(const string & templ)
+{
+    cerr << "btrace: cannot open " << templ << " in process " << PIN_GetPid() << endl;
+    PIN_ExitProcess(1);
+}
 
-VOID SysBefore (ADDRINT ip, CONTEXT * ctx, THREADID threadid) {
+/*!
+ * @return TRUE if every call is traced, FALSE in the modes that print only a report
+ */
+static inline BOOL Tracing()
+{
+    return !KnobSummary && !KnobFdStats && KnobVmap == 0;
+}
 
-  ADDRINT num  = (ADDRINT) PIN_GetContextReg(ctx, LEVEL_BASE::REG_EAX);
-  ADDRINT arg0 = (ADDRINT) PIN_GetContextReg(ctx, LEVEL_BASE::REG_EBX);
-  ADDRINT arg1 = (ADDRINT) PIN_GetContextReg(ctx, LEVEL_BASE::REG_ECX);
-  ADDRINT arg2 = (ADDRINT) PIN_GetContextReg(ctx, LEVEL_BASE::REG_EDX);
-  ADDRINT arg3 = (ADDRINT) PIN_GetContextReg(ctx, LEVEL_BASE::REG_ESI);
-  ADDRINT arg4 = (ADDRINT) PIN_GetContextReg(ctx, LEVEL_BASE::REG_EDI);
+/*!
+ * @return the processor's time stamp counter
+ */
+static inline UINT64 ReadTsc()
+{
+    UINT32 lo, hi;
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((UINT64)hi << 32) | lo;
+}
 
+/*!
+ * @return the table entry of a system call number, NULL if it is unknown
+ */
+static inline const SYSCALL_DESC * Lookup(ADDRINT num)
+{
+    return SyscallLookup(SYSCALL_TABLE, SYSCALL_TABLE_SIZE(SYSCALL_TABLE), num);
+}
 
-// }
+/*!
+ * @return the slot of a system call number in the per-syscall arrays
+ */
+static inline UINT32 Slot(ADDRINT num)
+{
+    return num < NUM_SLOTS - 1 ? num : NUM_SLOTS - 1;
+}
 
+/*!
+ * @return TRUE if the system call number was selected with -e
+ */
+static inline BOOL Selected(ADDRINT num)
+{
+    UINT32 slot = Slot(num);
+    return (trace_set[slot / 64] >> (slot % 64)) & 1;
+}
 
-// VOID _SysBefore (ADDRINT ip, ADDRINT num, ADDRINT arg0, ADDRINT arg1, ADDRINT arg2, ADDRINT arg3, ADDRINT arg4, ADDRINT arg5, THREADID threadid) {
+/*!
+ * Add a slot to the filter bitset, or remove it.
+ */
+static VOID SelectSlot(UINT32 slot, BOOL on)
+{
+    if (on) { trace_set[slot / 64] |= 1ULL << (slot % 64); }
+    else    { trace_set[slot / 64] &= ~(1ULL << (slot % 64)); }
+}
 
-	if (num == SYS_mmap)
-  {
-        ADDRINT * mmapArgs = reinterpret_cast<ADDRINT *>(arg0);
-        arg0 = mmapArgs[0];
-        arg1 = mmapArgs[1];
-        arg2 = mmapArgs[2];
-        arg3 = mmapArgs[3];
-        arg4 = mmapArgs[4];
-        // arg5 = mmapArgs[5];
-  }
+/*!
+ * Compile an strace-like filter expression into the filter bitset.
+ * The expression is an optional "trace=", an optional "!" that inverts the
+ * whole set, and a comma separated list of system call names and classes
+ * ("file" or "%file"). A "!" in front of a single item removes it instead.
+ * An empty expression selects every system call.
+ * @param[in]   expr    value of -e
+ * @return FALSE if the expression names an unknown system call or class
+ */
+static BOOL ParseFilter(string expr)
+{
+    BOOL negate = FALSE;
 
-	int handled = syscall_map.count(num);
+    if (expr.empty()) { expr = "all"; }
+    if (expr.compare(0, 6, "trace=") == 0) { expr = expr.substr(6); }
+    if (!expr.empty() && expr[0] == '!') { negate = TRUE; expr = expr.substr(1); }
 
-	if (handled < 1)
-	{
-    fprintf(trace,"%ld(0x%lx, 0x%lx, 0x%lx, 0x%lx, 0x%lx)",
-        (unsigned long)num,
-        (unsigned long)arg0,
-        (unsigned long)arg1,
-        (unsigned long)arg2,
-        (unsigned long)arg3,
-        (unsigned long)arg4);
-        // (unsigned long)arg5);
+    memset(trace_set, 0, sizeof(trace_set));
 
-		syscall_encountered = true;
-  	syscall_num = num;
-		return;
-	}
+    size_t start = 0;
+    while (start < expr.size())
+    {
+        size_t end = expr.find(',', start);
+        if (end == string::npos) { end = expr.size(); }
 
-  const char * syscall_name = syscall_map[num].c_str();
+        string item = expr.substr(start, end - start);
+        start = end + 1;
 
-  if (num == SYS_exit)
-  {
-		fprintf(trace,"%s(%ld) = ?\n",
-        syscall_name,
-        (long) arg0);       
-  }
+        BOOL on = TRUE;
+        if (!item.empty() && item[0] == '!') { on = FALSE; item = item.substr(1); }
+        if (!item.empty() && item[0] == '%') { item = item.substr(1); }
+        if (item.empty() || item == "none") { continue; }
 
-  else if (num == SYS_fork)
-  {
-      fprintf(trace, "%s()",
-       syscall_name);
-  }
+        if (item == "all")
+        {
+            for (UINT32 slot = 0; slot < NUM_SLOTS; slot++) { SelectSlot(slot, on); }
+            continue;
+        }
 
-  else if (num == SYS_read || num == SYS_write)
-  {
-      char * temp_str = (char *)arg1;
-      int temp_len = strlen(temp_str);
+        unsigned classes = 0;
+        for (size_t i = 0; i < sizeof(SyscallClasses) / sizeof(SyscallClasses[0]); i++)
+        {
+            if (item == SyscallClasses[i].name) { classes = SyscallClasses[i].flag; }
+        }
 
-      char * temp_fmt_str;
+        BOOL found = FALSE;
+        for (UINT32 slot = 0; slot < NUM_SLOTS - 1; slot++)
+        {
+            const SYSCALL_DESC * desc = Lookup(slot);
+            if (desc == 0) { continue; }
+            if (classes != 0 ? (desc->classes & classes) != 0 : item == desc->name)
+            {
+                SelectSlot(slot, on);
+                found = TRUE;
+            }
+        }
 
-        if (temp_len > 8) {
-          temp_fmt_str = (char *)"%s(%d, \"%.8s\"..., %u)";
-        } else {
-          temp_fmt_str = (char *)"%s(%d, \"%s\", %u)";
+        if (!found && classes == 0)
+        {
+            cerr << "btrace: unknown system call or class '" << item << "' in -e" << endl;
+            return FALSE;
         }
+    }
 
-        fprintf(trace, temp_fmt_str,
-          syscall_name,
-          (int)arg0,
-          (char *)arg1,
-          (unsigned int)arg2);
-  }
+    if (negate)
+    {
+        for (UINT32 slot = 0; slot < NUM_SLOTS; slot++) { SelectSlot(slot, !Selected(slot)); }
+    }
+    return TRUE;
+}
 
-  else if (num == SYS_open)
-  {
-        int flag = ((int)arg1) & 3;
-        
-        char * mode;
+/*!
+ * Add the summary counters of one thread to the process-wide ones.
+ */
+static VOID MergeStats(const SYSCALL_STATS * stats)
+{
+    for (UINT32 num = 0; num < NUM_SLOTS; num++)
+    {
+        SYSCALL_STATS * total = &summary[num];
+
+        total->calls += stats[num].calls;
+        total->errors += stats[num].errors;
+        total->cycles += stats[num].cycles;
+        if (stats[num].maxCycles > total->maxCycles) { total->maxCycles = stats[num].maxCycles; }
+        for (UINT32 i = 0; i < HIST_BUCKETS; i++) { total->hist[i] += stats[num].hist[i]; }
+    }
+}
+
+/*!
+ * @return the name printed for a system call number in the summary
+ */
+static string SummaryName(UINT32 num)
+{
+    const SYSCALL_DESC * desc = Lookup(num);
+
+    if (desc != 0) { return desc->name; }
+    if (num == NUM_SLOTS - 1) { return "(other)"; }
+    return decstr(num);
+}
+
+/*!
+ * Orders system call numbers by the total time spent in them, longest first.
+ */
+static bool MoreCycles(UINT32 a, UINT32 b)
+{
+    return summary[a].cycles > summary[b].cycles;
+}
+
+/*!
+ * Print the summary table, sorted by time, followed by the latency
+ * histogram of every system call that was made.
+ */
+static VOID PrintSummary()
+{
+    vector<UINT32> nums;
+    UINT64 calls = 0, errors = 0, cycles = 0;
+
+    for (UINT32 num = 0; num < NUM_SLOTS; num++)
+    {
+        if (summary[num].calls == 0) { continue; }
+        nums.push_back(num);
+        calls += summary[num].calls;
+        errors += summary[num].errors;
+        cycles += summary[num].cycles;
+    }
+    sort(nums.begin(), nums.end(), MoreCycles);
+
+    fprintf(trace, "%% time     total cycles  cycles/call   max cycles      calls     errors syscall\n");
+    fprintf(trace, "------ ---------------- ------------ ------------ ---------- ---------- ----------------\n");
+    for (size_t i = 0; i < nums.size(); i++)
+    {
+        const SYSCALL_STATS * stats = &summary[nums[i]];
+
+        fprintf(trace, "%6.2f %16llu %12llu %12llu %10llu %10llu %s\n",
+            cycles ? 100.0 * stats->cycles / cycles : 0.0,
+            (unsigned long long)stats->cycles,
+            (unsigned long long)(stats->cycles / stats->calls),
+            (unsigned long long)stats->maxCycles,
+            (unsigned long long)stats->calls,
+            (unsigned long long)stats->errors,
+            SummaryName(nums[i]).c_str());
+    }
+    fprintf(trace, "------ ---------------- ------------ ------------ ---------- ---------- ----------------\n");
+    fprintf(trace, "100.00 %16llu %12s %12s %10llu %10llu total\n",
+        (unsigned long long)cycles, "", "", (unsigned long long)calls, (unsigned long long)errors);
+
+    fprintf(trace, "\nLatency histograms (cycles):\n");
+    for (size_t i = 0; i < nums.size(); i++)
+    {
+        const SYSCALL_STATS * stats = &summary[nums[i]];
+
+        fprintf(trace, "%s:\n", SummaryName(nums[i]).c_str());
+        for (UINT32 b = 0; b < HIST_BUCKETS; b++)
+        {
+            if (stats->hist[b] == 0) { continue; }
+            fprintf(trace, "  [%20llu, %20llu) %10llu\n",
+                b == 0 ? 0ULL : 1ULL << (b - 1),
+                1ULL << b,
+                (unsigned long long)stats->hist[b]);
+        }
+    }
+}
+
+/*!
+ * Fill the -fdstats tables: the calls named in FdCalls[] are known by what
+ * they do, every other call whose first argument is a descriptor counts as
+ * some other operation on it. Also fill the -replay_log and -vmap tables.
+ */
+static VOID InitCallTables()
+{
+    for (UINT32 slot = 0; slot < NUM_SLOTS - 1; slot++)
+    {
+        const SYSCALL_DESC * desc = Lookup(slot);
+
+        fd_flags_arg[slot] = -1;
+        if (desc == 0) { continue; }
+        if (desc->args[0] == 'f') { fd_ops[slot] = FD_OP_OTHER; }
 
-        if (flag == 0) 
+        for (size_t i = 0; i < sizeof(FdCalls) / sizeof(FdCalls[0]); i++)
         {
-          mode = (char *) "O_RDONLY";
-        } 
-        else if (flag == 1)        
+            if (strcmp(desc->name, FdCalls[i].name) == 0)
+            {
+                fd_ops[slot] = FdCalls[i].op;
+                fd_flags_arg[slot] = FdCalls[i].flagsArg;
+            }
+        }
+        for (size_t i = 0; i < sizeof(ReplayCalls) / sizeof(ReplayCalls[0]); i++)
+        {
+            if (strcmp(desc->name, ReplayCalls[i].name) == 0) { replay_ops[slot] = ReplayCalls[i].op; }
+        }
+        for (size_t i = 0; i < sizeof(VmCalls) / sizeof(VmCalls[0]); i++)
+        {
+            if (strcmp(desc->name, VmCalls[i].name) == 0) { vm_ops[slot] = VmCalls[i].op; }
+        }
+    }
+}
+
+/*!
+ * Find the entry of a descriptor, creating one for descriptors that were
+ * open before the first call the tool saw. The caller holds fd_lock.
+ * @return the entry, or NULL if fd is not a descriptor number
+ */
+static FD_INFO * FdEntry(INT64 fd)
+{
+    static const char * std_names[] = { "<stdin>", "<stdout>", "<stderr>" };
+
+    if (fd < 0 || fd >= (1 << 20)) { return 0; }
+    if ((size_t)fd >= fd_table.size()) { fd_table.resize(fd + 64); }
+
+    FD_INFO * info = &fd_table[fd];
+    if (!info->open)
+    {
+        *info = FD_INFO();
+        info->open = true;
+        info->fd = fd;
+        info->kind = FD_KIND_INHERITED;
+        info->path = fd < 3 ? std_names[fd] : "<inherited>";
+
+        // After "pin -pid" most descriptors were opened before the tool came.
+        char link[64], target[1024];
+        snprintf(link, sizeof(link), "/proc/self/fd/%d", (int)fd);
+        ssize_t length = fd < 3 ? -1 : readlink(link, target, sizeof(target) - 1);
+        if (length > 0) { info->path = string(target, length); }
+    }
+    return info;
+}
+
+/*!
+ * Retire a descriptor: keep its counters for the report and free the slot.
+ * The caller holds fd_lock.
+ * @param[in]   fd      descriptor number
+ * @param[in]   how     call that closed it
+ */
+static VOID FdClose(INT64 fd, const char * how)
+{
+    if (fd < 0 || (size_t)fd >= fd_table.size() || !fd_table[fd].open) { return; }
+
+    fd_table[fd].open = false;
+    fd_table[fd].closedBy = how;
+    fd_retired.push_back(fd_table[fd]);
+}
+
+/*!
+ * Start a new entry for a descriptor returned by the kernel. An entry still
+ * open under the same number missed its close, e.g. because -e hid it.
+ * The caller holds fd_lock.
+ * @return the new entry, or NULL if fd is not a descriptor number
+ */
+static FD_INFO * FdOpen(INT64 fd, UINT32 kind, const string & path, BOOL cloexec)
+{
+    FdClose(fd, "?");
+
+    FD_INFO * info = FdEntry(fd);
+    if (info != 0)
+    {
+        info->kind = kind;
+        info->path = path;
+        info->cloexec = cloexec;
+    }
+    return info;
+}
+
+/*!
+ * Account one read or write. For files, the transfer is sequential if it
+ * starts where the previous one ended.
+ * @param[in]   info    descriptor entry
+ * @param[in]   write   TRUE for a write
+ * @param[in]   bytes   bytes transferred
+ * @param[in]   offset  file offset of a positioned transfer, -1 to use the file position
+ */
+static VOID FdTransfer(FD_INFO * info, BOOL write, UINT64 bytes, INT64 offset)
+{
+    UINT32 bucket = bytes == 0 ? 0 : 64 - __builtin_clzll(bytes);
+
+    if (write)  { info->writes++; info->writeBytes += bytes; }
+    else        { info->reads++;  info->readBytes += bytes; }
+    info->sizes[bucket < FD_SIZE_BUCKETS ? bucket : FD_SIZE_BUCKETS - 1]++;
+
+    if (info->kind != FD_KIND_FILE) { return; }
+
+    UINT64 at = offset < 0 ? info->position : (UINT64)offset;
+    if (at == info->next)   { info->sequential++; }
+    else                    { info->random++; }
+    info->next = at + bytes;
+    if (offset < 0) { info->position += bytes; }
+}
+
+/*!
+ * @param[in]   nth     0 for the first path argument, 1 for the second
+ * @return a path string argument of a record, "?" if none was captured
+ */
+static string RecordPath(const BTRACE_RECORD * rec, const SYSCALL_DESC * desc, UINT32 nth = 0)
+{
+    for (UINT32 i = 0; desc->args[i] != '\0'; i++)
+    {
+        if (desc->args[i] != 's' || nth-- != 0) { continue; }
+
+        const BTRACE_ITEM * item = BtraceFindItem(rec, i);
+        if (item == 0 || (item->flags & BTRACE_FAULT)) { break; }
+        return string(reinterpret_cast<const char *>(item + 1), item->len);
+    }
+    return "?";
+}
+
+/*!
+ * -replay_log: a path argument as the kernel used it. A relative path of
+ * an *at call, whose directory descriptor is the argument before it, is
+ * taken from that directory, found through /proc/self/fd as FdEntry()
+ * finds descriptors; an empty one (AT_EMPTY_PATH) is the directory itself.
+ * @param[in]   nth     0 for the first path argument, 1 for the second
+ * @return the path, empty if its directory cannot be told
+ */
+static string ReplayPath(const BTRACE_RECORD * rec, const SYSCALL_DESC * desc, UINT32 nth = 0)
+{
+    string path = RecordPath(rec, desc, nth);
+
+    for (UINT32 i = 0; desc->args[i] != '\0'; i++)
+    {
+        if (desc->args[i] != 's' || nth-- != 0) { continue; }
+        if (i == 0 || desc->args[i - 1] != 'f' || (!path.empty() && path[0] == '/')) { break; }
+
+        INT32 dirfd = (INT32)rec->args[i - 1];
+        if (dirfd == AT_FDCWD) { break; }
+
+        char link[64], target[1024];
+        snprintf(link, sizeof(link), "/proc/self/fd/%d", (int)dirfd);
+        ssize_t length = path == "?" ? -1 : readlink(link, target, sizeof(target) - 1);
+        if (length <= 0 || target[0] != '/') { return ""; }
+        return path.empty() ? string(target, length) : string(target, length) + "/" + path;
+    }
+    return path;
+}
+
+/*!
+ * @return the 64-bit file offset passed to a positioned read or write
+ */
+static INT64 RecordOffset(const BTRACE_RECORD * rec)
+{
+#if defined(TARGET_IA32)
+    // The i386 ABI splits the offset across two arguments.
+    return (INT64)((rec->args[4] << 32) | (rec->args[3] & 0xffffffff));
+#else
+    return (INT64)rec->args[3];
+#endif
+}
+
+/*!
+ * @return the index of the first argument of a type, or -1
+ */
+static INT32 ArgOfType(const SYSCALL_DESC * desc, char type)
+{
+    for (UINT32 i = 0; desc->args[i] != '\0'; i++)
+    {
+        if (desc->args[i] == type) { return i; }
+    }
+    return -1;
+}
+
+/*!
+ * @return a path with blanks, '%' and unprintable bytes written as %XX,
+ *         so that it is a single field of the replay log
+ */
+static string EscapePath(const string & path)
+{
+    static const char hex[] = "0123456789abcdef";
+    string out;
+
+    for (size_t i = 0; i < path.size(); i++)
+    {
+        unsigned char c = path[i];
+        if (c <= ' ' || c >= 0x7f || c == '%')
         {
-          mode = (char *) "O_WRONLY";
+            out += '%';
+            out += hex[c >> 4];
+            out += hex[c & 15];
         }
         else
         {
-          mode = (char *) "O_RDWR";
+            out += c;
         }
+    }
+    return out;
+}
 
-        fprintf(trace, "%s(\"%s\", %s, %o)",
-          syscall_name,
-          (char *)arg0,
-          mode,
-          (unsigned int)arg2);
-  }
+/*!
+ * @return CLOCK_MONOTONIC in nanoseconds
+ */
+static inline UINT64 NowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UINT64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
 
-  else if (num == SYS_close)
-  {
-      fprintf(trace,"%s(%ld)",
-        syscall_name,
-        (unsigned long)arg0);
-  }
+/*!
+ * Print one line of the -fdstats table and the size histogram of the descriptor.
+ */
+static VOID PrintFdInfo(const FD_INFO * info)
+{
+    static const char * kinds[] = { "file", "socket", "pipe", "inherit" };
+
+    fprintf(trace, "%5u %-7s %10llu %14llu %10llu %14llu %8llu %8llu %8llu %8llu %14llu %-8s %s\n",
+        info->fd, kinds[info->kind],
+        (unsigned long long)info->reads, (unsigned long long)info->readBytes,
+        (unsigned long long)info->writes, (unsigned long long)info->writeBytes,
+        (unsigned long long)info->seeks, (unsigned long long)info->others,
+        (unsigned long long)info->sequential, (unsigned long long)info->random,
+        (unsigned long long)info->cycles,
+        info->open ? "-" : info->closedBy.c_str(), info->path.c_str());
+
+    if (info->reads + info->writes == 0) { return; }
+    fprintf(trace, "      sizes:");
+    for (UINT32 b = 0; b < FD_SIZE_BUCKETS; b++)
+    {
+        if (info->sizes[b] == 0) { continue; }
+        fprintf(trace, " [%llu,%llu):%llu", b == 0 ? 0ULL : 1ULL << (b - 1), 1ULL << b,
+            (unsigned long long)info->sizes[b]);
+    }
+    fprintf(trace, "\n");
+}
 
-  else if (num == SYS_creat) 
-  {
-        fprintf(trace, "%s(\"%s\", %o)",
-          syscall_name,
-          (char *)arg0,
-          (unsigned int)arg1);
-  }
+/*!
+ * Print the findings about one descriptor: tiny transfers and a missing close.
+ */
+static VOID PrintFdFindings(const FD_INFO * info)
+{
+    if (info->reads >= FD_TINY_CALLS && info->readBytes / info->reads < FD_TINY_BYTES)
+    {
+        fprintf(trace, "  fd %u (%s): %llu reads of %llu bytes on average, consider buffering\n",
+            info->fd, info->path.c_str(), (unsigned long long)info->reads,
+            (unsigned long long)(info->readBytes / info->reads));
+    }
+    if (info->writes >= FD_TINY_CALLS && info->writeBytes / info->writes < FD_TINY_BYTES)
+    {
+        fprintf(trace, "  fd %u (%s): %llu writes of %llu bytes on average, consider buffering\n",
+            info->fd, info->path.c_str(), (unsigned long long)info->writes,
+            (unsigned long long)(info->writeBytes / info->writes));
+    }
+    if (info->open && info->kind != FD_KIND_INHERITED)
+    {
+        fprintf(trace, "  fd %u (%s): never closed\n", info->fd, info->path.c_str());
+    }
+}
 
-  else if (num == SYS_execve) 
-  {
-        fprintf(trace, "%s(\"%s\", 0x%lx, 0x%lx)",
-          syscall_name,
-          (char *)arg0,
-          (unsigned long)arg1,
-          (unsigned long)arg2);  
-  }
+/*!
+ * Print the -fdstats report: every descriptor in the order it was retired,
+ * then the ones still open, then the findings.
+ */
+static VOID PrintFdReport()
+{
+    // After a successful exec, close-on-exec descriptors went with it and the
+    // others live on in the new program.
+    for (size_t fd = 0; exec_pending && fd < fd_table.size(); fd++)
+    {
+        if (fd_table[fd].open && fd_table[fd].cloexec) { FdClose(fd, "exec"); }
+    }
+
+    vector<const FD_INFO *> all;
+    for (size_t i = 0; i < fd_retired.size(); i++) { all.push_back(&fd_retired[i]); }
+    for (size_t fd = 0; fd < fd_table.size(); fd++)
+    {
+        if (fd_table[fd].open) { all.push_back(&fd_table[fd]); }
+    }
+
+    fprintf(trace, "   fd kind         reads     read bytes     writes    write bytes    seeks    other"
+                   "      seq   random         cycles closed   path\n");
+    for (size_t i = 0; i < all.size(); i++) { PrintFdInfo(all[i]); }
+
+    fprintf(trace, "\nFindings:\n");
+    for (size_t i = 0; i < all.size(); i++)
+    {
+        if (exec_pending && all[i]->open) { continue; }
+        PrintFdFindings(all[i]);
+    }
+    for (map<string, PATH_STATS>::iterator it = path_stats.begin(); it != path_stats.end(); ++it)
+    {
+        if (it->second.opens + it->second.stats < FD_REPEAT_PATH) { continue; }
+        fprintf(trace, "  %s: opened %llu times, stat'ed %llu times\n", it->first.c_str(),
+            (unsigned long long)it->second.opens, (unsigned long long)it->second.stats);
+    }
+}
+
+/*!
+ * Describe one frame of a call-site backtrace: address, routine and offset,
+ * image, and the source line when debug information has it. The caller
+ * holds the client lock.
+ * @param[in]   addr    address of the frame
+ * @param[in]   inner   TRUE for the innermost frame, which holds the address
+ *                      of the system call rather than a return address
+ */
+static string FrameName(ADDRINT addr, BOOL inner)
+{
+    // A return address may belong to the next line or routine already.
+    ADDRINT pc = inner ? addr : addr - 1;
+    string text = hexstr(addr);
+
+    RTN rtn = RTN_FindByAddress(pc);
+    if (RTN_Valid(rtn))
+    {
+        text += " " + RTN_Name(rtn) + "+" + hexstr(addr - RTN_Address(rtn));
+        string image = IMG_Name(SEC_Img(RTN_Sec(rtn)));
+        text += " (" + image.substr(image.rfind('/') + 1) + ")";
+    }
+    else
+    {
+        text += " ??";
+    }
+
+    INT32 line = 0;
+    string file;
+    PIN_GetSourceLocation(pc, 0, &line, &file);
+    if (line != 0) { text += " " + file.substr(file.rfind('/') + 1) + ":" + decstr(line); }
+    return text;
+}
+
+/*!
+ * Orders call sites by the total time spent in their system calls, longest first.
+ */
+static bool SiteMoreCycles(const CALL_SITE * a, const CALL_SITE * b)
+{
+    return a->cycles > b->cycles;
+}
+
+/*!
+ * Print the -callsites report: every call site by time, with its calls
+ * broken down by system call and its symbolized backtrace.
+ * @param[in]   out     file to print to
+ */
+static VOID PrintCallSites(FILE * out)
+{
+    vector<const CALL_SITE *> order;
+    for (size_t i = 0; i < sites.size(); i++)
+    {
+        if (sites[i].calls != 0) { order.push_back(&sites[i]); }
+    }
+    sort(order.begin(), order.end(), SiteMoreCycles);
+
+    PIN_LockClient();
+    fprintf(out, "\nCall sites (by time):\n");
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        const CALL_SITE * site = order[i];
+
+        fprintf(out, "#%lu  %llu calls, %llu cycles\n", (unsigned long)i + 1,
+            (unsigned long long)site->calls, (unsigned long long)site->cycles);
+        for (map<UINT32, SYSCALL_STATS>::const_iterator it = site->bySlot.begin(); it != site->bySlot.end(); ++it)
+        {
+            fprintf(out, "    %-20s %10llu calls %10llu errors %16llu cycles %12llu max\n",
+                SummaryName(it->first).c_str(),
+                (unsigned long long)it->second.calls, (unsigned long long)it->second.errors,
+                (unsigned long long)it->second.cycles, (unsigned long long)it->second.maxCycles);
+        }
+        for (size_t f = 0; f < site->frames.size(); f++)
+        {
+            fprintf(out, "      at %s\n", FrameName(site->frames[f], f == 0).c_str());
+        }
+    }
+    PIN_UnlockClient();
+}
+
+/*!
+ * Take an empty buffer from the free list, or allocate a new one.
+ */
+static TRACE_BUFFER * GetBuffer()
+{
+    PIN_GetLock(&queue_lock, PIN_ThreadId()+1);
+    TRACE_BUFFER * buffer = free_list;
+    if (buffer != 0) { free_list = buffer->next; }
+    PIN_ReleaseLock(&queue_lock);
+
+    if (buffer == 0)
+    {
+        buffer = new TRACE_BUFFER();
+        buffer->data = new char[buffer_size];
+    }
+    buffer->used = 0;
+    buffer->next = 0;
+    return buffer;
+}
+
+/*!
+ * Hand a filled buffer to the writer thread.
+ */
+static VOID QueueBuffer(TRACE_BUFFER * buffer)
+{
+    PIN_GetLock(&queue_lock, PIN_ThreadId()+1);
+    *full_tail = buffer;
+    full_tail = &buffer->next;
+    PIN_ReleaseLock(&queue_lock);
+
+    PIN_SemaphoreSet(&queue_sem);
+}
+
+/*!
+ * Write all queued buffers to the trace file, in queue order, and put them
+ * back on the free list.
+ */
+static VOID DrainQueue()
+{
+    SELFPROF_CALL_SCOPE(prof_drain);
+    PIN_GetLock(&queue_lock, PIN_ThreadId()+1);
+    TRACE_BUFFER * buffer = full_head;
+    full_head = 0;
+    full_tail = &full_head;
+    PIN_ReleaseLock(&queue_lock);
+
+    while (buffer != 0)
+    {
+        TRACE_BUFFER * next = buffer->next;
+
+        fwrite(buffer->data, 1, buffer->used, trace);
+
+        PIN_GetLock(&queue_lock, PIN_ThreadId()+1);
+        buffer->next = free_list;
+        free_list = buffer;
+        PIN_ReleaseLock(&queue_lock);
+
+        buffer = next;
+    }
+}
+
+/*!
+ * Body of the internal writer thread: drain the queue whenever a buffer
+ * is handed over, until the application starts to exit.
+ */
+static VOID WriterThread(VOID * arg)
+{
+    while (!writer_exit)
+    {
+        PIN_SemaphoreTimedWait(&queue_sem, 100);
+        PIN_SemaphoreClear(&queue_sem);
+        DrainQueue();
+    }
+}
+
+/*!
+ * Binary mode: write the file header and start the writer thread.
+ * @return FALSE if the writer thread cannot be started
+ */
+static BOOL StartBinaryTrace()
+{
+    BTRACE_FILE_HEADER header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BTRACE_MAGIC, sizeof(BTRACE_MAGIC));
+    header.abi = SYSCALL_ABI;
+    header.recordSize = sizeof(BTRACE_RECORD);
+    fwrite(&header, sizeof(header), 1, trace);
+
+    writer_exit = false;
+    PIN_SemaphoreInit(&queue_sem);
+    return PIN_SpawnInternalThread(WriterThread, 0, 0, &writer_uid) != INVALID_THREADID;
+}
+
+/*!
+ * -fdstats: forget what was counted so far, but keep the descriptors that
+ * are open, so that a forked child reports only its own I/O.
+ */
+static VOID ResetFdStats()
+{
+    for (size_t fd = 0; fd < fd_table.size(); fd++)
+    {
+        if (!fd_table[fd].open) { continue; }
+
+        FD_INFO info = FD_INFO();
+        info.open = true;
+        info.fd = fd_table[fd].fd;
+        info.kind = fd_table[fd].kind;
+        info.cloexec = fd_table[fd].cloexec;
+        info.path = fd_table[fd].path;
+        info.position = fd_table[fd].position;
+        info.next = fd_table[fd].next;
+        fd_table[fd] = info;
+    }
+    fd_retired.clear();
+    path_stats.clear();
+    exec_pending = false;
+}
+
+/*!
+ * -vmap: split the mapping that contains an address, so that one starts
+ * there. The caller holds vm_lock.
+ */
+static VOID VmSplit(ADDRINT addr)
+{
+    map<ADDRINT, REGION>::iterator it = regions.upper_bound(addr);
+    if (it == regions.begin()) { return; }
+    --it;
+    if (it->first < addr && addr < it->second.end)
+    {
+        REGION tail = it->second;
+        it->second.end = addr;
+        regions[addr] = tail;
+    }
+}
+
+/*!
+ * -vmap: remove [lo, hi) from the mappings. The caller holds vm_lock.
+ * @param[in]   now     monotonic time of the call
+ * @param[in]   churn   TRUE if the memory goes away; FALSE if it only moves,
+ *                      which never counts as a short-lived mapping
+ * @return bytes that were mapped in the range
+ */
+static UINT64 VmUnmap(ADDRINT lo, ADDRINT hi, UINT64 now, BOOL churn)
+{
+    UINT64 bytes = 0;
+
+    VmSplit(lo);
+    VmSplit(hi);
+    map<ADDRINT, REGION>::iterator it = regions.lower_bound(lo);
+    while (it != regions.end() && it->first < hi)
+    {
+        UINT64 size = it->second.end - it->first;
+
+        if (it->second.anon)    { vm_anon -= size; }
+        else                    { vm_file -= size; }
+        if (churn && now - it->second.born < VM_SHORT_LIVED)
+        {
+            vm_short++;
+            vm_short_bytes += size;
+            vm_short_sizes[size]++;
+        }
+        bytes += size;
+        regions.erase(it++);
+    }
+    return bytes;
+}
+
+/*!
+ * -vmap: add the mapping [lo, hi), replacing whatever was mapped there.
+ * The caller holds vm_lock.
+ * @return bytes that were mapped in the range before
+ */
+static UINT64 VmMap(ADDRINT lo, ADDRINT hi, UINT32 prot, BOOL anon, UINT64 born, UINT64 now)
+{
+    UINT64 replaced = VmUnmap(lo, hi, now, TRUE);
+    REGION region = { hi, prot, anon, born };
+
+    regions[lo] = region;
+    if (anon)   { vm_anon += hi - lo; }
+    else        { vm_file += hi - lo; }
+    return replaced;
+}
+
+/*!
+ * -vmap: change the protection of the mappings in [lo, hi). The caller holds vm_lock.
+ */
+static VOID VmProtect(ADDRINT lo, ADDRINT hi, UINT32 prot)
+{
+    VmSplit(lo);
+    VmSplit(hi);
+    for (map<ADDRINT, REGION>::iterator it = regions.lower_bound(lo); it != regions.end() && it->first < hi; ++it)
+    {
+        it->second.prot = prot;
+    }
+}
+
+/*!
+ * -vmap: print one row of the timeline with the state of the address space
+ * and what changed since the previous row, then start the next interval.
+ * The caller holds vm_lock.
+ * @param[in]   now     monotonic time of the row
+ */
+static VOID PrintVmRow(UINT64 now)
+{
+    UINT64 heap = heap_end - heap_start;
+    UINT64 churn = vm_mapped + vm_unmapped;
+    double seconds = (now - vm_last_ns) / 1e9;
+
+    if (vm_rows++ == 0)
+    {
+        fprintf(trace, "#  time ms   mapped KB     anon KB     file KB     heap KB  mappings"
+                       "   mmap munmap mremap  mprot    brk    churn KB  churn KB/s\n");
+    }
+    fprintf(trace, "%10llu %11llu %11llu %11llu %11llu %9lu %6llu %6llu %6llu %6llu %6llu %11llu %11.0f\n",
+        (unsigned long long)((now - vm_start_ns) / 1000000),
+        (unsigned long long)((vm_anon + vm_file + heap) >> 10),
+        (unsigned long long)(vm_anon >> 10), (unsigned long long)(vm_file >> 10),
+        (unsigned long long)(heap >> 10), (unsigned long)regions.size(),
+        (unsigned long long)vm_calls[VM_MMAP], (unsigned long long)vm_calls[VM_MUNMAP],
+        (unsigned long long)vm_calls[VM_MREMAP], (unsigned long long)vm_calls[VM_MPROTECT],
+        (unsigned long long)vm_calls[VM_BRK],
+        (unsigned long long)(churn >> 10), seconds > 0 ? (churn >> 10) / seconds : 0.0);
+
+    memset(vm_calls, 0, sizeof(vm_calls));
+    vm_mapped = 0;
+    vm_unmapped = 0;
+    vm_last_ns = now;
+}
+
+/*!
+ * -vmap: print the last row of the timeline, then a report of the mappings
+ * still live, the churn over the whole run and the mappings that were
+ * unmapped almost as soon as they were made.
+ */
+static VOID PrintVmReport()
+{
+    static const char * prots[] = { "---", "r--", "-w-", "rw-", "--x", "r-x", "-wx", "rwx" };
+    UINT64 now = NowNs();
+    UINT64 byProt[8] = { 0 };
+    double seconds = (now - vm_start_ns) / 1e9;
+
+    PrintVmRow(now);
+
+    for (map<ADDRINT, REGION>::iterator it = regions.begin(); it != regions.end(); ++it)
+    {
+        byProt[it->second.prot & 7] += it->second.end - it->first;
+    }
+    byProt[PROT_READ | PROT_WRITE] += heap_end - heap_start;
+
+    fprintf(trace, "\nMapped at exit: %llu KB in %lu mappings (%llu KB anonymous, %llu KB file, %llu KB heap), "
+                   "peak %llu KB\n",
+        (unsigned long long)((vm_anon + vm_file + heap_end - heap_start) >> 10), (unsigned long)regions.size(),
+        (unsigned long long)(vm_anon >> 10), (unsigned long long)(vm_file >> 10),
+        (unsigned long long)((heap_end - heap_start) >> 10), (unsigned long long)(vm_peak >> 10));
+    fprintf(trace, "By protection:");
+    for (UINT32 p = 0; p < 8; p++)
+    {
+        if (byProt[p] != 0) { fprintf(trace, " %s %llu KB", prots[p], (unsigned long long)(byProt[p] >> 10)); }
+    }
+    fprintf(trace, "\nCalls: %llu mmap, %llu munmap, %llu mremap, %llu mprotect, %llu brk\n",
+        (unsigned long long)vm_total_calls[VM_MMAP], (unsigned long long)vm_total_calls[VM_MUNMAP],
+        (unsigned long long)vm_total_calls[VM_MREMAP], (unsigned long long)vm_total_calls[VM_MPROTECT],
+        (unsigned long long)vm_total_calls[VM_BRK]);
+    fprintf(trace, "Churn: %llu KB mapped and %llu KB unmapped in %.3f s, %.0f KB/s\n",
+        (unsigned long long)(vm_total_mapped >> 10), (unsigned long long)(vm_total_unmapped >> 10), seconds,
+        seconds > 0 ? ((vm_total_mapped + vm_total_unmapped) >> 10) / seconds : 0.0);
+
+    fprintf(trace, "\nFindings:\n");
+    if (vm_short != 0)
+    {
+        map<UINT64, UINT64>::iterator common = vm_short_sizes.begin();
+        for (map<UINT64, UINT64>::iterator it = vm_short_sizes.begin(); it != vm_short_sizes.end(); ++it)
+        {
+            if (it->second > common->second) { common = it; }
+        }
+        fprintf(trace, "  %llu mappings (%llu KB) were unmapped within %llu ms of being made, "
+                       "%llu of them of %llu KB: consider keeping and reusing them\n",
+            (unsigned long long)vm_short, (unsigned long long)(vm_short_bytes >> 10),
+            VM_SHORT_LIVED / 1000000, (unsigned long long)common->second, (unsigned long long)(common->first >> 10));
+    }
+}
+
+/*!
+ * -vmap: forget the counters but keep the mappings, which a forked child
+ * inherits, so that the child's timeline starts at zero.
+ */
+static VOID ResetVm()
+{
+    memset(vm_calls, 0, sizeof(vm_calls));
+    memset(vm_total_calls, 0, sizeof(vm_total_calls));
+    vm_mapped = vm_unmapped = 0;
+    vm_total_mapped = vm_total_unmapped = 0;
+    vm_short = vm_short_bytes = 0;
+    vm_short_sizes.clear();
+    vm_peak = vm_anon + vm_file + heap_end - heap_start;
+    vm_start_ns = vm_last_ns = NowNs();
+    vm_rows = 0;
+}
+
+/*!
+ * -vmap: body of the timer thread, which prints a row of the timeline every
+ * -vmap milliseconds, whether the application makes calls or not, until
+ * the application starts to exit.
+ */
+static VOID VmTimer(VOID * arg)
+{
+    while (!vm_exit)
+    {
+        PIN_Sleep(KnobVmap < VM_POLL_MS ? KnobVmap.Value() : VM_POLL_MS);
+
+        PIN_GetLock(&vm_lock, PIN_ThreadId()+1);
+        UINT64 now = NowNs();
+        if (!vm_exit && now - vm_last_ns >= (UINT64)KnobVmap.Value() * 1000000)
+        {
+            PrintVmRow(now);
+            fflush(trace);
+        }
+        PIN_ReleaseLock(&vm_lock);
+    }
+}
+
+/*!
+ * -vmap: start the timer thread; again in the child of a fork, which has
+ * no internal threads.
+ * @return FALSE if the thread cannot be started
+ */
+static BOOL StartVmTimer()
+{
+    vm_exit = false;
+    return PIN_SpawnInternalThread(VmTimer, 0, 0, &vm_uid) != INVALID_THREADID;
+}
+
+/* ===================================================================== */
+// Analysis routines
+/* ===================================================================== */
+
+/*!
+ * Append the memory referenced by one argument to the payload of a record.
+ * Buffers are cut to the -s limit.
+ * @param[in]   rec     record under construction
+ * @param[in]   arg     index of the argument
+ * @param[in]   addr    address of the memory in the application
+ * @param[in]   size    length of a buffer, ignored for strings
+ * @param[in]   string  TRUE if the memory is a NUL-terminated string
+ */
+static VOID AddItem(BTRACE_RECORD * rec, UINT32 arg, ADDRINT addr, size_t size, BOOL string)
+{
+    size_t room = BTRACE_MAX_PAYLOAD - rec->payload;
+
+    if (addr == 0 || room <= sizeof(BTRACE_ITEM)) { return; }
+    room -= sizeof(BTRACE_ITEM);
+
+    BTRACE_ITEM * item = reinterpret_cast<BTRACE_ITEM *>(reinterpret_cast<char *>(rec + 1) + rec->payload);
+    char * data = reinterpret_cast<char *>(item + 1);
+
+    item->arg = arg;
+    item->flags = 0;
+
+    if (string)
+    {
+        size_t max = room < BTRACE_MAX_STRING ? room : BTRACE_MAX_STRING;
+        item->len = BtraceCopyString(data, addr, max, &item->flags);
+    }
+    else
+    {
+        size_t max = room < KnobStringSize.Value() ? room : KnobStringSize.Value();
+        if (size > max) { item->flags |= BTRACE_TRUNCATED; size = max; }
+        item->len = PIN_SafeCopy(data, reinterpret_cast<VOID *>(addr), size);
+        if (item->len < size) { item->flags |= BTRACE_FAULT; }
+    }
+
+    rec->payload += sizeof(BTRACE_ITEM) + item->len;
+}
+
+/*!
+ * Append a complete data buffer to the payload file and add a reference to
+ * it to the payload of a record. The buffer is copied in chunks, so a large
+ * read costs no more memory than a small one.
+ * @param[in]   rec         record under construction
+ * @param[in]   arg         index of the argument
+ * @param[in]   addr        address of the buffer in the application
+ * @param[in]   size        bytes to save
+ * @param[in]   threadid    Pin id of the calling thread
+ */
+static VOID SavePayload(BTRACE_RECORD * rec, UINT32 arg, ADDRINT addr, size_t size, THREADID threadid)
+{
+    size_t room = BTRACE_MAX_PAYLOAD - rec->payload;
+
+    if (room < sizeof(BTRACE_ITEM) + sizeof(BTRACE_PAYLOAD_REF)) { return; }
+
+    BTRACE_ITEM * item = reinterpret_cast<BTRACE_ITEM *>(reinterpret_cast<char *>(rec + 1) + rec->payload);
+    BTRACE_PAYLOAD_REF ref;
+    char chunk[4096];
+
+    item->arg = arg;
+    item->flags = BTRACE_EXTERNAL;
+    item->len = sizeof(BTRACE_PAYLOAD_REF);
+
+    PIN_GetLock(&payload_lock, threadid+1);
+    ref.offset = payload_offset;
+    ref.size = 0;
+    while (ref.size < size)
+    {
+        size_t want = size - ref.size < sizeof(chunk) ? size - ref.size : sizeof(chunk);
+        size_t copied = PIN_SafeCopy(chunk, reinterpret_cast<VOID *>(addr + ref.size), want);
+
+        fwrite(chunk, 1, copied, payload);
+        ref.size += copied;
+        if (copied < want) { item->flags |= BTRACE_FAULT; break; }
+    }
+    payload_offset += ref.size;
+    PIN_ReleaseLock(&payload_lock);
+
+    memcpy(item + 1, &ref, sizeof(ref));
+    rec->payload += sizeof(BTRACE_ITEM) + item->len;
+}
+
+/*!
+ * Emit the completed record of a thread: print it in text mode, or append
+ * it to the thread's buffer in binary mode.
+ */
+static VOID EmitRecord(SYSCALL_STATE * state, THREADID threadid)
+{
+    SELFPROF_CALL_SCOPE(prof_emit);
+    BTRACE_RECORD * rec = state->Record();
+
+    if (KnobBinary)
+    {
+        size_t size = BtraceRecordSize(rec);
+        if (state->buffer->used + size > buffer_size)
+        {
+            QueueBuffer(state->buffer);
+            state->buffer = GetBuffer();
+        }
+        memcpy(state->buffer->data + state->buffer->used, rec, size);
+        state->buffer->used += size;
+        return;
+    }
+
+    const SYSCALL_DESC * desc = Lookup(rec->num);
+
+    PIN_GetLock(&lock, threadid+1);
+    BtracePrintCall(trace, desc, rec, SYSCALL_ABI);
+    BtracePrintReturn(trace, desc, rec, SYSCALL_ABI);
+    fputc('\n', trace);
+    PIN_ReleaseLock(&lock);
+}
+
+/*!
+ * Account one call in a set of counters.
+ * @param[in]   stats   counters of the system call
+ * @param[in]   ret     raw return value
+ * @param[in]   cycles  latency from entry to exit
+ */
+static VOID AddSample(SYSCALL_STATS * stats, ADDRINT ret, UINT64 cycles)
+{
+    ADDRDELTA sret = (ADDRDELTA)ret;
+    UINT32 bucket = cycles == 0 ? 0 : 64 - __builtin_clzll(cycles);
+
+    stats->calls++;
+    if (sret < 0 && sret >= -4095) { stats->errors++; }
+    stats->cycles += cycles;
+    if (cycles > stats->maxCycles) { stats->maxCycles = cycles; }
+    stats->hist[bucket < HIST_BUCKETS ? bucket : HIST_BUCKETS - 1]++;
+}
+
+/*!
+ * Summary mode: account one call in the counters of its thread.
+ * @param[in]   state   state of the calling thread
+ * @param[in]   num     system call number
+ * @param[in]   ret     raw return value
+ * @param[in]   cycles  latency from entry to exit
+ */
+static VOID CountSyscall(SYSCALL_STATE * state, ADDRINT num, ADDRINT ret, UINT64 cycles)
+{
+    AddSample(&state->stats[Slot(num)], ret, cycles);
+}
+
+/*!
+ * -callsites: walk the application stack at a system call and intern the
+ * backtrace in the call-site table.
+ * @param[in]   ctx         application context at the system call
+ * @param[in]   threadid    Pin id of the calling thread
+ * @return index of the call site in sites
+ */
+static UINT32 InternSite(const CONTEXT * ctx, THREADID threadid)
+{
+    void * frames[MAX_DEPTH];
+    UINT32 depth = KnobDepth.Value() < MAX_DEPTH ? KnobDepth.Value() : MAX_DEPTH;
+    int n = PIN_Backtrace(ctx, frames, depth);
+
+    vector<ADDRINT> key;
+    for (int i = 0; i < n; i++) { key.push_back(reinterpret_cast<ADDRINT>(frames[i])); }
+
+    PIN_GetLock(&site_lock, threadid+1);
+    map<vector<ADDRINT>, UINT32>::iterator it = site_index.find(key);
+    UINT32 site;
+    if (it != site_index.end())
+    {
+        site = it->second;
+    }
+    else
+    {
+        site = sites.size();
+        site_index[key] = site;
+        sites.push_back(CALL_SITE());
+        sites.back().frames = key;
+        sites.back().calls = 0;
+        sites.back().cycles = 0;
+    }
+    PIN_ReleaseLock(&site_lock);
+    return site;
+}
+
+/*!
+ * -callsites: account a completed call to the site it was made from.
+ */
+static VOID CountSite(UINT32 site, ADDRINT num, ADDRINT ret, UINT64 cycles, THREADID threadid)
+{
+    PIN_GetLock(&site_lock, threadid+1);
+    sites[site].calls++;
+    sites[site].cycles += cycles;
+    AddSample(&sites[site].bySlot[Slot(num)], ret, cycles);
+    PIN_ReleaseLock(&site_lock);
+}
+
+/*!
+ * -fdstats: apply a completed call to the descriptors it created, used or
+ * closed, and to the path it opened or looked at.
+ * @param[in]   rec         record of the call, return value included
+ * @param[in]   cycles      latency from entry to exit
+ * @param[in]   threadid    Pin id of the calling thread
+ */
+static VOID TrackFd(const BTRACE_RECORD * rec, UINT64 cycles, THREADID threadid)
+{
+    UINT32 slot = Slot(rec->num);
+    UINT8 op = fd_ops[slot];
+    const SYSCALL_DESC * desc = Lookup(rec->num);
+    BOOL failed = rec->ret < 0 && rec->ret >= -4095;
+    BOOL cloexec = fd_flags_arg[slot] >= 0 && (rec->args[fd_flags_arg[slot]] & O_CLOEXEC) != 0;
+    FD_INFO * info = 0;
+    int pair[2];
+
+    // A bad descriptor number says nothing about the descriptors in use.
+    if (op == FD_OP_NONE || rec->ret == -EBADF) { return; }
+
+    PIN_GetLock(&fd_lock, threadid+1);
+    switch (op)
+    {
+      case FD_OP_OPEN:
+        path_stats[RecordPath(rec, desc)].opens++;
+        if (!failed) { info = FdOpen(rec->ret, FD_KIND_FILE, RecordPath(rec, desc), cloexec); }
+        break;
+      case FD_OP_STAT:
+        path_stats[RecordPath(rec, desc)].stats++;
+        break;
+      case FD_OP_SOCKET:
+        if (!failed) { info = FdOpen(rec->ret, FD_KIND_SOCKET, desc->name, cloexec); }
+        break;
+      case FD_OP_PIPE:
+      case FD_OP_PAIR:
+        // The new descriptors are stored in an int[2] of the application.
+        if (!failed && PIN_SafeCopy(pair, reinterpret_cast<VOID *>(rec->args[op == FD_OP_PIPE ? 0 : 3]),
+                                    sizeof(pair)) == sizeof(pair))
+        {
+            UINT32 kind = op == FD_OP_PIPE ? FD_KIND_PIPE : FD_KIND_SOCKET;
+            FdOpen(pair[0], kind, desc->name, cloexec);
+            info = FdOpen(pair[1], kind, desc->name, cloexec);
+        }
+        break;
+      case FD_OP_DUP:
+      case FD_OP_DUP2:
+      case FD_OP_FCNTL:
+        if (op == FD_OP_FCNTL && rec->args[1] == F_SETFD)
+        {
+            info = FdEntry(rec->args[0]);
+            if (info != 0 && !failed) { info->cloexec = (rec->args[2] & FD_CLOEXEC) != 0; }
+        }
+        else if (op != FD_OP_FCNTL || rec->args[1] == F_DUPFD || rec->args[1] == F_DUPFD_CLOEXEC)
+        {
+            if (failed || (op == FD_OP_DUP2 && rec->args[0] == rec->args[1])) { break; }
+
+            // Copy what is needed before FdOpen() may grow the table.
+            info = FdEntry(rec->args[0]);
+            if (info == 0) { break; }
+            UINT32 kind = info->kind;
+            string path = info->path;
+            if (op == FD_OP_DUP2) { FdClose(rec->ret, desc->name); }
+            if (op == FD_OP_FCNTL) { cloexec = rec->args[1] == F_DUPFD_CLOEXEC; }
+            info = FdOpen(rec->ret, kind, path, cloexec);
+        }
+        else
+        {
+            info = FdEntry(rec->args[0]);
+            if (info != 0) { info->others++; }
+        }
+        break;
+      case FD_OP_CLOSE:
+        // Linux releases the descriptor even when close fails, unless it was not open.
+        info = FdEntry(rec->args[0]);
+        if (info != 0)
+        {
+            info->cycles += cycles;
+            if (failed) { info->errors++; }
+            if (rec->ret != -EBADF) { FdClose(rec->args[0], "close"); }
+            info = 0;
+        }
+        break;
+      case FD_OP_READ:
+      case FD_OP_WRITE:
+      case FD_OP_PREAD:
+      case FD_OP_PWRITE:
+        info = FdEntry(rec->args[0]);
+        if (info == 0) { break; }
+        if (failed) { info->errors++; break; }
+        FdTransfer(info, op == FD_OP_WRITE || op == FD_OP_PWRITE, rec->ret,
+                   op == FD_OP_PREAD || op == FD_OP_PWRITE ? RecordOffset(rec) : -1);
+        break;
+      case FD_OP_SEEK:
+      case FD_OP_LLSEEK:
+        info = FdEntry(rec->args[0]);
+        if (info == 0) { break; }
+        info->seeks++;
+        if (failed) { info->errors++; break; }
+        if (op == FD_OP_SEEK)
+        {
+            info->position = rec->ret;
+        }
+        else
+        {
+            // _llseek stores the new position in a loff_t of the application.
+            UINT64 position;
+            if (PIN_SafeCopy(&position, reinterpret_cast<VOID *>(rec->args[3]), sizeof(position)) == sizeof(position))
+                info->position = position;
+        }
+        break;
+      case FD_OP_EXEC:
+        // A successful exec does not return; a failed one is all we see.
+        exec_pending = false;
+        break;
+      default:
+        info = FdEntry(rec->args[0]);
+        if (info == 0) { break; }
+        info->others++;
+        if (failed) { info->errors++; }
+        break;
+    }
+    if (info != 0) { info->cycles += cycles; }
+    PIN_ReleaseLock(&fd_lock);
+}
+
+/*!
+ * -vmap: apply a completed call that changes the address space to the
+ * mappings. The rows of the timeline are printed by VmTimer().
+ * @param[in]   rec         record of the call, return value included
+ * @param[in]   threadid    Pin id of the calling thread
+ */
+static VOID TrackVm(const BTRACE_RECORD * rec, THREADID threadid)
+{
+    UINT8 op = vm_ops[Slot(rec->num)];
+    BOOL failed = rec->ret < 0 && rec->ret >= -4095;
+    ADDRINT ret = (ADDRINT)rec->ret;
+    UINT64 now = NowNs();
 
-	else if (num == SYS_chdir) 
-  {
-        fprintf(trace, "%s(\"%s\")",
-          syscall_name,
-          (char *)arg0);
-  }
+    PIN_GetLock(&vm_lock, threadid+1);
+    vm_calls[op]++;
+    vm_total_calls[op]++;
 
-	else if (num == SYS_time) 
-  {
-    fprintf(trace,"%s(%ld) = ?\n",
-        syscall_name,
-        (long) arg0);  
-  }
+    // Lengths are rounded up to whole pages, as the kernel does.
+    ADDRINT lo = rec->args[0];
+    ADDRINT hi = lo + ((rec->args[1] + VM_PAGE - 1) & ~(VM_PAGE - 1));
+    UINT64 mapped = 0, unmapped = 0;
 
-	else if (num == SYS_chmod) 
-  {
-        fprintf(trace, "%s(\"%s\", %o)",
-          syscall_name,
-          (char *)arg0,
-					(unsigned int)arg1);
-  }
+    switch (failed ? VM_NONE : op)
+    {
+      case VM_MMAP:
+        {
+            // An anonymous mapping has MAP_ANONYMOUS, or no file to map.
+            BOOL anon = (rec->args[3] & MAP_ANONYMOUS) != 0 || (INT32)rec->args[4] == -1;
+            mapped = hi - lo;
+            unmapped = VmMap(ret, ret + (hi - lo), rec->args[2], anon, now, now);
+        }
+        break;
+      case VM_MUNMAP:
+        unmapped = VmUnmap(lo, hi, now, TRUE);
+        break;
+      case VM_MREMAP:
+        {
+            // The mapping keeps its kind, protection and age wherever it goes.
+            ADDRINT newHi = ret + ((rec->args[2] + VM_PAGE - 1) & ~(VM_PAGE - 1));
+            REGION old = { 0, PROT_READ | PROT_WRITE, TRUE, now };
+            map<ADDRINT, REGION>::iterator it = regions.upper_bound(lo);
+            if (it != regions.begin() && (--it)->second.end > lo) { old = it->second; }
+
+            VmUnmap(lo, hi, now, FALSE);
+            VmMap(ret, newHi, old.prot, old.anon, old.born, now);
+            if (newHi - ret > hi - lo)  { mapped = (newHi - ret) - (hi - lo); }
+            else                        { unmapped = (hi - lo) - (newHi - ret); }
+        }
+        break;
+      case VM_MPROTECT:
+        VmProtect(lo, hi, rec->args[2]);
+        break;
+      case VM_BRK:
+        // brk returns the break, old or new; the first call tells where the heap starts.
+        if (heap_start == 0)        { heap_start = heap_end = ret; }
+        else if (ret > heap_end)    { mapped = ret - heap_end; }
+        else                        { unmapped = heap_end - ret; }
+        if (ret >= heap_start) { heap_end = ret; }
+        break;
+      default:
+        break;
+    }
 
-	else if (num == SYS_stat) 
-  {
-        fprintf(trace, "%s(\"%s\", 0x%lx)",
-          syscall_name,
-          (char *)arg0,
-          (unsigned long)arg1);  
-  }
+    vm_mapped += mapped;
+    vm_unmapped += unmapped;
+    vm_total_mapped += mapped;
+    vm_total_unmapped += unmapped;
+    if (vm_anon + vm_file + heap_end - heap_start > vm_peak) { vm_peak = vm_anon + vm_file + heap_end - heap_start; }
+    PIN_ReleaseLock(&vm_lock);
+}
 
-	else if (num == SYS_getpid) 
-  {
-      fprintf(trace, "%s()",
-       syscall_name);  
-  }
+/*!
+ * -replay_log: write one completed file system call to the replay log as
+ *   <start ns> <tid> <duration ns> <op> <return value> <operands...>
+ * with the operands of each op as documented in btrace-replay.cpp.
+ * @param[in]   state       state of the calling thread
+ * @param[in]   threadid    Pin id of the calling thread
+ */
+static VOID RecordReplay(SYSCALL_STATE * state, THREADID threadid)
+{
+    const BTRACE_RECORD * rec = state->Record();
+    const SYSCALL_DESC * desc = Lookup(rec->num);
+    UINT8 op = replay_ops[Slot(rec->num)];
+    UINT64 end = NowNs();
+    INT32 fd = ArgOfType(desc, 'f');
+    INT32 size = ArgOfType(desc, 'z');
+    INT32 mode = ArgOfType(desc, 'm');
+    INT32 flags = ArgOfType(desc, 'o');
+    INT32 atFlags = ArgOfType(desc, 'x');
+    char line[64];
+
+    // The vectored calls have no size argument; what they moved is the result.
+    UINT64 bytes = size >= 0 ? rec->args[size] : (rec->ret > 0 ? rec->ret : 0);
+    string operands;
+
+    // unlinkat removes a directory with AT_REMOVEDIR.
+    if (op == RP_UNLINK && atFlags >= 0 && (rec->args[atFlags] & AT_REMOVEDIR)) { op = RP_RMDIR; }
+
+    // A call on a directory descriptor that cannot be resolved is left out.
+    string path = ReplayPath(rec, desc);
+    string path2 = op == RP_RENAME ? ReplayPath(rec, desc, 1) : "";
+    BOOL paths = op == RP_OPEN || op == RP_STAT || op == RP_UNLINK || op == RP_MKDIR || op == RP_RMDIR || op == RP_RENAME;
+    if (paths && (path.empty() || (op == RP_RENAME && path2.empty()))) { return; }
+
+    switch (op)
+    {
+      case RP_OPEN:
+        snprintf(line, sizeof(line), " 0x%llx 0%llo",
+            flags >= 0 ? (unsigned long long)rec->args[flags] : (unsigned long long)(O_CREAT | O_WRONLY | O_TRUNC),
+            mode >= 0 ? (unsigned long long)rec->args[mode] & 07777 : 0ULL);
+        operands = " " + EscapePath(path) + line;
+        break;
+      case RP_CLOSE:
+      case RP_FSYNC:
+      case RP_FDATASYNC:
+        operands = " " + decstr((INT32)rec->args[fd]);
+        break;
+      case RP_READ:
+      case RP_WRITE:
+        operands = " " + decstr((INT32)rec->args[fd]) + " " + decstr(bytes);
+        break;
+      case RP_PREAD:
+      case RP_PWRITE:
+        operands = " " + decstr((INT32)rec->args[fd]) + " " + decstr(bytes) + " " + decstr(RecordOffset(rec));
+        break;
+      case RP_LSEEK:
+        operands = " " + decstr((INT32)rec->args[0]) + " " + decstr((INT64)(ADDRDELTA)rec->args[1])
+                 + " " + decstr((INT32)rec->args[2]);
+        break;
+      case RP_FTRUNCATE:
+        operands = " " + decstr((INT32)rec->args[0]) + " " + decstr((INT64)(ADDRDELTA)rec->args[1]);
+        break;
+      case RP_MKDIR:
+        snprintf(line, sizeof(line), " 0%llo", mode >= 0 ? (unsigned long long)rec->args[mode] & 07777 : 0777ULL);
+        operands = " " + EscapePath(path) + line;
+        break;
+      case RP_RENAME:
+        operands = " " + EscapePath(path) + " " + EscapePath(path2);
+        break;
+      default:
+        operands = " " + EscapePath(path);
+        break;
+    }
 
-	else if (num == SYS_setuid) 
-  {
-      fprintf(trace,"%s(%lu)",
-        syscall_name,
-        (unsigned long)arg0); 
-  }
+    PIN_GetLock(&replay_lock, threadid+1);
+    fprintf(replay, "%llu %u %llu %s %lld%s\n", (unsigned long long)state->startNs, state->tid,
+        (unsigned long long)(end - state->startNs), ReplayNames[op], (long long)rec->ret, operands.c_str());
+    PIN_ReleaseLock(&replay_lock);
+}
 
-	else if (num == SYS_getuid) 
-  {
-      fprintf(trace, "%s()",
-       syscall_name);  
-  }
+/*!
+ * Record the number and arguments of a system call, and the strings the
+ * arguments point to.
+ * This function is called by Pin right before the application enters the kernel,
+ * so code that never makes a system call does not pay anything for the trace.
+ * @param[in]   threadid    Pin id of the calling thread
+ * @param[in]   ctx         application context at the system call
+ * @param[in]   std         calling standard used to fetch number and arguments
+ * @param[in]   v           value specified in PIN_AddSyscallEntryFunction
+ */
+VOID SysBefore (THREADID threadid, CONTEXT * ctx, SYSCALL_STANDARD std, VOID * v) {
 
-	else if (num == SYS_access) 
-  {
-        fprintf(trace, "%s(\"%s\", %d)",
-          syscall_name,
-          (char *)arg0,
-          (int)arg1);  
-  }
+  SELFPROF_CALL_SCOPE(prof_before);
 
-	else if (num == SYS_kill) 
-  {
-        fprintf(trace, "%s(\"%ld\", %d)",
-          syscall_name,
-          (long int)arg0,
-          (int)arg1);  
-  }
+  ADDRINT num = PIN_GetSyscallNumber(ctx, std);
 
-	else if (num == SYS_rename) 
-  {
-        fprintf(trace, "%s(\"%s\", \"%s\")",
-          syscall_name,
-          (char *)arg0,
-          (char *)arg1);  
-  }
+  // Calls left out by -e cost nothing more than this check; the exit
+  // callback sees no pending call and returns at once.
+  if (!Selected(num)) { return; }
 
-	else if (num == SYS_mkdir) 
-  {
-        fprintf(trace, "%s(\"%s\", %o)",
-          syscall_name,
-          (char *)arg0,
-          (unsigned int)arg1);  
-  }
+  SYSCALL_STATE * state = static_cast<SYSCALL_STATE *>(PIN_GetThreadData(tls_key, threadid));
+  BTRACE_RECORD * rec = state->Record();
 
-	else if (num == SYS_rmdir) 
-  {
-        fprintf(trace, "%s(\"%s\")",
-          syscall_name,
-          (char *)arg0);  
-  }
+  rec->num = num;
 
-	else if (num == SYS_brk) 
+  // Only calls that pass the filter pay for the stack walk.
+  if (KnobCallSites)
   {
-        fprintf(trace, "%s(0x%lx)",
-          syscall_name,
-          (unsigned long)arg0);  
+    state->site = InternSite(ctx, threadid);
+    const SYSCALL_DESC * desc = Lookup(num);
+    if (desc != 0 && desc->ret == 'n') { CountSite(state->site, num, 0, 0, threadid); }
   }
 
-	else if (num == SYS_chroot)
+  // -vmap needs the arguments of the calls that change the address space
+  // only; the others are not captured, unless the replay log wants them.
+  if (KnobVmap != 0 && vm_ops[Slot(num)] == VM_NONE && (replay == 0 || replay_ops[Slot(num)] == RP_NONE))
   {
-        fprintf(trace, "%s(\"%s\")",
-          syscall_name,
-          (char *)arg0);
+    const SYSCALL_DESC * desc = Lookup(num);
+    if (KnobCallSites && (desc == 0 || desc->ret != 'n'))
+    {
+      state->pending = true;
+      rec->tsc = ReadTsc();
+    }
+    return;
   }
 
-  else if (num == SYS_reboot)
+  // The summary needs nothing but the number and the entry time.
+  if (KnobSummary)
   {
-        fprintf(trace, "%s(\"%d\")",
-          syscall_name,
-          (int)arg0);
+    const SYSCALL_DESC * desc = Lookup(rec->num);
+    if (desc != 0 && desc->ret == 'n')
+    {
+      CountSyscall(state, rec->num, 0, 0);
+      return;
+    }
+    state->pending = true;
+    rec->tsc = ReadTsc();
+    return;
   }
 
-  else if (num == SYS_mprotect)
-  {
-    fprintf(trace,"%s(0x%lx, %lu, %lu)",
-        syscall_name,
-        (unsigned long)arg0,
-        (unsigned long)arg1,
-        (unsigned long)arg2);
-  }
+  if (replay != 0) { state->startNs = NowNs(); }
+  rec->tsc = ReadTsc();
+  rec->tid = state->tid;
+  rec->ret = 0;
+  rec->payload = 0;
+  rec->flags = 0;
 
-  else if (num == SYS_chown)
+  for (UINT32 i = 0; i < BTRACE_MAX_ARGS; i++)
   {
-        fprintf(trace, "%s(\"%s\", %lu, %lu)",
-          syscall_name,
-          (char *)arg0,
-          (unsigned long)arg1,
-          (unsigned long)arg2);
+    rec->args[i] = PIN_GetSyscallArgument(ctx, std, i);
   }
 
-  else if (num == SYS_mmap2)
+#if defined(TARGET_IA32)
+  // The old i386 mmap passes a pointer to a block holding the six arguments.
+	if (rec->num == SYS_mmap)
   {
-        fprintf(trace, "%s(0x%lx, %u, %d, %d, %d)",
-          syscall_name,
-          (unsigned long)arg0,
-          (unsigned int)arg1,
-          (int)arg2,
-          (int)arg3,
-          (int)arg4//,
-          // (unsigned long)arg5
-          );
-
+    ADDRINT block[BTRACE_MAX_ARGS];
+    if (PIN_SafeCopy(block, reinterpret_cast<VOID *>(rec->args[0]), sizeof(block)) == sizeof(block))
+    {
+      for (UINT32 i = 0; i < BTRACE_MAX_ARGS; i++) { rec->args[i] = block[i]; }
+    }
   }
+#endif
 
-  else if (num == SYS_exit_group)
-  {
-    fprintf(trace,"%s(%ld) = ?\n",
-        syscall_name,
-        (long) arg0);
-  }
+  const SYSCALL_DESC * desc = Lookup(rec->num);
 
-  else if (num == SYS_fstat || num == SYS_fstat64)
+  // Data buffers are left to SysAfter: the kernel has not filled a read
+  // buffer yet, and only the returned count tells how much of it is valid.
+  if (desc != 0)
   {
-    fprintf(trace, "%s(%d, 0x%lx)",
-      syscall_name,
-      (int)arg0,
-      (unsigned long)arg1);
+    for (UINT32 i = 0; desc->args[i] != '\0'; i++)
+    {
+      if (desc->args[i] == 's')
+      {
+        AddItem(rec, i, rec->args[i], 0, TRUE);
+      }
+    }
   }
 
-  else if (num == SYS_getdents || num == SYS_getdents64)
-  {
-    fprintf(trace, "%s(%lu, 0x%lx, %lu)",
-      syscall_name,
-      (unsigned long)arg0,
-      (unsigned long)arg1,
-      (unsigned long)arg2);
-  }
+  // Assume the exec succeeds until SysAfter learns otherwise.
+  if (KnobFdStats && fd_ops[Slot(rec->num)] == FD_OP_EXEC) { exec_pending = true; }
 
-  else if (num == SYS_ioctl)
+  // Calls that do not return never reach SysAfter.
+  if (desc != 0 && desc->ret == 'n')
   {
-    fprintf(trace, "%s(%d, %lu, 0x%lx)",
-      syscall_name,
-      (int)arg0,
-      (unsigned long)arg1,
-      (unsigned long)arg2);
+    rec->flags |= BTRACE_NORETURN;
+    if (Tracing()) { EmitRecord(state, threadid); }
+    return;
   }
 
-  else {
-		fprintf(trace,"%ld(0x%lx, 0x%lx, 0x%lx, 0x%lx, 0x%lx)",
-        (unsigned long)num,
-        (unsigned long)arg0,
-        (unsigned long)arg1,
-        (unsigned long)arg2,
-        (unsigned long)arg3,
-        (unsigned long)arg4);
-        //(unsigned long)arg5);
-	}
-
-  syscall_encountered_map[threadid] = true;
-  syscall_num_map[threadid] = num;
-
+  state->pending = true;
 }
 
-VOID SysAfter(CONTEXT * ctx, THREADID threadid) {
+/*!
+ * Complete the record started in SysBefore() with the return value and the
+ * data buffers, and emit it. A buffer is kept only as far as the returned
+ * byte count says it was transferred.
+ * This function is called by Pin right after the kernel returns to the application.
+ * @param[in]   threadid    Pin id of the calling thread
+ * @param[in]   ctx         application context after the system call
+ * @param[in]   std         calling standard used to fetch the return value
+ * @param[in]   v           value specified in PIN_AddSyscallExitFunction
+ */
+VOID SysAfter(THREADID threadid, CONTEXT * ctx, SYSCALL_STANDARD std, VOID * v) {
 
-  ADDRINT eax = (ADDRINT) PIN_GetContextReg(ctx, LEVEL_BASE::REG_EAX);
+  SELFPROF_CALL_SCOPE(prof_after);
 
-  if (!syscall_encountered_map[threadid]) { return; }
+  SYSCALL_STATE * state = static_cast<SYSCALL_STATE *>(PIN_GetThreadData(tls_key, threadid));
 
-  ADDRINT num = syscall_num_map[threadid];
-	syscall_encountered_map[threadid] = false;
+  if (!state->pending) { return; }
+	state->pending = false;
 
-	if (num == SYS_exit)
+  if (KnobCallSites)
   {
-		return;
+    CountSite(state->site, state->Record()->num, PIN_GetSyscallReturn(ctx, std),
+              ReadTsc() - state->Record()->tsc, threadid);
   }
 
-  else if (num == SYS_fork)
+  if (KnobSummary)
   {
-		fprintf(trace," = %u\n", (unsigned int)eax);
+    UINT64 cycles = ReadTsc() - state->Record()->tsc;
+    CountSyscall(state, state->Record()->num, PIN_GetSyscallReturn(ctx, std), cycles);
+    return;
   }
 
-  else if (num == SYS_read || num == SYS_write)
-  {
-    if ((int)eax < 0) 
-    {
-    fprintf(trace," = -1 ERROR\n");
-    }
-    else 
-    {
-		fprintf(trace," = %lu\n", (unsigned long)eax);
-    }
-  }
+  BTRACE_RECORD * rec = state->Record();
+  const SYSCALL_DESC * desc = Lookup(rec->num);
 
-  else if (num == SYS_open)
-  {
-		fprintf(trace," = %d\n", (int)eax);
-  }
+  rec->ret = (ADDRDELTA)PIN_GetSyscallReturn(ctx, std);
 
-  else if (num == SYS_close)
-  {
-		fprintf(trace," = %d\n", (int)eax);
-  }
+  if (replay != 0 && replay_ops[Slot(rec->num)] != RP_NONE) { RecordReplay(state, threadid); }
 
-  else if (num == SYS_creat)
+  if (KnobFdStats)
   {
-		fprintf(trace," = %d\n", (int)eax);
+    TrackFd(rec, ReadTsc() - rec->tsc, threadid);
+    return;
   }
 
-  else if (num == SYS_execve)
+  if (KnobVmap != 0)
   {
-		fprintf(trace," = %d\n", (int)eax);
+    if (vm_ops[Slot(rec->num)] != VM_NONE) { TrackVm(rec, threadid); }
+    return;
   }
 
-  else if (num == SYS_chdir)
+  if (desc != 0 && rec->ret > 0)
   {
-		fprintf(trace," = %d\n", (int)eax);
-  }
+    for (UINT32 i = 0; desc->args[i] != '\0' && i + 1 < BTRACE_MAX_ARGS; i++)
+    {
+      if (desc->args[i] != 'b' && desc->args[i] != 'B') { continue; }
 
-  else if (num == SYS_time)
-  {
-		fprintf(trace," = %lu\n", (unsigned long)eax);
+      size_t size = (UINT64)rec->ret < rec->args[i + 1] ? (size_t)rec->ret : (size_t)rec->args[i + 1];
+      if (payload != 0) { SavePayload(rec, i, rec->args[i], size, threadid); }
+      AddItem(rec, i, rec->args[i], size, FALSE);
+    }
   }
 
-  else if (num == SYS_chmod)
-  {
-		fprintf(trace," = %d\n", (int)eax);
-  }
+  EmitRecord(state, threadid);
+}
 
-  else if (num == SYS_stat)
-  {
-		fprintf(trace," = %d\n", (int)eax);
-  }
+/* ===================================================================== */
+// Instrumentation callbacks
+/* ===================================================================== */
 
-  else if (num == SYS_getpid)
-  {
-		fprintf(trace," = %u\n", (unsigned int)eax);
-  }
+/*!
+ * Allocate the system call state of a new thread.
+ * @param[in]   threadid    Pin id of the new thread
+ */
+VOID ThreadStart(THREADID threadid, CONTEXT *ctxt, INT32 flags, VOID *v)
+{
+    SYSCALL_STATE * state = new SYSCALL_STATE();
+    state->pending = false;
+    state->tid = PIN_GetTid();
+    state->buffer = KnobBinary && Tracing() ? GetBuffer() : 0;
+    state->stats = KnobSummary ? new SYSCALL_STATS[NUM_SLOTS]() : 0;
+    PIN_SetThreadData(tls_key, state, threadid);
+
+    PIN_GetLock(&queue_lock, threadid+1);
+    thread_states[threadid] = state;
+    PIN_ReleaseLock(&queue_lock);
+}
 
-  else if (num == SYS_setuid)
-  {
-		fprintf(trace," = %d\n", (int)eax);
-  }
+/*!
+ * Release the system call state of a terminating thread, handing its
+ * last records to the writer thread.
+ * @param[in]   threadid    Pin id of the thread
+ */
+VOID ThreadFini(THREADID threadid, const CONTEXT *ctxt, INT32 code, VOID *v)
+{
+    SYSCALL_STATE * state = static_cast<SYSCALL_STATE *>(PIN_GetThreadData(tls_key, threadid));
 
-  else if (num == SYS_getuid)
-  {
-		fprintf(trace," = %lu\n", (unsigned long)eax);
-  }
+    PIN_GetLock(&queue_lock, threadid+1);
+    thread_states[threadid] = 0;
+    PIN_ReleaseLock(&queue_lock);
 
-  else if (num == SYS_access)
-  {
-    if ((int)eax != 0) 
-    {
-      fprintf(trace," = -1 UNSUCCESSFUL ACCESS\n");  
-    }
-    else
+    if (state->buffer != 0) { QueueBuffer(state->buffer); }
+    if (state->stats != 0)
     {
-		  fprintf(trace," = 0 SUCCESS ACCESS\n");
+        PIN_GetLock(&lock, threadid+1);
+        MergeStats(state->stats);
+        PIN_ReleaseLock(&lock);
+        delete [] state->stats;
     }
-  }
-
-  else if (num == SYS_kill)
-  {
-		fprintf(trace," = %d\n", (int)eax);
-  }
-
-  else if (num == SYS_rename)
-  {
-		fprintf(trace," = %d\n", (int)eax);
-  }
-
-  else if (num == SYS_mkdir)
-  {
-		fprintf(trace," = %d\n", (int)eax);
-  }
-
-  else if (num == SYS_rmdir)
-  {
-		fprintf(trace," = %d\n", (int)eax);
-  }
-
-  else if (num == SYS_brk)
-  {
-		fprintf(trace," = %d\n", (int)eax);
-  }
-
-  else if (num == SYS_chroot)
-  {
-		fprintf(trace," = %d\n", (int)eax);
-  }
+    delete state;
+    PIN_SetThreadData(tls_key, 0, threadid);
+}
 
-  else if (num == SYS_reboot)
-  {
-		fprintf(trace," = %d\n", (int)eax);
-  }
+/*!
+ * Set up the child of a fork as a process of its own. Only the thread that
+ * called fork exists in the child, so the states of the other threads are
+ * dropped and every lock is initialized again: one held by another thread
+ * at the time of the fork would never be released. The child gets its own
+ * output files and starts counting from zero.
+ * @param[in]   threadid    Pin id of the thread that called fork
+ */
+VOID AfterForkInChild(THREADID threadid, const CONTEXT *ctxt, VOID *v)
+{
+    SYSCALL_STATE * self = static_cast<SYSCALL_STATE *>(PIN_GetThreadData(tls_key, threadid));
 
-  else if (num == SYS_mprotect)
-  {
-		fprintf(trace," = %d\n", (int)eax);
-  }
+    PIN_InitLock(&lock);
+    PIN_InitLock(&queue_lock);
+    PIN_InitLock(&payload_lock);
+    PIN_InitLock(&fd_lock);
+    PIN_InitLock(&site_lock);
+    PIN_InitLock(&replay_lock);
+    PIN_InitLock(&vm_lock);
 
-  else if (num == SYS_chown)
-  {
-		fprintf(trace," = %d\n", (int)eax);
-  }
+    for (THREADID i = 0; i < PIN_MAX_THREADS; i++)
+    {
+        SYSCALL_STATE * state = thread_states[i];
+        if (state == 0 || state == self) { continue; }
 
-  else if (num == SYS_mmap2)
-  {
-		fprintf(trace," = 0x%lx\n", (unsigned long)eax);	
-  }
+        if (state->buffer != 0) { delete [] state->buffer->data; delete state->buffer; }
+        delete [] state->stats;
+        delete state;
+        thread_states[i] = 0;
+    }
+    self->tid = PIN_GetTid();
 
-  else if (num == SYS_exit_group)
-  {
-		return;
-  }
+    // Close the parent's files without flushing them: whatever sits in
+    // their stdio buffers belongs to the parent, which writes it itself.
+    if (trace != stderr)
+    {
+        close(fileno(trace));
+        trace = OpenOutput(KnobOutputFile.Value(), KnobBinary ? "wb" : "w", TRUE);
+        if (trace == 0) { ChildOpenFailed(KnobOutputFile.Value()); }
+    }
+    if (payload != 0)
+    {
+        close(fileno(payload));
+        payload = OpenOutput(KnobPayloadFile.Value(), "wb", TRUE);
+        if (payload == 0) { ChildOpenFailed(KnobPayloadFile.Value()); }
+        payload_offset = 0;
+    }
+    if (replay != 0)
+    {
+        close(fileno(replay));
+        replay = OpenOutput(KnobReplayLog.Value(), "w", TRUE);
+        if (replay == 0) { ChildOpenFailed(KnobReplayLog.Value()); }
+    }
 
-  else if (num == SYS_fstat || num == SYS_fstat64)
-  {
-    fprintf(trace," = %d\n", (int)eax);
-  }
+    // Keep the call sites, their indexes may be pending, but not their counters.
+    for (size_t i = 0; i < sites.size(); i++)
+    {
+        sites[i].calls = 0;
+        sites[i].cycles = 0;
+        sites[i].bySlot.clear();
+    }
 
-  else if (num == SYS_ioctl)
-  {
-    fprintf(trace," = %d\n", (int)eax);
-  }
+    if (KnobSummary)
+    {
+        memset(summary, 0, sizeof(summary));
+        memset(self->stats, 0, NUM_SLOTS * sizeof(SYSCALL_STATS));
+    }
+    else if (KnobFdStats)
+    {
+        ResetFdStats();
+    }
+    else if (KnobVmap != 0)
+    {
+        ResetVm();
 
-	else
-	{
-		fprintf(trace," = 0x%lx\n", (unsigned long)eax);
-	}
+        // Internal threads are not copied by fork.
+        if (!StartVmTimer())
+        {
+            cerr << "btrace: cannot start the -vmap timer thread in process " << PIN_GetPid() << endl;
+        }
+    }
+    else if (KnobBinary)
+    {
+        // The queued buffers and the records of this thread are the parent's.
+        TRACE_BUFFER * buffer = full_head;
+        while (buffer != 0)
+        {
+            TRACE_BUFFER * next = buffer->next;
+            delete [] buffer->data;
+            delete buffer;
+            buffer = next;
+        }
+        full_head = 0;
+        full_tail = &full_head;
+        self->buffer->used = 0;
 
-	fflush(trace);
+        // Internal threads are not copied by fork.
+        if (!StartBinaryTrace())
+        {
+            cerr << "btrace: cannot start the writer thread in process " << PIN_GetPid() << endl;
+        }
+    }
 }
-/* ===================================================================== */
-// Instrumentation callbacks
-/* ===================================================================== */
 
 /*!
- * Insert call to the CountBbl() analysis routine before every basic block 
- * of the trace.
- * This function is called every time a new trace is encountered.
- * @param[in]   trace    trace to be instrumented
- * @param[in]   v        value specified by the tool in the TRACE_AddInstrumentFunction
- *                       function call
+ * Let Pin follow the application into a program it executes (needs the
+ * -follow_execv switch of Pin). The new program is traced by a new copy of
+ * the tool, with the same switches and files of its own. The image of this
+ * copy goes away with the exec and Fini never runs in it, so its reports
+ * are written and its traced records flushed here. The reports start from
+ * zero again, as in the child of a fork, in case the exec fails.
+ * @param[in]   child   the process about to be started
+ * @return TRUE to instrument the new program
  */
-VOID Trace(TRACE trace, VOID *v)
+BOOL FollowChild(CHILD_PROCESS child, VOID *v)
 {
-    // Visit every basic block in the trace
-    for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl))
+    THREADID threadid = PIN_ThreadId();
+
+    PIN_GetLock(&lock, threadid+1);
+    if (KnobSummary)
+    {
+        // Threads that are still alive have not merged their counters yet.
+        for (THREADID i = 0; i < PIN_MAX_THREADS; i++)
+        {
+            if (thread_states[i] == 0) { continue; }
+            MergeStats(thread_states[i]->stats);
+            memset(thread_states[i]->stats, 0, NUM_SLOTS * sizeof(SYSCALL_STATS));
+        }
+        PrintSummary();
+        memset(summary, 0, sizeof(summary));
+    }
+    else if (KnobFdStats)
+    {
+        PIN_GetLock(&fd_lock, threadid+1);
+        PrintFdReport();
+        ResetFdStats();
+        PIN_ReleaseLock(&fd_lock);
+    }
+    else if (KnobVmap != 0)
+    {
+        PIN_GetLock(&vm_lock, threadid+1);
+        PrintVmReport();
+        ResetVm();
+        PIN_ReleaseLock(&vm_lock);
+    }
+    if (KnobCallSites)
     {
-        // Insert a call to CountBbl() before every basic bloc, passing the number of instructions
-        BBL_InsertCall(bbl, IPOINT_BEFORE, (AFUNPTR)SysAfter,  IARG_CONTEXT, IARG_THREAD_ID, IARG_END);
+        PIN_GetLock(&site_lock, threadid+1);
+        PrintCallSites(KnobBinary && Tracing() ? stderr : trace);
+        for (size_t i = 0; i < sites.size(); i++)
+        {
+            sites[i].calls = 0;
+            sites[i].cycles = 0;
+            sites[i].bySlot.clear();
+        }
+        PIN_ReleaseLock(&site_lock);
+    }
+    PIN_ReleaseLock(&lock);
 
-        INS ins = BBL_InsTail(bbl);
-        
+    if (KnobBinary && Tracing())
+    {
+        SYSCALL_STATE * self = static_cast<SYSCALL_STATE *>(PIN_GetThreadData(tls_key, threadid));
+        if (self != 0 && self->buffer->used != 0)
+        {
+            QueueBuffer(self->buffer);
+            self->buffer = GetBuffer();
+        }
+        DrainQueue();
+    }
 
-        if ( INS_IsSyscall(ins) ) {
-          // INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)CountSyscall, IARG_END);
-          
-          /*
-					// Arguments and syscall number is only available before
-        	INS_InsertCall(ins, IPOINT_BEFORE, AFUNPTR(SysBefore),
-                       IARG_INST_PTR, IARG_SYSCALL_NUMBER,
-                       IARG_SYSARG_VALUE, 0, IARG_SYSARG_VALUE, 1,
-                       IARG_SYSARG_VALUE, 2, IARG_SYSARG_VALUE, 3,
-                       IARG_SYSARG_VALUE, 4, IARG_SYSARG_VALUE, 5,
-                       IARG_THREAD_ID,
-                       IARG_END);
-          */
-          INS_InsertCall(ins, IPOINT_BEFORE, AFUNPTR(SysBefore),
-                       IARG_INST_PTR, IARG_CONTEXT, IARG_THREAD_ID, IARG_END);
-				}
+    PIN_GetLock(&lock, threadid+1);
+    fflush(trace);
+    PIN_ReleaseLock(&lock);
 
+    if (payload != 0)
+    {
+        PIN_GetLock(&payload_lock, threadid+1);
+        fflush(payload);
+        PIN_ReleaseLock(&payload_lock);
+    }
+    if (replay != 0)
+    {
+        PIN_GetLock(&replay_lock, threadid+1);
+        fflush(replay);
+        PIN_ReleaseLock(&replay_lock);
     }
+    return TRUE;
+}
+
+/*!
+ * Ask the writer thread to finish before Pin waits for internal threads.
+ * @param[in]   v               value specified by the tool in the 
+ *                              PIN_AddPrepareForFiniFunction function call
+ */
+VOID PrepareForFini(VOID *v)
+{
+    writer_exit = true;
+    PIN_SemaphoreSet(&queue_sem);
 }
 
+/*!
+ * -vmap: stop the timer thread before Pin waits for internal threads.
+ * @param[in]   v               value specified by the tool in the
+ *                              PIN_AddPrepareForFiniFunction function call
+ */
+VOID VmPrepareForFini(VOID *v)
+{
+    vm_exit = true;
+}
 
 /*!
  * Print out analysis results.
@@ -649,8 +2229,63 @@ VOID Trace(TRACE trace, VOID *v)
  */
 VOID Fini(INT32 code, VOID *v)
 {
+    if (KnobSummary)
+    {
+        // Threads that are still alive have not merged their counters yet.
+        for (THREADID i = 0; i < PIN_MAX_THREADS; i++)
+        {
+            if (thread_states[i] != 0) { MergeStats(thread_states[i]->stats); }
+        }
+        PrintSummary();
+    }
+    else if (KnobFdStats)
+    {
+        PrintFdReport();
+    }
+    else if (KnobVmap != 0)
+    {
+        // At -detach_after or -detach_file the timer thread is still running.
+        vm_exit = true;
+        PIN_WaitForThreadTermination(vm_uid, PIN_INFINITE_TIMEOUT, 0);
+        PrintVmReport();
+    }
+    else if (KnobBinary)
+    {
+        PIN_WaitForThreadTermination(writer_uid, PIN_INFINITE_TIMEOUT, 0);
+
+        // Threads that are still alive have not handed over their last buffer.
+        for (THREADID i = 0; i < PIN_MAX_THREADS; i++)
+        {
+            if (thread_states[i] != 0 && thread_states[i]->buffer->used != 0)
+            {
+                QueueBuffer(thread_states[i]->buffer);
+                thread_states[i]->buffer = GetBuffer();
+            }
+        }
+        DrainQueue();
+    }
+    else
+    {
 		fprintf(trace,"#eof\n");
+    }
+
+    // The binary trace has no room for text.
+    if (KnobCallSites) { PrintCallSites(KnobBinary && Tracing() ? stderr : trace); }
+    fputs(SelfProfReport().c_str(), KnobBinary && Tracing() ? stderr : trace);
+
 		fclose(trace);
+    if (payload != 0) { fclose(payload); }
+    if (replay != 0) { fclose(replay); }
+}
+
+/*!
+ * Fini at -detach_after or -detach_file: the writer thread has to be told
+ * to stop, as it is at exit.
+ */
+VOID DetachFini(INT32 code, VOID *v)
+{
+    if (KnobBinary && Tracing()) { PrepareForFini(v); }
+    Fini(code, v);
 }
 /*!
  * The main procedure of the tool.
@@ -661,6 +2296,9 @@ VOID Fini(INT32 code, VOID *v)
  */
 int main(int argc, char *argv[])
 {
+    // Symbols name the call sites of -callsites.
+    PIN_InitSymbols();
+
     // Initialize PIN library. Print help message if -h(elp) is specified
     // in the command line or the command line is invalid 
     if( PIN_Init(argc,argv) )
@@ -668,21 +2306,122 @@ int main(int argc, char *argv[])
         return Usage();
     }
 
-    _dummy = true;
     string fileName = KnobOutputFile.Value();
 
-    if (!fileName.empty()) { 
-			// out = new std::ofstream(fileName.c_str());
-			trace = fopen(fileName.c_str(), "w");
-		}
+    if (!ParseFilter(KnobFilter.Value()))
+    {
+        return Usage();
+    }
+
+    if ((KnobSummary ? 1 : 0) + (KnobFdStats ? 1 : 0) + (KnobVmap != 0 ? 1 : 0) > 1)
+    {
+        cerr << "btrace: only one of -summary, -fdstats and -vmap can be used" << endl;
+        return Usage();
+    }
+
+    if (KnobSummary && !KnobReplayLog.Value().empty())
+    {
+        cerr << "btrace: -summary and -replay_log cannot be used together" << endl;
+        return Usage();
+    }
+
+    if (KnobBinary && fileName.empty())
+    {
+        cerr << "btrace: -binary needs an output file (-o)" << endl;
+        return Usage();
+    }
+
+    if (!fileName.empty())
+    {
+        trace = OpenOutput(fileName, KnobBinary ? "wb" : "w", FALSE);
+        if (trace == 0)
+        {
+            cerr << "btrace: cannot open " << fileName << endl;
+            return 1;
+        }
+    }
+
+    if (!KnobPayloadFile.Value().empty() && Tracing())
+    {
+        payload = OpenOutput(KnobPayloadFile.Value(), "wb", FALSE);
+        if (payload == 0)
+        {
+            cerr << "btrace: cannot open " << KnobPayloadFile.Value() << endl;
+            return 1;
+        }
+    }
+
+    if (!KnobReplayLog.Value().empty())
+    {
+        replay = OpenOutput(KnobReplayLog.Value(), "w", FALSE);
+        if (replay == 0)
+        {
+            cerr << "btrace: cannot open " << KnobReplayLog.Value() << endl;
+            return 1;
+        }
+    }
 
     if (KnobCount)
     {
-        // Register function to be called to instrument traces
-        TRACE_AddInstrumentFunction(Trace, 0);
-        
+        PIN_InitLock(&lock);
+        PIN_InitLock(&queue_lock);
+        PIN_InitLock(&payload_lock);
+        PIN_InitLock(&fd_lock);
+        PIN_InitLock(&site_lock);
+        PIN_InitLock(&replay_lock);
+        PIN_InitLock(&vm_lock);
+        InitCallTables();
+        vm_start_ns = vm_last_ns = NowNs();
+        SelfProfInit();
+        prof_before = SelfProfKind("SysBefore");
+        prof_after = SelfProfKind("SysAfter");
+        prof_emit = SelfProfKind("EmitRecord (output)");
+        prof_drain = SelfProfKind("DrainQueue (writer)");
+        tls_key = PIN_CreateThreadDataKey(0);
+
+        PIN_AddThreadStartFunction(ThreadStart, 0);
+        PIN_AddThreadFiniFunction(ThreadFini, 0);
+
+        // Register functions to be called around every system call
+        PIN_AddSyscallEntryFunction(SysBefore, 0);
+        PIN_AddSyscallExitFunction(SysAfter, 0);
+
+        // Follow the application across fork and exec.
+        PIN_AddForkFunction(FPOINT_AFTER_IN_CHILD, AfterForkInChild, 0);
+        PIN_AddFollowChildProcessFunction(FollowChild, 0);
+
+        if (KnobBinary && Tracing())
+        {
+            // A buffer must hold at least one record with a full payload.
+            buffer_size = (size_t)KnobBufferSize.Value() * 1024;
+            if (buffer_size < sizeof(BTRACE_RECORD) + BTRACE_MAX_PAYLOAD + 8)
+                buffer_size = sizeof(BTRACE_RECORD) + BTRACE_MAX_PAYLOAD + 8;
+
+            if (!StartBinaryTrace())
+            {
+                cerr << "btrace: cannot start the writer thread" << endl;
+                return 1;
+            }
+            PIN_AddPrepareForFiniFunction(PrepareForFini, 0);
+        }
+
+        if (KnobVmap != 0)
+        {
+            if (!StartVmTimer())
+            {
+                cerr << "btrace: cannot start the -vmap timer thread" << endl;
+                return 1;
+            }
+            PIN_AddPrepareForFiniFunction(VmPrepareForFini, 0);
+        }
+
         // Register function to be called when the application exits
         PIN_AddFiniFunction(Fini, 0);
+        if (!AttachInit(DetachFini))
+        {
+            cerr << "btrace: cannot start the detach timer thread" << endl;
+            return 1;
+        }
     }
 
 /*
@@ -696,7 +2435,7 @@ int main(int argc, char *argv[])
 */
     // Start the program, never returns
     PIN_StartProgram();
-    
+
     return 0;
 }
 
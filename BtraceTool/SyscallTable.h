@@ -0,0 +1,91 @@
+/*! @file
+ *  Compile-time description of the Linux system calls decoded by BtraceTool.
+ *
+ *  Every ABI has one table indexed directly by system call number. Each entry
+ *  names the call and gives one type character per argument, which is all the
+ *  generic formatter needs to print it:
+ *
+ *      'd'  signed int             'u'  unsigned long
+ *      'x'  flags, printed in hex  'm'  mode, printed in octal
+ *      'z'  size                   'p'  pointer (NULL or hex)
+ *      'f'  file descriptor        's'  path or other NUL-terminated string
+ *      'o'  open(2) flags          'b'  buffer read by the kernel
+ *      'B'  buffer filled by the kernel
+ *      'l'  signed long or off_t, 32 bits wide on i386
+ *      'L'  64-bit offset or length split over two arguments on i386, low half first
+ *      'h'  high half of the 'L' before it, not printed on its own
+ *
+ *  For 'b' and 'B' the following argument holds the buffer length. The return
+ *  type uses the same characters, plus 'n' for calls that do not return.
+ *  Unused numbers have a NULL name.
+ *
+ *  Every entry also carries the classes used by "-e trace=" filters, named
+ *  as in strace: a call is in "file" if it takes a path, in "desc" if it
+ *  takes or returns a file descriptor, and so on.
+ */
+
+#ifndef SYSCALL_TABLE_H
+#define SYSCALL_TABLE_H
+
+// SYSCALL_DESC::classes
+#define SYSCALL_CLASS_FILE      0x01    // takes a path
+#define SYSCALL_CLASS_DESC      0x02    // takes or returns a file descriptor
+#define SYSCALL_CLASS_NETWORK   0x04    // socket calls
+#define SYSCALL_CLASS_MEMORY    0x08    // address space changes
+#define SYSCALL_CLASS_PROCESS   0x10    // process lifecycle
+#define SYSCALL_CLASS_SIGNAL    0x20    // signal delivery and masks
+#define SYSCALL_CLASS_IPC       0x40    // System V IPC
+
+struct SYSCALL_DESC
+{
+    const char * name;      // system call name, NULL for unused numbers
+    const char * args;      // one type character per argument
+    char         ret;       // type character of the return value
+    unsigned     classes;   // SYSCALL_CLASS_* flags
+};
+
+static const struct { const char * name; unsigned flag; } SyscallClasses[] =
+{
+    { "file",    SYSCALL_CLASS_FILE },
+    { "desc",    SYSCALL_CLASS_DESC },
+    { "network", SYSCALL_CLASS_NETWORK },
+    { "memory",  SYSCALL_CLASS_MEMORY },
+    { "process", SYSCALL_CLASS_PROCESS },
+    { "signal",  SYSCALL_CLASS_SIGNAL },
+    { "ipc",     SYSCALL_CLASS_IPC }
+};
+
+// Short names for the class flags, used only inside the tables.
+#define TF SYSCALL_CLASS_FILE
+#define TD SYSCALL_CLASS_DESC
+#define TN SYSCALL_CLASS_NETWORK
+#define TM SYSCALL_CLASS_MEMORY
+#define TP SYSCALL_CLASS_PROCESS
+#define TS SYSCALL_CLASS_SIGNAL
+#define TI SYSCALL_CLASS_IPC
+
+#include "SyscallTable_i386.h"
+#include "SyscallTable_x86_64.h"
+
+#undef TF
+#undef TD
+#undef TN
+#undef TM
+#undef TP
+#undef TS
+#undef TI
+
+#define SYSCALL_TABLE_SIZE(table) (sizeof(table) / sizeof((table)[0]))
+
+/*!
+ * Look up a system call number in one of the tables above.
+ * @return the descriptor, or NULL if the number is unknown to this ABI
+ */
+inline const SYSCALL_DESC * SyscallLookup(const SYSCALL_DESC * table, unsigned long size, unsigned long num)
+{
+    if (num >= size || table[num].name == 0)
+        return 0;
+    return &table[num];
+}
+
+#endif // SYSCALL_TABLE_H
@@ -0,0 +1,460 @@
+/*! @file
+ *  System call table of the i386 Linux ABI, indexed by system call number.
+ *  Numbers follow <asm/unistd_32.h>. See SyscallTable.h for the meaning of
+ *  the argument and return type characters and of the class flags.
+ */
+
+static const SYSCALL_DESC SyscallTableI386[] =
+{
+    /*   0 */ { "restart_syscall",         "",        'd', 0 },
+    /*   1 */ { "exit",                    "d",       'n', TP },
+    /*   2 */ { "fork",                    "",        'd', TP },
+    /*   3 */ { "read",                    "fBz",     'd', TD },
+    /*   4 */ { "write",                   "fbz",     'd', TD },
+    /*   5 */ { "open",                    "som",     'd', TF|TD },
+    /*   6 */ { "close",                   "f",       'd', TD },
+    /*   7 */ { "waitpid",                 "dpx",     'd', TP },
+    /*   8 */ { "creat",                   "sm",      'd', TF|TD },
+    /*   9 */ { "link",                    "ss",      'd', TF },
+    /*  10 */ { "unlink",                  "s",       'd', TF },
+    /*  11 */ { "execve",                  "spp",     'd', TF|TP },
+    /*  12 */ { "chdir",                   "s",       'd', TF },
+    /*  13 */ { "time",                    "p",       'd', 0 },
+    /*  14 */ { "mknod",                   "smu",     'd', TF },
+    /*  15 */ { "chmod",                   "sm",      'd', TF },
+    /*  16 */ { "lchown",                  "sdd",     'd', TF },
+    /*  17 */ { "break",                   "",        'd', 0 },
+    /*  18 */ { "oldstat",                 "sp",      'd', TF },
+    /*  19 */ { "lseek",                   "fld",     'd', TD },
+    /*  20 */ { "getpid",                  "",        'd', 0 },
+    /*  21 */ { "mount",                   "sssxp",   'd', TF },
+    /*  22 */ { "umount",                  "s",       'd', TF },
+    /*  23 */ { "setuid",                  "u",       'd', 0 },
+    /*  24 */ { "getuid",                  "",        'd', 0 },
+    /*  25 */ { "stime",                   "p",       'd', 0 },
+    /*  26 */ { "ptrace",                  "ddpp",    'd', 0 },
+    /*  27 */ { "alarm",                   "u",       'd', 0 },
+    /*  28 */ { "oldfstat",                "fp",      'd', TD },
+    /*  29 */ { "pause",                   "",        'd', TS },
+    /*  30 */ { "utime",                   "sp",      'd', TF },
+    /*  31 */ { "stty",                    "",        'd', 0 },
+    /*  32 */ { "gtty",                    "",        'd', 0 },
+    /*  33 */ { "access",                  "sd",      'd', TF },
+    /*  34 */ { "nice",                    "d",       'd', 0 },
+    /*  35 */ { "ftime",                   "",        'd', 0 },
+    /*  36 */ { "sync",                    "",        'd', 0 },
+    /*  37 */ { "kill",                    "dd",      'd', TS },
+    /*  38 */ { "rename",                  "ss",      'd', TF },
+    /*  39 */ { "mkdir",                   "sm",      'd', TF },
+    /*  40 */ { "rmdir",                   "s",       'd', TF },
+    /*  41 */ { "dup",                     "f",       'd', TD },
+    /*  42 */ { "pipe",                    "p",       'd', TD },
+    /*  43 */ { "times",                   "p",       'd', 0 },
+    /*  44 */ { "prof",                    "",        'd', 0 },
+    /*  45 */ { "brk",                     "p",       'p', TM },
+    /*  46 */ { "setgid",                  "u",       'd', 0 },
+    /*  47 */ { "getgid",                  "",        'd', 0 },
+    /*  48 */ { "signal",                  "dp",      'p', TS },
+    /*  49 */ { "geteuid",                 "",        'd', 0 },
+    /*  50 */ { "getegid",                 "",        'd', 0 },
+    /*  51 */ { "acct",                    "s",       'd', TF },
+    /*  52 */ { "umount2",                 "sx",      'd', TF },
+    /*  53 */ { "lock",                    "",        'd', 0 },
+    /*  54 */ { "ioctl",                   "fxp",     'd', TD },
+    /*  55 */ { "fcntl",                   "fdp",     'd', TD },
+    /*  56 */ { "mpx",                     "",        'd', 0 },
+    /*  57 */ { "setpgid",                 "dd",      'd', 0 },
+    /*  58 */ { "ulimit",                  "",        'd', 0 },
+    /*  59 */ { "oldolduname",             "p",       'd', 0 },
+    /*  60 */ { "umask",                   "m",       'm', 0 },
+    /*  61 */ { "chroot",                  "s",       'd', TF },
+    /*  62 */ { "ustat",                   "up",      'd', 0 },
+    /*  63 */ { "dup2",                    "ff",      'd', TD },
+    /*  64 */ { "getppid",                 "",        'd', 0 },
+    /*  65 */ { "getpgrp",                 "",        'd', 0 },
+    /*  66 */ { "setsid",                  "",        'd', 0 },
+    /*  67 */ { "sigaction",               "dpp",     'd', TS },
+    /*  68 */ { "sgetmask",                "",        'd', TS },
+    /*  69 */ { "ssetmask",                "x",       'd', TS },
+    /*  70 */ { "setreuid",                "uu",      'd', 0 },
+    /*  71 */ { "setregid",                "uu",      'd', 0 },
+    /*  72 */ { "sigsuspend",              "p",       'd', TS },
+    /*  73 */ { "sigpending",              "p",       'd', TS },
+    /*  74 */ { "sethostname",             "sz",      'd', 0 },
+    /*  75 */ { "setrlimit",               "dp",      'd', 0 },
+    /*  76 */ { "getrlimit",               "dp",      'd', 0 },
+    /*  77 */ { "getrusage",               "dp",      'd', 0 },
+    /*  78 */ { "gettimeofday",            "pp",      'd', 0 },
+    /*  79 */ { "settimeofday",            "pp",      'd', 0 },
+    /*  80 */ { "getgroups",               "dp",      'd', 0 },
+    /*  81 */ { "setgroups",               "dp",      'd', 0 },
+    /*  82 */ { "select",                  "dpppp",   'd', 0 },
+    /*  83 */ { "symlink",                 "ss",      'd', TF },
+    /*  84 */ { "oldlstat",                "sp",      'd', TF },
+    /*  85 */ { "readlink",                "spz",     'd', TF },
+    /*  86 */ { "uselib",                  "s",       'd', TF },
+    /*  87 */ { "swapon",                  "sx",      'd', TF },
+    /*  88 */ { "reboot",                  "xxxp",    'd', 0 },
+    /*  89 */ { "readdir",                 "fpu",     'd', TD },
+    /*  90 */ { "mmap",                    "pzxxfu",  'p', TD|TM },
+    /*  91 */ { "munmap",                  "pz",      'd', TM },
+    /*  92 */ { "truncate",                "sl",      'd', TF },
+    /*  93 */ { "ftruncate",               "fl",      'd', TD },
+    /*  94 */ { "fchmod",                  "fm",      'd', TD },
+    /*  95 */ { "fchown",                  "fdd",     'd', TD },
+    /*  96 */ { "getpriority",             "dd",      'd', 0 },
+    /*  97 */ { "setpriority",             "ddd",     'd', 0 },
+    /*  98 */ { "profil",                  "",        'd', 0 },
+    /*  99 */ { "statfs",                  "sp",      'd', TF },
+    /* 100 */ { "fstatfs",                 "fp",      'd', TD },
+    /* 101 */ { "ioperm",                  "uud",     'd', 0 },
+    /* 102 */ { "socketcall",              "dp",      'd', TN },
+    /* 103 */ { "syslog",                  "dpd",     'd', 0 },
+    /* 104 */ { "setitimer",               "dpp",     'd', 0 },
+    /* 105 */ { "getitimer",               "dp",      'd', 0 },
+    /* 106 */ { "stat",                    "sp",      'd', TF },
+    /* 107 */ { "lstat",                   "sp",      'd', TF },
+    /* 108 */ { "fstat",                   "fp",      'd', TD },
+    /* 109 */ { "olduname",                "p",       'd', 0 },
+    /* 110 */ { "iopl",                    "d",       'd', 0 },
+    /* 111 */ { "vhangup",                 "",        'd', 0 },
+    /* 112 */ { "idle",                    "",        'd', 0 },
+    /* 113 */ { "vm86old",                 "p",       'd', 0 },
+    /* 114 */ { "wait4",                   "dpxp",    'd', TP },
+    /* 115 */ { "swapoff",                 "s",       'd', TF },
+    /* 116 */ { "sysinfo",                 "p",       'd', 0 },
+    /* 117 */ { "ipc",                     "uddpp",   'd', TI },
+    /* 118 */ { "fsync",                   "f",       'd', TD },
+    /* 119 */ { "sigreturn",               "",        'd', TS },
+    /* 120 */ { "clone",                   "xppppp",  'd', TP },
+    /* 121 */ { "setdomainname",           "sz",      'd', 0 },
+    /* 122 */ { "uname",                   "p",       'd', 0 },
+    /* 123 */ { "modify_ldt",              "dpu",     'd', 0 },
+    /* 124 */ { "adjtimex",                "p",       'd', 0 },
+    /* 125 */ { "mprotect",                "pzx",     'd', TM },
+    /* 126 */ { "sigprocmask",             "dpp",     'd', TS },
+    /* 127 */ { "create_module",           "sz",      'p', 0 },
+    /* 128 */ { "init_module",             "pus",     'd', 0 },
+    /* 129 */ { "delete_module",           "sx",      'd', 0 },
+    /* 130 */ { "get_kernel_syms",         "p",       'd', 0 },
+    /* 131 */ { "quotactl",                "xsdp",    'd', TF },
+    /* 132 */ { "getpgid",                 "d",       'd', 0 },
+    /* 133 */ { "fchdir",                  "f",       'd', TD },
+    /* 134 */ { "bdflush",                 "dp",      'd', 0 },
+    /* 135 */ { "sysfs",                   "duu",     'd', 0 },
+    /* 136 */ { "personality",             "x",       'x', 0 },
+    /* 137 */ { "afs_syscall",             "",        'd', 0 },
+    /* 138 */ { "setfsuid",                "u",       'd', 0 },
+    /* 139 */ { "setfsgid",                "u",       'd', 0 },
+    /* 140 */ { "_llseek",                 "fuupd",   'd', TD },
+    /* 141 */ { "getdents",                "fpz",     'd', TD },
+    /* 142 */ { "_newselect",              "dpppp",   'd', 0 },
+    /* 143 */ { "flock",                   "fx",      'd', TD },
+    /* 144 */ { "msync",                   "pzx",     'd', TM },
+    /* 145 */ { "readv",                   "fpd",     'd', TD },
+    /* 146 */ { "writev",                  "fpd",     'd', TD },
+    /* 147 */ { "getsid",                  "d",       'd', 0 },
+    /* 148 */ { "fdatasync",               "f",       'd', TD },
+    /* 149 */ { "_sysctl",                 "p",       'd', 0 },
+    /* 150 */ { "mlock",                   "pz",      'd', TM },
+    /* 151 */ { "munlock",                 "pz",      'd', TM },
+    /* 152 */ { "mlockall",                "x",       'd', TM },
+    /* 153 */ { "munlockall",              "",        'd', TM },
+    /* 154 */ { "sched_setparam",          "dp",      'd', 0 },
+    /* 155 */ { "sched_getparam",          "dp",      'd', 0 },
+    /* 156 */ { "sched_setscheduler",      "ddp",     'd', 0 },
+    /* 157 */ { "sched_getscheduler",      "d",       'd', 0 },
+    /* 158 */ { "sched_yield",             "",        'd', 0 },
+    /* 159 */ { "sched_get_priority_max",  "d",       'd', 0 },
+    /* 160 */ { "sched_get_priority_min",  "d",       'd', 0 },
+    /* 161 */ { "sched_rr_get_interval",   "dp",      'd', 0 },
+    /* 162 */ { "nanosleep",               "pp",      'd', 0 },
+    /* 163 */ { "mremap",                  "pzzxp",   'p', TM },
+    /* 164 */ { "setresuid",               "uuu",     'd', 0 },
+    /* 165 */ { "getresuid",               "ppp",     'd', 0 },
+    /* 166 */ { "vm86",                    "up",      'd', 0 },
+    /* 167 */ { "query_module",            "sdpzp",   'd', 0 },
+    /* 168 */ { "poll",                    "pud",     'd', 0 },
+    /* 169 */ { "nfsservctl",              "dpp",     'd', 0 },
+    /* 170 */ { "setresgid",               "uuu",     'd', 0 },
+    /* 171 */ { "getresgid",               "ppp",     'd', 0 },
+    /* 172 */ { "prctl",                   "duuuu",   'd', 0 },
+    /* 173 */ { "rt_sigreturn",            "",        'd', TS },
+    /* 174 */ { "rt_sigaction",            "dppz",    'd', TS },
+    /* 175 */ { "rt_sigprocmask",          "dppz",    'd', TS },
+    /* 176 */ { "rt_sigpending",           "pz",      'd', TS },
+    /* 177 */ { "rt_sigtimedwait",         "pppz",    'd', TS },
+    /* 178 */ { "rt_sigqueueinfo",         "ddp",     'd', TS },
+    /* 179 */ { "rt_sigsuspend",           "pz",      'd', TS },
+    /* 180 */ { "pread64",                 "fBzLh",   'd', TD },
+    /* 181 */ { "pwrite64",                "fbzLh",   'd', TD },
+    /* 182 */ { "chown",                   "sdd",     'd', TF },
+    /* 183 */ { "getcwd",                  "pz",      'd', 0 },
+    /* 184 */ { "capget",                  "pp",      'd', 0 },
+    /* 185 */ { "capset",                  "pp",      'd', 0 },
+    /* 186 */ { "sigaltstack",             "pp",      'd', TS },
+    /* 187 */ { "sendfile",                "ffpz",    'd', TD },
+    /* 188 */ { "getpmsg",                 "",        'd', 0 },
+    /* 189 */ { "putpmsg",                 "",        'd', 0 },
+    /* 190 */ { "vfork",                   "",        'd', TP },
+    /* 191 */ { "ugetrlimit",              "dp",      'd', 0 },
+    /* 192 */ { "mmap2",                   "pzxxfu",  'p', TD|TM },
+    /* 193 */ { "truncate64",              "sLh",     'd', TF },
+    /* 194 */ { "ftruncate64",             "fLh",     'd', TD },
+    /* 195 */ { "stat64",                  "sp",      'd', TF },
+    /* 196 */ { "lstat64",                 "sp",      'd', TF },
+    /* 197 */ { "fstat64",                 "fp",      'd', TD },
+    /* 198 */ { "lchown32",                "sdd",     'd', TF },
+    /* 199 */ { "getuid32",                "",        'd', 0 },
+    /* 200 */ { "getgid32",                "",        'd', 0 },
+    /* 201 */ { "geteuid32",               "",        'd', 0 },
+    /* 202 */ { "getegid32",               "",        'd', 0 },
+    /* 203 */ { "setreuid32",              "uu",      'd', 0 },
+    /* 204 */ { "setregid32",              "uu",      'd', 0 },
+    /* 205 */ { "getgroups32",             "dp",      'd', 0 },
+    /* 206 */ { "setgroups32",             "dp",      'd', 0 },
+    /* 207 */ { "fchown32",                "fdd",     'd', TD },
+    /* 208 */ { "setresuid32",             "uuu",     'd', 0 },
+    /* 209 */ { "getresuid32",             "ppp",     'd', 0 },
+    /* 210 */ { "setresgid32",             "uuu",     'd', 0 },
+    /* 211 */ { "getresgid32",             "ppp",     'd', 0 },
+    /* 212 */ { "chown32",                 "sdd",     'd', TF },
+    /* 213 */ { "setuid32",                "u",       'd', 0 },
+    /* 214 */ { "setgid32",                "u",       'd', 0 },
+    /* 215 */ { "setfsuid32",              "u",       'd', 0 },
+    /* 216 */ { "setfsgid32",              "u",       'd', 0 },
+    /* 217 */ { "pivot_root",              "ss",      'd', TF },
+    /* 218 */ { "mincore",                 "pzp",     'd', TM },
+    /* 219 */ { "madvise",                 "pzd",     'd', TM },
+    /* 220 */ { "getdents64",              "fpz",     'd', TD },
+    /* 221 */ { "fcntl64",                 "fdp",     'd', TD },
+    /* 222 */ { 0,                         0,         0,   0 },
+    /* 223 */ { 0,                         0,         0,   0 },
+    /* 224 */ { "gettid",                  "",        'd', 0 },
+    /* 225 */ { "readahead",               "fLhz",    'd', TD },
+    /* 226 */ { "setxattr",                "sspzx",   'd', TF },
+    /* 227 */ { "lsetxattr",               "sspzx",   'd', TF },
+    /* 228 */ { "fsetxattr",               "fspzx",   'd', TD },
+    /* 229 */ { "getxattr",                "sspz",    'd', TF },
+    /* 230 */ { "lgetxattr",               "sspz",    'd', TF },
+    /* 231 */ { "fgetxattr",               "fspz",    'd', TD },
+    /* 232 */ { "listxattr",               "spz",     'd', TF },
+    /* 233 */ { "llistxattr",              "spz",     'd', TF },
+    /* 234 */ { "flistxattr",              "fpz",     'd', TD },
+    /* 235 */ { "removexattr",             "ss",      'd', TF },
+    /* 236 */ { "lremovexattr",            "ss",      'd', TF },
+    /* 237 */ { "fremovexattr",            "fs",      'd', TD },
+    /* 238 */ { "tkill",                   "dd",      'd', TS },
+    /* 239 */ { "sendfile64",              "ffpz",    'd', TD },
+    /* 240 */ { "futex",                   "pdupud",  'd', 0 },
+    /* 241 */ { "sched_setaffinity",       "dzp",     'd', 0 },
+    /* 242 */ { "sched_getaffinity",       "dzp",     'd', 0 },
+    /* 243 */ { "set_thread_area",         "p",       'd', 0 },
+    /* 244 */ { "get_thread_area",         "p",       'd', 0 },
+    /* 245 */ { "io_setup",                "up",      'd', 0 },
+    /* 246 */ { "io_destroy",              "u",       'd', 0 },
+    /* 247 */ { "io_getevents",            "uddpp",   'd', 0 },
+    /* 248 */ { "io_submit",               "udp",     'd', 0 },
+    /* 249 */ { "io_cancel",               "upp",     'd', 0 },
+    /* 250 */ { "fadvise64",               "fLhzd",   'd', TD },
+    /* 251 */ { 0,                         0,         0,   0 },
+    /* 252 */ { "exit_group",              "d",       'n', TP },
+    /* 253 */ { "lookup_dcookie",          "upz",     'd', 0 },
+    /* 254 */ { "epoll_create",            "d",       'd', TD },
+    /* 255 */ { "epoll_ctl",               "fdfp",    'd', TD },
+    /* 256 */ { "epoll_wait",              "fpdd",    'd', TD },
+    /* 257 */ { "remap_file_pages",        "pzxzx",   'd', TM },
+    /* 258 */ { "set_tid_address",         "p",       'd', 0 },
+    /* 259 */ { "timer_create",            "dpp",     'd', 0 },
+    /* 260 */ { "timer_settime",           "dxpp",    'd', 0 },
+    /* 261 */ { "timer_gettime",           "dp",      'd', 0 },
+    /* 262 */ { "timer_getoverrun",        "d",       'd', 0 },
+    /* 263 */ { "timer_delete",            "d",       'd', 0 },
+    /* 264 */ { "clock_settime",           "dp",      'd', 0 },
+    /* 265 */ { "clock_gettime",           "dp",      'd', 0 },
+    /* 266 */ { "clock_getres",            "dp",      'd', 0 },
+    /* 267 */ { "clock_nanosleep",         "dxpp",    'd', 0 },
+    /* 268 */ { "statfs64",                "szp",     'd', TF },
+    /* 269 */ { "fstatfs64",               "fzp",     'd', TD },
+    /* 270 */ { "tgkill",                  "ddd",     'd', TS },
+    /* 271 */ { "utimes",                  "sp",      'd', TF },
+    /* 272 */ { "fadvise64_64",            "fLhLhd",  'd', TD },
+    /* 273 */ { "vserver",                 "",        'd', 0 },
+    /* 274 */ { "mbind",                   "pzdpux",  'd', TM },
+    /* 275 */ { "get_mempolicy",           "ppupx",   'd', TM },
+    /* 276 */ { "set_mempolicy",           "dpu",     'd', TM },
+    /* 277 */ { "mq_open",                 "som",     'd', TD },
+    /* 278 */ { "mq_unlink",               "s",       'd', 0 },
+    /* 279 */ { "mq_timedsend",            "fpzup",   'd', TD },
+    /* 280 */ { "mq_timedreceive",         "fpzpp",   'd', TD },
+    /* 281 */ { "mq_notify",               "fp",      'd', TD },
+    /* 282 */ { "mq_getsetattr",           "fpp",     'd', TD },
+    /* 283 */ { "kexec_load",              "uupx",    'd', 0 },
+    /* 284 */ { "waitid",                  "ddpxp",   'd', TP },
+    /* 285 */ { 0,                         0,         0,   0 },
+    /* 286 */ { "add_key",                 "sspzd",   'd', 0 },
+    /* 287 */ { "request_key",             "sssd",    'd', 0 },
+    /* 288 */ { "keyctl",                  "duuuu",   'd', 0 },
+    /* 289 */ { "ioprio_set",              "ddd",     'd', 0 },
+    /* 290 */ { "ioprio_get",              "dd",      'd', 0 },
+    /* 291 */ { "inotify_init",            "",        'd', TD },
+    /* 292 */ { "inotify_add_watch",       "fsx",     'd', TF|TD },
+    /* 293 */ { "inotify_rm_watch",        "fd",      'd', TD },
+    /* 294 */ { "migrate_pages",           "dupp",    'd', TM },
+    /* 295 */ { "openat",                  "fsom",    'd', TF|TD },
+    /* 296 */ { "mkdirat",                 "fsm",     'd', TF|TD },
+    /* 297 */ { "mknodat",                 "fsmu",    'd', TF|TD },
+    /* 298 */ { "fchownat",                "fsddx",   'd', TF|TD },
+    /* 299 */ { "futimesat",               "fsp",     'd', TF|TD },
+    /* 300 */ { "fstatat64",               "fspx",    'd', TF|TD },
+    /* 301 */ { "unlinkat",                "fsx",     'd', TF|TD },
+    /* 302 */ { "renameat",                "fsfs",    'd', TF|TD },
+    /* 303 */ { "linkat",                  "fsfsx",   'd', TF|TD },
+    /* 304 */ { "symlinkat",               "sfs",     'd', TF|TD },
+    /* 305 */ { "readlinkat",              "fspz",    'd', TF|TD },
+    /* 306 */ { "fchmodat",                "fsm",     'd', TF|TD },
+    /* 307 */ { "faccessat",               "fsd",     'd', TF|TD },
+    /* 308 */ { "pselect6",                "dppppp",  'd', 0 },
+    /* 309 */ { "ppoll",                   "puppz",   'd', 0 },
+    /* 310 */ { "unshare",                 "x",       'd', 0 },
+    /* 311 */ { "set_robust_list",         "pz",      'd', 0 },
+    /* 312 */ { "get_robust_list",         "dpp",     'd', 0 },
+    /* 313 */ { "splice",                  "fpfpzx",  'd', TD },
+    /* 314 */ { "sync_file_range",         "fLhLhx",  'd', TD },
+    /* 315 */ { "tee",                     "ffzx",    'd', TD },
+    /* 316 */ { "vmsplice",                "fpux",    'd', TD },
+    /* 317 */ { "move_pages",              "dupppx",  'd', TM },
+    /* 318 */ { "getcpu",                  "ppp",     'd', 0 },
+    /* 319 */ { "epoll_pwait",             "fpddpz",  'd', TD },
+    /* 320 */ { "utimensat",               "fspx",    'd', TF|TD },
+    /* 321 */ { "signalfd",                "fpz",     'd', TD|TS },
+    /* 322 */ { "timerfd_create",          "dx",      'd', TD },
+    /* 323 */ { "eventfd",                 "u",       'd', TD },
+    /* 324 */ { "fallocate",               "fxLhLh",  'd', TD },
+    /* 325 */ { "timerfd_settime",         "fxpp",    'd', TD },
+    /* 326 */ { "timerfd_gettime",         "fp",      'd', TD },
+    /* 327 */ { "signalfd4",               "fpzx",    'd', TD|TS },
+    /* 328 */ { "eventfd2",                "ux",      'd', TD },
+    /* 329 */ { "epoll_create1",           "x",       'd', TD },
+    /* 330 */ { "dup3",                    "ffx",     'd', TD },
+    /* 331 */ { "pipe2",                   "px",      'd', TD },
+    /* 332 */ { "inotify_init1",           "x",       'd', TD },
+    /* 333 */ { "preadv",                  "fpdLh",   'd', TD },
+    /* 334 */ { "pwritev",                 "fpdLh",   'd', TD },
+    /* 335 */ { "rt_tgsigqueueinfo",       "dddp",    'd', TS },
+    /* 336 */ { "perf_event_open",         "pdddx",   'd', TD },
+    /* 337 */ { "recvmmsg",                "fpuxp",   'd', TD|TN },
+    /* 338 */ { "fanotify_init",           "xx",      'd', TD },
+    /* 339 */ { "fanotify_mark",           "fxxfs",   'd', TF|TD },
+    /* 340 */ { "prlimit64",               "ddpp",    'd', 0 },
+    /* 341 */ { "name_to_handle_at",       "fsppx",   'd', TF|TD },
+    /* 342 */ { "open_by_handle_at",       "fpo",     'd', TD },
+    /* 343 */ { "clock_adjtime",           "dp",      'd', 0 },
+    /* 344 */ { "syncfs",                  "f",       'd', TD },
+    /* 345 */ { "sendmmsg",                "fpux",    'd', TD|TN },
+    /* 346 */ { "setns",                   "fx",      'd', TD },
+    /* 347 */ { "process_vm_readv",        "dpupux",  'd', 0 },
+    /* 348 */ { "process_vm_writev",       "dpupux",  'd', 0 },
+    /* 349 */ { "kcmp",                    "dddup",   'd', 0 },
+    /* 350 */ { "finit_module",            "fsx",     'd', TD },
+    /* 351 */ { "sched_setattr",           "dpx",     'd', 0 },
+    /* 352 */ { "sched_getattr",           "dpux",    'd', 0 },
+    /* 353 */ { "renameat2",               "fsfsx",   'd', TF|TD },
+    /* 354 */ { "seccomp",                 "uxp",     'd', 0 },
+    /* 355 */ { "getrandom",               "pzx",     'd', 0 },
+    /* 356 */ { "memfd_create",            "sx",      'd', TD },
+    /* 357 */ { "bpf",                     "dpu",     'd', 0 },
+    /* 358 */ { "execveat",                "fsppx",   'd', TF|TD|TP },
+    /* 359 */ { "socket",                  "ddd",     'd', TD|TN },
+    /* 360 */ { "socketpair",              "dddp",    'd', TD|TN },
+    /* 361 */ { "bind",                    "fpu",     'd', TD|TN },
+    /* 362 */ { "connect",                 "fpu",     'd', TD|TN },
+    /* 363 */ { "listen",                  "fd",      'd', TD|TN },
+    /* 364 */ { "accept4",                 "fppx",    'd', TD|TN },
+    /* 365 */ { "getsockopt",              "fddpp",   'd', TD|TN },
+    /* 366 */ { "setsockopt",              "fddpu",   'd', TD|TN },
+    /* 367 */ { "getsockname",             "fpp",     'd', TD|TN },
+    /* 368 */ { "getpeername",             "fpp",     'd', TD|TN },
+    /* 369 */ { "sendto",                  "fbzxpu",  'd', TD|TN },
+    /* 370 */ { "sendmsg",                 "fpx",     'd', TD|TN },
+    /* 371 */ { "recvfrom",                "fBzxpp",  'd', TD|TN },
+    /* 372 */ { "recvmsg",                 "fpx",     'd', TD|TN },
+    /* 373 */ { "shutdown",                "fd",      'd', TD|TN },
+    /* 374 */ { "userfaultfd",             "x",       'd', TD },
+    /* 375 */ { "membarrier",              "dx",      'd', 0 },
+    /* 376 */ { "mlock2",                  "pzx",     'd', TM },
+    /* 377 */ { "copy_file_range",         "fpfpzx",  'd', TD },
+    /* 378 */ { "preadv2",                 "fpdLhx",  'd', TD },
+    /* 379 */ { "pwritev2",                "fpdLhx",  'd', TD },
+    /* 380 */ { "pkey_mprotect",           "pzxd",    'd', TM },
+    /* 381 */ { "pkey_alloc",              "xx",      'd', 0 },
+    /* 382 */ { "pkey_free",               "d",       'd', 0 },
+    /* 383 */ { "statx",                   "fsxxp",   'd', TF|TD },
+    /* 384 */ { "arch_prctl",              "dp",      'd', 0 },
+    /* 385 */ { "io_pgetevents",           "uddppp",  'd', 0 },
+    /* 386 */ { "rseq",                    "puxu",    'd', 0 },
+    /* 387 */ { 0,                         0,         0,   0 },
+    /* 388 */ { 0,                         0,         0,   0 },
+    /* 389 */ { 0,                         0,         0,   0 },
+    /* 390 */ { 0,                         0,         0,   0 },
+    /* 391 */ { 0,                         0,         0,   0 },
+    /* 392 */ { 0,                         0,         0,   0 },
+    /* 393 */ { "semget",                  "ddx",     'd', TI },
+    /* 394 */ { "semctl",                  "dddp",    'd', TI },
+    /* 395 */ { "shmget",                  "dzx",     'd', TI },
+    /* 396 */ { "shmctl",                  "ddp",     'd', TI },
+    /* 397 */ { "shmat",                   "dpx",     'p', TM|TI },
+    /* 398 */ { "shmdt",                   "p",       'd', TM|TI },
+    /* 399 */ { "msgget",                  "dx",      'd', TI },
+    /* 400 */ { "msgsnd",                  "dpzx",    'd', TI },
+    /* 401 */ { "msgrcv",                  "dpzdx",   'd', TI },
+    /* 402 */ { "msgctl",                  "ddp",     'd', TI },
+    /* 403 */ { "clock_gettime64",         "dp",      'd', 0 },
+    /* 404 */ { "clock_settime64",         "dp",      'd', 0 },
+    /* 405 */ { "clock_adjtime64",         "dp",      'd', 0 },
+    /* 406 */ { "clock_getres_time64",     "dp",      'd', 0 },
+    /* 407 */ { "clock_nanosleep_time64",  "dxpp",    'd', 0 },
+    /* 408 */ { "timer_gettime64",         "dp",      'd', 0 },
+    /* 409 */ { "timer_settime64",         "dxpp",    'd', 0 },
+    /* 410 */ { "timerfd_gettime64",       "fp",      'd', TD },
+    /* 411 */ { "timerfd_settime64",       "fxpp",    'd', TD },
+    /* 412 */ { "utimensat_time64",        "fspx",    'd', TF|TD },
+    /* 413 */ { "pselect6_time64",         "dppppp",  'd', 0 },
+    /* 414 */ { "ppoll_time64",            "puppz",   'd', 0 },
+    /* 415 */ { 0,                         0,         0,   0 },
+    /* 416 */ { "io_pgetevents_time64",    "uddppp",  'd', 0 },
+    /* 417 */ { "recvmmsg_time64",         "fpuxp",   'd', TD|TN },
+    /* 418 */ { "mq_timedsend_time64",     "fpzup",   'd', TD },
+    /* 419 */ { "mq_timedreceive_time64",  "fpzpp",   'd', TD },
+    /* 420 */ { "semtimedop_time64",       "dpup",    'd', TI },
+    /* 421 */ { "rt_sigtimedwait_time64",  "pppz",    'd', TS },
+    /* 422 */ { "futex_time64",            "pdupud",  'd', 0 },
+    /* 423 */ { "sched_rr_get_interval_time64", "dp",      'd', 0 },
+    /* 424 */ { "pidfd_send_signal",       "fdpx",    'd', TD|TS },
+    /* 425 */ { "io_uring_setup",          "up",      'd', TD },
+    /* 426 */ { "io_uring_enter",          "fuuxpz",  'd', TD },
+    /* 427 */ { "io_uring_register",       "fupu",    'd', TD },
+    /* 428 */ { "open_tree",               "fsx",     'd', TF|TD },
+    /* 429 */ { "move_mount",              "fsfsx",   'd', TF|TD },
+    /* 430 */ { "fsopen",                  "sx",      'd', TD },
+    /* 431 */ { "fsconfig",                "fdssd",   'd', TD },
+    /* 432 */ { "fsmount",                 "fxx",     'd', TD },
+    /* 433 */ { "fspick",                  "fsx",     'd', TF|TD },
+    /* 434 */ { "pidfd_open",              "dx",      'd', TD },
+    /* 435 */ { "clone3",                  "pz",      'd', TP },
+    /* 436 */ { "close_range",             "uux",     'd', 0 },
+    /* 437 */ { "openat2",                 "fspz",    'd', TF|TD },
+    /* 438 */ { "pidfd_getfd",             "ffx",     'd', TD },
+    /* 439 */ { "faccessat2",              "fsdx",    'd', TF|TD },
+    /* 440 */ { "process_madvise",         "fpzdx",   'd', TD|TM },
+    /* 441 */ { "epoll_pwait2",            "fpdppz",  'd', TD },
+    /* 442 */ { "mount_setattr",           "fsxpz",   'd', TF|TD },
+    /* 443 */ { "quotactl_fd",             "fxdp",    'd', TD },
+    /* 444 */ { "landlock_create_ruleset", "pzx",     'd', TD },
+    /* 445 */ { "landlock_add_rule",       "fdpx",    'd', TD },
+    /* 446 */ { "landlock_restrict_self",  "fx",      'd', TD },
+    /* 447 */ { "memfd_secret",            "x",       'd', TD },
+    /* 448 */ { "process_mrelease",        "fx",      'd', TD },
+    /* 449 */ { "futex_waitv",             "puxpd",   'd', 0 },
+    /* 450 */ { "set_mempolicy_home_node", "uuux",    'd', TM }
+};
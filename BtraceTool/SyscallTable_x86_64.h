@@ -0,0 +1,460 @@
+/*! @file
+ *  System call table of the x86_64 Linux ABI, indexed by system call number.
+ *  Numbers follow <asm/unistd_64.h>. See SyscallTable.h for the meaning of
+ *  the argument and return type characters and of the class flags.
+ */
+
+static const SYSCALL_DESC SyscallTableX86_64[] =
+{
+    /*   0 */ { "read",                    "fBz",     'd', TD },
+    /*   1 */ { "write",                   "fbz",     'd', TD },
+    /*   2 */ { "open",                    "som",     'd', TF|TD },
+    /*   3 */ { "close",                   "f",       'd', TD },
+    /*   4 */ { "stat",                    "sp",      'd', TF },
+    /*   5 */ { "fstat",                   "fp",      'd', TD },
+    /*   6 */ { "lstat",                   "sp",      'd', TF },
+    /*   7 */ { "poll",                    "pud",     'd', 0 },
+    /*   8 */ { "lseek",                   "fld",     'd', TD },
+    /*   9 */ { "mmap",                    "pzxxfu",  'p', TD|TM },
+    /*  10 */ { "mprotect",                "pzx",     'd', TM },
+    /*  11 */ { "munmap",                  "pz",      'd', TM },
+    /*  12 */ { "brk",                     "p",       'p', TM },
+    /*  13 */ { "rt_sigaction",            "dppz",    'd', TS },
+    /*  14 */ { "rt_sigprocmask",          "dppz",    'd', TS },
+    /*  15 */ { "rt_sigreturn",            "",        'd', TS },
+    /*  16 */ { "ioctl",                   "fxp",     'd', TD },
+    /*  17 */ { "pread64",                 "fBzl",    'd', TD },
+    /*  18 */ { "pwrite64",                "fbzl",    'd', TD },
+    /*  19 */ { "readv",                   "fpd",     'd', TD },
+    /*  20 */ { "writev",                  "fpd",     'd', TD },
+    /*  21 */ { "access",                  "sd",      'd', TF },
+    /*  22 */ { "pipe",                    "p",       'd', TD },
+    /*  23 */ { "select",                  "dpppp",   'd', 0 },
+    /*  24 */ { "sched_yield",             "",        'd', 0 },
+    /*  25 */ { "mremap",                  "pzzxp",   'p', TM },
+    /*  26 */ { "msync",                   "pzx",     'd', TM },
+    /*  27 */ { "mincore",                 "pzp",     'd', TM },
+    /*  28 */ { "madvise",                 "pzd",     'd', TM },
+    /*  29 */ { "shmget",                  "dzx",     'd', TI },
+    /*  30 */ { "shmat",                   "dpx",     'p', TM|TI },
+    /*  31 */ { "shmctl",                  "ddp",     'd', TI },
+    /*  32 */ { "dup",                     "f",       'd', TD },
+    /*  33 */ { "dup2",                    "ff",      'd', TD },
+    /*  34 */ { "pause",                   "",        'd', TS },
+    /*  35 */ { "nanosleep",               "pp",      'd', 0 },
+    /*  36 */ { "getitimer",               "dp",      'd', 0 },
+    /*  37 */ { "alarm",                   "u",       'd', 0 },
+    /*  38 */ { "setitimer",               "dpp",     'd', 0 },
+    /*  39 */ { "getpid",                  "",        'd', 0 },
+    /*  40 */ { "sendfile",                "ffpz",    'd', TD },
+    /*  41 */ { "socket",                  "ddd",     'd', TD|TN },
+    /*  42 */ { "connect",                 "fpu",     'd', TD|TN },
+    /*  43 */ { "accept",                  "fpp",     'd', TD|TN },
+    /*  44 */ { "sendto",                  "fbzxpu",  'd', TD|TN },
+    /*  45 */ { "recvfrom",                "fBzxpp",  'd', TD|TN },
+    /*  46 */ { "sendmsg",                 "fpx",     'd', TD|TN },
+    /*  47 */ { "recvmsg",                 "fpx",     'd', TD|TN },
+    /*  48 */ { "shutdown",                "fd",      'd', TD|TN },
+    /*  49 */ { "bind",                    "fpu",     'd', TD|TN },
+    /*  50 */ { "listen",                  "fd",      'd', TD|TN },
+    /*  51 */ { "getsockname",             "fpp",     'd', TD|TN },
+    /*  52 */ { "getpeername",             "fpp",     'd', TD|TN },
+    /*  53 */ { "socketpair",              "dddp",    'd', TD|TN },
+    /*  54 */ { "setsockopt",              "fddpu",   'd', TD|TN },
+    /*  55 */ { "getsockopt",              "fddpp",   'd', TD|TN },
+    /*  56 */ { "clone",                   "xppppp",  'd', TP },
+    /*  57 */ { "fork",                    "",        'd', TP },
+    /*  58 */ { "vfork",                   "",        'd', TP },
+    /*  59 */ { "execve",                  "spp",     'd', TF|TP },
+    /*  60 */ { "exit",                    "d",       'n', TP },
+    /*  61 */ { "wait4",                   "dpxp",    'd', TP },
+    /*  62 */ { "kill",                    "dd",      'd', TS },
+    /*  63 */ { "uname",                   "p",       'd', 0 },
+    /*  64 */ { "semget",                  "ddx",     'd', TI },
+    /*  65 */ { "semop",                   "dpu",     'd', TI },
+    /*  66 */ { "semctl",                  "dddp",    'd', TI },
+    /*  67 */ { "shmdt",                   "p",       'd', TM|TI },
+    /*  68 */ { "msgget",                  "dx",      'd', TI },
+    /*  69 */ { "msgsnd",                  "dpzx",    'd', TI },
+    /*  70 */ { "msgrcv",                  "dpzdx",   'd', TI },
+    /*  71 */ { "msgctl",                  "ddp",     'd', TI },
+    /*  72 */ { "fcntl",                   "fdp",     'd', TD },
+    /*  73 */ { "flock",                   "fx",      'd', TD },
+    /*  74 */ { "fsync",                   "f",       'd', TD },
+    /*  75 */ { "fdatasync",               "f",       'd', TD },
+    /*  76 */ { "truncate",                "sl",      'd', TF },
+    /*  77 */ { "ftruncate",               "fl",      'd', TD },
+    /*  78 */ { "getdents",                "fpz",     'd', TD },
+    /*  79 */ { "getcwd",                  "pz",      'd', 0 },
+    /*  80 */ { "chdir",                   "s",       'd', TF },
+    /*  81 */ { "fchdir",                  "f",       'd', TD },
+    /*  82 */ { "rename",                  "ss",      'd', TF },
+    /*  83 */ { "mkdir",                   "sm",      'd', TF },
+    /*  84 */ { "rmdir",                   "s",       'd', TF },
+    /*  85 */ { "creat",                   "sm",      'd', TF|TD },
+    /*  86 */ { "link",                    "ss",      'd', TF },
+    /*  87 */ { "unlink",                  "s",       'd', TF },
+    /*  88 */ { "symlink",                 "ss",      'd', TF },
+    /*  89 */ { "readlink",                "spz",     'd', TF },
+    /*  90 */ { "chmod",                   "sm",      'd', TF },
+    /*  91 */ { "fchmod",                  "fm",      'd', TD },
+    /*  92 */ { "chown",                   "sdd",     'd', TF },
+    /*  93 */ { "fchown",                  "fdd",     'd', TD },
+    /*  94 */ { "lchown",                  "sdd",     'd', TF },
+    /*  95 */ { "umask",                   "m",       'm', 0 },
+    /*  96 */ { "gettimeofday",            "pp",      'd', 0 },
+    /*  97 */ { "getrlimit",               "dp",      'd', 0 },
+    /*  98 */ { "getrusage",               "dp",      'd', 0 },
+    /*  99 */ { "sysinfo",                 "p",       'd', 0 },
+    /* 100 */ { "times",                   "p",       'd', 0 },
+    /* 101 */ { "ptrace",                  "ddpp",    'd', 0 },
+    /* 102 */ { "getuid",                  "",        'd', 0 },
+    /* 103 */ { "syslog",                  "dpd",     'd', 0 },
+    /* 104 */ { "getgid",                  "",        'd', 0 },
+    /* 105 */ { "setuid",                  "u",       'd', 0 },
+    /* 106 */ { "setgid",                  "u",       'd', 0 },
+    /* 107 */ { "geteuid",                 "",        'd', 0 },
+    /* 108 */ { "getegid",                 "",        'd', 0 },
+    /* 109 */ { "setpgid",                 "dd",      'd', 0 },
+    /* 110 */ { "getppid",                 "",        'd', 0 },
+    /* 111 */ { "getpgrp",                 "",        'd', 0 },
+    /* 112 */ { "setsid",                  "",        'd', 0 },
+    /* 113 */ { "setreuid",                "uu",      'd', 0 },
+    /* 114 */ { "setregid",                "uu",      'd', 0 },
+    /* 115 */ { "getgroups",               "dp",      'd', 0 },
+    /* 116 */ { "setgroups",               "dp",      'd', 0 },
+    /* 117 */ { "setresuid",               "uuu",     'd', 0 },
+    /* 118 */ { "getresuid",               "ppp",     'd', 0 },
+    /* 119 */ { "setresgid",               "uuu",     'd', 0 },
+    /* 120 */ { "getresgid",               "ppp",     'd', 0 },
+    /* 121 */ { "getpgid",                 "d",       'd', 0 },
+    /* 122 */ { "setfsuid",                "u",       'd', 0 },
+    /* 123 */ { "setfsgid",                "u",       'd', 0 },
+    /* 124 */ { "getsid",                  "d",       'd', 0 },
+    /* 125 */ { "capget",                  "pp",      'd', 0 },
+    /* 126 */ { "capset",                  "pp",      'd', 0 },
+    /* 127 */ { "rt_sigpending",           "pz",      'd', TS },
+    /* 128 */ { "rt_sigtimedwait",         "pppz",    'd', TS },
+    /* 129 */ { "rt_sigqueueinfo",         "ddp",     'd', TS },
+    /* 130 */ { "rt_sigsuspend",           "pz",      'd', TS },
+    /* 131 */ { "sigaltstack",             "pp",      'd', TS },
+    /* 132 */ { "utime",                   "sp",      'd', TF },
+    /* 133 */ { "mknod",                   "smu",     'd', TF },
+    /* 134 */ { "uselib",                  "s",       'd', TF },
+    /* 135 */ { "personality",             "x",       'x', 0 },
+    /* 136 */ { "ustat",                   "up",      'd', 0 },
+    /* 137 */ { "statfs",                  "sp",      'd', TF },
+    /* 138 */ { "fstatfs",                 "fp",      'd', TD },
+    /* 139 */ { "sysfs",                   "duu",     'd', 0 },
+    /* 140 */ { "getpriority",             "dd",      'd', 0 },
+    /* 141 */ { "setpriority",             "ddd",     'd', 0 },
+    /* 142 */ { "sched_setparam",          "dp",      'd', 0 },
+    /* 143 */ { "sched_getparam",          "dp",      'd', 0 },
+    /* 144 */ { "sched_setscheduler",      "ddp",     'd', 0 },
+    /* 145 */ { "sched_getscheduler",      "d",       'd', 0 },
+    /* 146 */ { "sched_get_priority_max",  "d",       'd', 0 },
+    /* 147 */ { "sched_get_priority_min",  "d",       'd', 0 },
+    /* 148 */ { "sched_rr_get_interval",   "dp",      'd', 0 },
+    /* 149 */ { "mlock",                   "pz",      'd', TM },
+    /* 150 */ { "munlock",                 "pz",      'd', TM },
+    /* 151 */ { "mlockall",                "x",       'd', TM },
+    /* 152 */ { "munlockall",              "",        'd', TM },
+    /* 153 */ { "vhangup",                 "",        'd', 0 },
+    /* 154 */ { "modify_ldt",              "dpu",     'd', 0 },
+    /* 155 */ { "pivot_root",              "ss",      'd', TF },
+    /* 156 */ { "_sysctl",                 "p",       'd', 0 },
+    /* 157 */ { "prctl",                   "duuuu",   'd', 0 },
+    /* 158 */ { "arch_prctl",              "dp",      'd', 0 },
+    /* 159 */ { "adjtimex",                "p",       'd', 0 },
+    /* 160 */ { "setrlimit",               "dp",      'd', 0 },
+    /* 161 */ { "chroot",                  "s",       'd', TF },
+    /* 162 */ { "sync",                    "",        'd', 0 },
+    /* 163 */ { "acct",                    "s",       'd', TF },
+    /* 164 */ { "settimeofday",            "pp",      'd', 0 },
+    /* 165 */ { "mount",                   "sssxp",   'd', TF },
+    /* 166 */ { "umount2",                 "sx",      'd', TF },
+    /* 167 */ { "swapon",                  "sx",      'd', TF },
+    /* 168 */ { "swapoff",                 "s",       'd', TF },
+    /* 169 */ { "reboot",                  "xxxp",    'd', 0 },
+    /* 170 */ { "sethostname",             "sz",      'd', 0 },
+    /* 171 */ { "setdomainname",           "sz",      'd', 0 },
+    /* 172 */ { "iopl",                    "d",       'd', 0 },
+    /* 173 */ { "ioperm",                  "uud",     'd', 0 },
+    /* 174 */ { "create_module",           "sz",      'p', 0 },
+    /* 175 */ { "init_module",             "pus",     'd', 0 },
+    /* 176 */ { "delete_module",           "sx",      'd', 0 },
+    /* 177 */ { "get_kernel_syms",         "p",       'd', 0 },
+    /* 178 */ { "query_module",            "sdpzp",   'd', 0 },
+    /* 179 */ { "quotactl",                "xsdp",    'd', TF },
+    /* 180 */ { "nfsservctl",              "dpp",     'd', 0 },
+    /* 181 */ { "getpmsg",                 "",        'd', 0 },
+    /* 182 */ { "putpmsg",                 "",        'd', 0 },
+    /* 183 */ { "afs_syscall",             "",        'd', 0 },
+    /* 184 */ { "tuxcall",                 "",        'd', 0 },
+    /* 185 */ { "security",                "",        'd', 0 },
+    /* 186 */ { "gettid",                  "",        'd', 0 },
+    /* 187 */ { "readahead",               "flz",     'd', TD },
+    /* 188 */ { "setxattr",                "sspzx",   'd', TF },
+    /* 189 */ { "lsetxattr",               "sspzx",   'd', TF },
+    /* 190 */ { "fsetxattr",               "fspzx",   'd', TD },
+    /* 191 */ { "getxattr",                "sspz",    'd', TF },
+    /* 192 */ { "lgetxattr",               "sspz",    'd', TF },
+    /* 193 */ { "fgetxattr",               "fspz",    'd', TD },
+    /* 194 */ { "listxattr",               "spz",     'd', TF },
+    /* 195 */ { "llistxattr",              "spz",     'd', TF },
+    /* 196 */ { "flistxattr",              "fpz",     'd', TD },
+    /* 197 */ { "removexattr",             "ss",      'd', TF },
+    /* 198 */ { "lremovexattr",            "ss",      'd', TF },
+    /* 199 */ { "fremovexattr",            "fs",      'd', TD },
+    /* 200 */ { "tkill",                   "dd",      'd', TS },
+    /* 201 */ { "time",                    "p",       'd', 0 },
+    /* 202 */ { "futex",                   "pdupud",  'd', 0 },
+    /* 203 */ { "sched_setaffinity",       "dzp",     'd', 0 },
+    /* 204 */ { "sched_getaffinity",       "dzp",     'd', 0 },
+    /* 205 */ { "set_thread_area",         "p",       'd', 0 },
+    /* 206 */ { "io_setup",                "up",      'd', 0 },
+    /* 207 */ { "io_destroy",              "u",       'd', 0 },
+    /* 208 */ { "io_getevents",            "uddpp",   'd', 0 },
+    /* 209 */ { "io_submit",               "udp",     'd', 0 },
+    /* 210 */ { "io_cancel",               "upp",     'd', 0 },
+    /* 211 */ { "get_thread_area",         "p",       'd', 0 },
+    /* 212 */ { "lookup_dcookie",          "upz",     'd', 0 },
+    /* 213 */ { "epoll_create",            "d",       'd', TD },
+    /* 214 */ { "epoll_ctl_old",           "",        'd', 0 },
+    /* 215 */ { "epoll_wait_old",          "",        'd', 0 },
+    /* 216 */ { "remap_file_pages",        "pzxzx",   'd', TM },
+    /* 217 */ { "getdents64",              "fpz",     'd', TD },
+    /* 218 */ { "set_tid_address",         "p",       'd', 0 },
+    /* 219 */ { "restart_syscall",         "",        'd', 0 },
+    /* 220 */ { "semtimedop",              "dpup",    'd', TI },
+    /* 221 */ { "fadvise64",               "flzd",    'd', TD },
+    /* 222 */ { "timer_create",            "dpp",     'd', 0 },
+    /* 223 */ { "timer_settime",           "dxpp",    'd', 0 },
+    /* 224 */ { "timer_gettime",           "dp",      'd', 0 },
+    /* 225 */ { "timer_getoverrun",        "d",       'd', 0 },
+    /* 226 */ { "timer_delete",            "d",       'd', 0 },
+    /* 227 */ { "clock_settime",           "dp",      'd', 0 },
+    /* 228 */ { "clock_gettime",           "dp",      'd', 0 },
+    /* 229 */ { "clock_getres",            "dp",      'd', 0 },
+    /* 230 */ { "clock_nanosleep",         "dxpp",    'd', 0 },
+    /* 231 */ { "exit_group",              "d",       'n', TP },
+    /* 232 */ { "epoll_wait",              "fpdd",    'd', TD },
+    /* 233 */ { "epoll_ctl",               "fdfp",    'd', TD },
+    /* 234 */ { "tgkill",                  "ddd",     'd', TS },
+    /* 235 */ { "utimes",                  "sp",      'd', TF },
+    /* 236 */ { "vserver",                 "",        'd', 0 },
+    /* 237 */ { "mbind",                   "pzdpux",  'd', TM },
+    /* 238 */ { "set_mempolicy",           "dpu",     'd', TM },
+    /* 239 */ { "get_mempolicy",           "ppupx",   'd', TM },
+    /* 240 */ { "mq_open",                 "som",     'd', TD },
+    /* 241 */ { "mq_unlink",               "s",       'd', 0 },
+    /* 242 */ { "mq_timedsend",            "fpzup",   'd', TD },
+    /* 243 */ { "mq_timedreceive",         "fpzpp",   'd', TD },
+    /* 244 */ { "mq_notify",               "fp",      'd', TD },
+    /* 245 */ { "mq_getsetattr",           "fpp",     'd', TD },
+    /* 246 */ { "kexec_load",              "uupx",    'd', 0 },
+    /* 247 */ { "waitid",                  "ddpxp",   'd', TP },
+    /* 248 */ { "add_key",                 "sspzd",   'd', 0 },
+    /* 249 */ { "request_key",             "sssd",    'd', 0 },
+    /* 250 */ { "keyctl",                  "duuuu",   'd', 0 },
+    /* 251 */ { "ioprio_set",              "ddd",     'd', 0 },
+    /* 252 */ { "ioprio_get",              "dd",      'd', 0 },
+    /* 253 */ { "inotify_init",            "",        'd', TD },
+    /* 254 */ { "inotify_add_watch",       "fsx",     'd', TF|TD },
+    /* 255 */ { "inotify_rm_watch",        "fd",      'd', TD },
+    /* 256 */ { "migrate_pages",           "dupp",    'd', TM },
+    /* 257 */ { "openat",                  "fsom",    'd', TF|TD },
+    /* 258 */ { "mkdirat",                 "fsm",     'd', TF|TD },
+    /* 259 */ { "mknodat",                 "fsmu",    'd', TF|TD },
+    /* 260 */ { "fchownat",                "fsddx",   'd', TF|TD },
+    /* 261 */ { "futimesat",               "fsp",     'd', TF|TD },
+    /* 262 */ { "newfstatat",              "fspx",    'd', TF|TD },
+    /* 263 */ { "unlinkat",                "fsx",     'd', TF|TD },
+    /* 264 */ { "renameat",                "fsfs",    'd', TF|TD },
+    /* 265 */ { "linkat",                  "fsfsx",   'd', TF|TD },
+    /* 266 */ { "symlinkat",               "sfs",     'd', TF|TD },
+    /* 267 */ { "readlinkat",              "fspz",    'd', TF|TD },
+    /* 268 */ { "fchmodat",                "fsm",     'd', TF|TD },
+    /* 269 */ { "faccessat",               "fsd",     'd', TF|TD },
+    /* 270 */ { "pselect6",                "dppppp",  'd', 0 },
+    /* 271 */ { "ppoll",                   "puppz",   'd', 0 },
+    /* 272 */ { "unshare",                 "x",       'd', 0 },
+    /* 273 */ { "set_robust_list",         "pz",      'd', 0 },
+    /* 274 */ { "get_robust_list",         "dpp",     'd', 0 },
+    /* 275 */ { "splice",                  "fpfpzx",  'd', TD },
+    /* 276 */ { "tee",                     "ffzx",    'd', TD },
+    /* 277 */ { "sync_file_range",         "fllx",    'd', TD },
+    /* 278 */ { "vmsplice",                "fpux",    'd', TD },
+    /* 279 */ { "move_pages",              "dupppx",  'd', TM },
+    /* 280 */ { "utimensat",               "fspx",    'd', TF|TD },
+    /* 281 */ { "epoll_pwait",             "fpddpz",  'd', TD },
+    /* 282 */ { "signalfd",                "fpz",     'd', TD|TS },
+    /* 283 */ { "timerfd_create",          "dx",      'd', TD },
+    /* 284 */ { "eventfd",                 "u",       'd', TD },
+    /* 285 */ { "fallocate",               "fxll",    'd', TD },
+    /* 286 */ { "timerfd_settime",         "fxpp",    'd', TD },
+    /* 287 */ { "timerfd_gettime",         "fp",      'd', TD },
+    /* 288 */ { "accept4",                 "fppx",    'd', TD|TN },
+    /* 289 */ { "signalfd4",               "fpzx",    'd', TD|TS },
+    /* 290 */ { "eventfd2",                "ux",      'd', TD },
+    /* 291 */ { "epoll_create1",           "x",       'd', TD },
+    /* 292 */ { "dup3",                    "ffx",     'd', TD },
+    /* 293 */ { "pipe2",                   "px",      'd', TD },
+    /* 294 */ { "inotify_init1",           "x",       'd', TD },
+    /* 295 */ { "preadv",                  "fpdld",   'd', TD },
+    /* 296 */ { "pwritev",                 "fpdld",   'd', TD },
+    /* 297 */ { "rt_tgsigqueueinfo",       "dddp",    'd', TS },
+    /* 298 */ { "perf_event_open",         "pdddx",   'd', TD },
+    /* 299 */ { "recvmmsg",                "fpuxp",   'd', TD|TN },
+    /* 300 */ { "fanotify_init",           "xx",      'd', TD },
+    /* 301 */ { "fanotify_mark",           "fxxfs",   'd', TF|TD },
+    /* 302 */ { "prlimit64",               "ddpp",    'd', 0 },
+    /* 303 */ { "name_to_handle_at",       "fsppx",   'd', TF|TD },
+    /* 304 */ { "open_by_handle_at",       "fpo",     'd', TD },
+    /* 305 */ { "clock_adjtime",           "dp",      'd', 0 },
+    /* 306 */ { "syncfs",                  "f",       'd', TD },
+    /* 307 */ { "sendmmsg",                "fpux",    'd', TD|TN },
+    /* 308 */ { "setns",                   "fx",      'd', TD },
+    /* 309 */ { "getcpu",                  "ppp",     'd', 0 },
+    /* 310 */ { "process_vm_readv",        "dpupux",  'd', 0 },
+    /* 311 */ { "process_vm_writev",       "dpupux",  'd', 0 },
+    /* 312 */ { "kcmp",                    "dddup",   'd', 0 },
+    /* 313 */ { "finit_module",            "fsx",     'd', TD },
+    /* 314 */ { "sched_setattr",           "dpx",     'd', 0 },
+    /* 315 */ { "sched_getattr",           "dpux",    'd', 0 },
+    /* 316 */ { "renameat2",               "fsfsx",   'd', TF|TD },
+    /* 317 */ { "seccomp",                 "uxp",     'd', 0 },
+    /* 318 */ { "getrandom",               "pzx",     'd', 0 },
+    /* 319 */ { "memfd_create",            "sx",      'd', TD },
+    /* 320 */ { "kexec_file_load",         "ffusx",   'd', TD },
+    /* 321 */ { "bpf",                     "dpu",     'd', 0 },
+    /* 322 */ { "execveat",                "fsppx",   'd', TF|TD|TP },
+    /* 323 */ { "userfaultfd",             "x",       'd', TD },
+    /* 324 */ { "membarrier",              "dx",      'd', 0 },
+    /* 325 */ { "mlock2",                  "pzx",     'd', TM },
+    /* 326 */ { "copy_file_range",         "fpfpzx",  'd', TD },
+    /* 327 */ { "preadv2",                 "fpdldx",  'd', TD },
+    /* 328 */ { "pwritev2",                "fpdldx",  'd', TD },
+    /* 329 */ { "pkey_mprotect",           "pzxd",    'd', TM },
+    /* 330 */ { "pkey_alloc",              "xx",      'd', 0 },
+    /* 331 */ { "pkey_free",               "d",       'd', 0 },
+    /* 332 */ { "statx",                   "fsxxp",   'd', TF|TD },
+    /* 333 */ { "io_pgetevents",           "uddppp",  'd', 0 },
+    /* 334 */ { "rseq",                    "puxu",    'd', 0 },
+    /* 335 */ { 0,                         0,         0,   0 },
+    /* 336 */ { 0,                         0,         0,   0 },
+    /* 337 */ { 0,                         0,         0,   0 },
+    /* 338 */ { 0,                         0,         0,   0 },
+    /* 339 */ { 0,                         0,         0,   0 },
+    /* 340 */ { 0,                         0,         0,   0 },
+    /* 341 */ { 0,                         0,         0,   0 },
+    /* 342 */ { 0,                         0,         0,   0 },
+    /* 343 */ { 0,                         0,         0,   0 },
+    /* 344 */ { 0,                         0,         0,   0 },
+    /* 345 */ { 0,                         0,         0,   0 },
+    /* 346 */ { 0,                         0,         0,   0 },
+    /* 347 */ { 0,                         0,         0,   0 },
+    /* 348 */ { 0,                         0,         0,   0 },
+    /* 349 */ { 0,                         0,         0,   0 },
+    /* 350 */ { 0,                         0,         0,   0 },
+    /* 351 */ { 0,                         0,         0,   0 },
+    /* 352 */ { 0,                         0,         0,   0 },
+    /* 353 */ { 0,                         0,         0,   0 },
+    /* 354 */ { 0,                         0,         0,   0 },
+    /* 355 */ { 0,                         0,         0,   0 },
+    /* 356 */ { 0,                         0,         0,   0 },
+    /* 357 */ { 0,                         0,         0,   0 },
+    /* 358 */ { 0,                         0,         0,   0 },
+    /* 359 */ { 0,                         0,         0,   0 },
+    /* 360 */ { 0,                         0,         0,   0 },
+    /* 361 */ { 0,                         0,         0,   0 },
+    /* 362 */ { 0,                         0,         0,   0 },
+    /* 363 */ { 0,                         0,         0,   0 },
+    /* 364 */ { 0,                         0,         0,   0 },
+    /* 365 */ { 0,                         0,         0,   0 },
+    /* 366 */ { 0,                         0,         0,   0 },
+    /* 367 */ { 0,                         0,         0,   0 },
+    /* 368 */ { 0,                         0,         0,   0 },
+    /* 369 */ { 0,                         0,         0,   0 },
+    /* 370 */ { 0,                         0,         0,   0 },
+    /* 371 */ { 0,                         0,         0,   0 },
+    /* 372 */ { 0,                         0,         0,   0 },
+    /* 373 */ { 0,                         0,         0,   0 },
+    /* 374 */ { 0,                         0,         0,   0 },
+    /* 375 */ { 0,                         0,         0,   0 },
+    /* 376 */ { 0,                         0,         0,   0 },
+    /* 377 */ { 0,                         0,         0,   0 },
+    /* 378 */ { 0,                         0,         0,   0 },
+    /* 379 */ { 0,                         0,         0,   0 },
+    /* 380 */ { 0,                         0,         0,   0 },
+    /* 381 */ { 0,                         0,         0,   0 },
+    /* 382 */ { 0,                         0,         0,   0 },
+    /* 383 */ { 0,                         0,         0,   0 },
+    /* 384 */ { 0,                         0,         0,   0 },
+    /* 385 */ { 0,                         0,         0,   0 },
+    /* 386 */ { 0,                         0,         0,   0 },
+    /* 387 */ { 0,                         0,         0,   0 },
+    /* 388 */ { 0,                         0,         0,   0 },
+    /* 389 */ { 0,                         0,         0,   0 },
+    /* 390 */ { 0,                         0,         0,   0 },
+    /* 391 */ { 0,                         0,         0,   0 },
+    /* 392 */ { 0,                         0,         0,   0 },
+    /* 393 */ { 0,                         0,         0,   0 },
+    /* 394 */ { 0,                         0,         0,   0 },
+    /* 395 */ { 0,                         0,         0,   0 },
+    /* 396 */ { 0,                         0,         0,   0 },
+    /* 397 */ { 0,                         0,         0,   0 },
+    /* 398 */ { 0,                         0,         0,   0 },
+    /* 399 */ { 0,                         0,         0,   0 },
+    /* 400 */ { 0,                         0,         0,   0 },
+    /* 401 */ { 0,                         0,         0,   0 },
+    /* 402 */ { 0,                         0,         0,   0 },
+    /* 403 */ { 0,                         0,         0,   0 },
+    /* 404 */ { 0,                         0,         0,   0 },
+    /* 405 */ { 0,                         0,         0,   0 },
+    /* 406 */ { 0,                         0,         0,   0 },
+    /* 407 */ { 0,                         0,         0,   0 },
+    /* 408 */ { 0,                         0,         0,   0 },
+    /* 409 */ { 0,                         0,         0,   0 },
+    /* 410 */ { 0,                         0,         0,   0 },
+    /* 411 */ { 0,                         0,         0,   0 },
+    /* 412 */ { 0,                         0,         0,   0 },
+    /* 413 */ { 0,                         0,         0,   0 },
+    /* 414 */ { 0,                         0,         0,   0 },
+    /* 415 */ { 0,                         0,         0,   0 },
+    /* 416 */ { 0,                         0,         0,   0 },
+    /* 417 */ { 0,                         0,         0,   0 },
+    /* 418 */ { 0,                         0,         0,   0 },
+    /* 419 */ { 0,                         0,         0,   0 },
+    /* 420 */ { 0,                         0,         0,   0 },
+    /* 421 */ { 0,                         0,         0,   0 },
+    /* 422 */ { 0,                         0,         0,   0 },
+    /* 423 */ { 0,                         0,         0,   0 },
+    /* 424 */ { "pidfd_send_signal",       "fdpx",    'd', TD|TS },
+    /* 425 */ { "io_uring_setup",          "up",      'd', TD },
+    /* 426 */ { "io_uring_enter",          "fuuxpz",  'd', TD },
+    /* 427 */ { "io_uring_register",       "fupu",    'd', TD },
+    /* 428 */ { "open_tree",               "fsx",     'd', TF|TD },
+    /* 429 */ { "move_mount",              "fsfsx",   'd', TF|TD },
+    /* 430 */ { "fsopen",                  "sx",      'd', TD },
+    /* 431 */ { "fsconfig",                "fdssd",   'd', TD },
+    /* 432 */ { "fsmount",                 "fxx",     'd', TD },
+    /* 433 */ { "fspick",                  "fsx",     'd', TF|TD },
+    /* 434 */ { "pidfd_open",              "dx",      'd', TD },
+    /* 435 */ { "clone3",                  "pz",      'd', TP },
+    /* 436 */ { "close_range",             "uux",     'd', 0 },
+    /* 437 */ { "openat2",                 "fspz",    'd', TF|TD },
+    /* 438 */ { "pidfd_getfd",             "ffx",     'd', TD },
+    /* 439 */ { "faccessat2",              "fsdx",    'd', TF|TD },
+    /* 440 */ { "process_madvise",         "fpzdx",   'd', TD|TM },
+    /* 441 */ { "epoll_pwait2",            "fpdppz",  'd', TD },
+    /* 442 */ { "mount_setattr",           "fsxpz",   'd', TF|TD },
+    /* 443 */ { "quotactl_fd",             "fxdp",    'd', TD },
+    /* 444 */ { "landlock_create_ruleset", "pzx",     'd', TD },
+    /* 445 */ { "landlock_add_rule",       "fdpx",    'd', TD },
+    /* 446 */ { "landlock_restrict_self",  "fx",      'd', TD },
+    /* 447 */ { "memfd_secret",            "x",       'd', TD },
+    /* 448 */ { "process_mrelease",        "fx",      'd', TD },
+    /* 449 */ { "futex_waitv",             "puxpd",   'd', 0 },
+    /* 450 */ { "set_mempolicy_home_node", "uuux",    'd', TM }
+};
@@ -0,0 +1,230 @@
+/*! @file
+ *  Render a binary trace written by "BtraceTool -binary" as strace-style
+ *  text or as CSV.
+ *
+ *  Usage: btrace-decode [-csv] <trace file>
+ *
+ *  Records are written per thread, one buffer at a time, so the records of
+ *  a thread are in order but the buffers of different threads are not. The
+ *  decoder first notes where the runs of records of each thread are, then
+ *  merges the threads by the time stamp taken at system call entry, with
+ *  one record of each thread in memory, so traces larger than memory can
+ *  be decoded.
+ */
+
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <vector>
+#include <map>
+#include <queue>
+#include "BtraceFormat.h"
+
+using std::vector;
+using std::map;
+
+// Records of one thread that follow each other in the file.
+struct RUN
+{
+    off_t    offset;        // of the first record
+    uint64_t records;
+};
+
+// The records of one thread, read one at a time.
+struct STREAM
+{
+    vector<RUN>  runs;
+    size_t       run;       // run of the next record
+    uint64_t     left;      // records left in it
+    off_t        next;      // offset of the next record
+    off_t        at;        // offset of the record in data
+    vector<char> data;      // the current record and its payload
+};
+
+/*!
+ * Orders streams by the entry time stamp of their current record, the
+ * earlier one first; records of the same time stamp in file order.
+ */
+struct LaterEntry
+{
+    bool operator()(const STREAM * a, const STREAM * b) const
+    {
+        const BTRACE_RECORD * ra = reinterpret_cast<const BTRACE_RECORD *>(&a->data[0]);
+        const BTRACE_RECORD * rb = reinterpret_cast<const BTRACE_RECORD *>(&b->data[0]);
+        return ra->tsc != rb->tsc ? ra->tsc > rb->tsc : a->at > b->at;
+    }
+};
+
+/*!
+ * Read the next record of a stream into its data.
+ * @return false if the stream has no record left, or it cannot be read
+ */
+static bool ReadNext(FILE * in, STREAM * stream)
+{
+    while (stream->left == 0)
+    {
+        if (++stream->run >= stream->runs.size()) { return false; }
+        stream->left = stream->runs[stream->run].records;
+        stream->next = stream->runs[stream->run].offset;
+    }
+
+    BTRACE_RECORD rec;
+    if (fseeko(in, stream->next, SEEK_SET) != 0 || fread(&rec, sizeof(rec), 1, in) != 1) { return false; }
+
+    size_t size = BtraceRecordSize(&rec);
+    stream->data.resize(size);
+    memcpy(&stream->data[0], &rec, sizeof(rec));
+    if (fread(&stream->data[sizeof(rec)], 1, size - sizeof(rec), in) != size - sizeof(rec)) { return false; }
+
+    stream->at = stream->next;
+    stream->next += size;
+    stream->left--;
+    return true;
+}
+
+/*!
+ * Print one record as a CSV row. The decoded call goes into the last column.
+ */
+static void PrintCsv(FILE * out, const SYSCALL_DESC * desc, const BTRACE_RECORD * rec, uint32_t abi)
+{
+    char * text = 0;
+    size_t size = 0;
+    FILE * mem = open_memstream(&text, &size);
+
+    BtracePrintCall(mem, desc, rec, abi);
+    fclose(mem);
+
+    fprintf(out, "%llu,%u,%u,%s", (unsigned long long)rec->tsc, rec->tid, rec->num,
+            desc != 0 ? desc->name : "");
+    for (unsigned i = 0; i < BTRACE_MAX_ARGS; i++)
+    {
+        fprintf(out, ",0x%llx", (unsigned long long)rec->args[i]);
+    }
+    if (rec->flags & BTRACE_NORETURN)
+        fprintf(out, ",");
+    else
+        fprintf(out, ",%lld", (long long)rec->ret);
+
+    // Quote the decoded call, doubling the quotes inside it.
+    fputs(",\"", out);
+    for (const char * p = text; *p != '\0'; p++)
+    {
+        if (*p == '"') { fputc('"', out); }
+        fputc(*p, out);
+    }
+    fputs("\"\n", out);
+
+    free(text);
+}
+
+int main(int argc, char * argv[])
+{
+    bool csv = false;
+    const char * path = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-csv") == 0)
+            csv = true;
+        else
+            path = argv[i];
+    }
+
+    if (path == 0)
+    {
+        fprintf(stderr, "usage: %s [-csv] <trace file>\n", argv[0]);
+        return 1;
+    }
+
+    FILE * in = fopen(path, "rb");
+    if (in == 0)
+    {
+        perror(path);
+        return 1;
+    }
+
+    BTRACE_FILE_HEADER header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, BTRACE_MAGIC, sizeof(BTRACE_MAGIC)) != 0
+        || header.recordSize != sizeof(BTRACE_RECORD))
+    {
+        fprintf(stderr, "%s: not a btrace binary trace\n", path);
+        return 1;
+    }
+
+    const SYSCALL_DESC * table = SyscallTableI386;
+    unsigned long tableSize = SYSCALL_TABLE_SIZE(SyscallTableI386);
+    if (header.abi == BTRACE_ABI_X86_64)
+    {
+        table = SyscallTableX86_64;
+        tableSize = SYSCALL_TABLE_SIZE(SyscallTableX86_64);
+    }
+
+    fseeko(in, 0, SEEK_END);
+    off_t end = ftello(in);
+
+    // Find the runs of every thread, reading only the fixed part of each record.
+    map<uint32_t, STREAM> streams;
+    STREAM * last = 0;
+    off_t offset = sizeof(header);
+    BTRACE_RECORD rec;
+    while (fseeko(in, offset, SEEK_SET) == 0 && fread(&rec, sizeof(rec), 1, in) == 1)
+    {
+        if (offset + (off_t)BtraceRecordSize(&rec) > end)
+        {
+            fprintf(stderr, "%s: truncated record at offset %llu\n", path, (unsigned long long)offset);
+            break;
+        }
+
+        STREAM * stream = &streams[rec.tid];
+        if (stream != last)
+        {
+            RUN run = { offset, 0 };
+            stream->runs.push_back(run);
+            last = stream;
+        }
+        stream->runs.back().records++;
+        offset += BtraceRecordSize(&rec);
+    }
+
+    std::priority_queue<STREAM *, vector<STREAM *>, LaterEntry> merge;
+    for (map<uint32_t, STREAM>::iterator it = streams.begin(); it != streams.end(); ++it)
+    {
+        STREAM * stream = &it->second;
+        stream->run = 0;
+        stream->left = stream->runs[0].records;
+        stream->next = stream->runs[0].offset;
+        if (ReadNext(in, stream)) { merge.push(stream); }
+    }
+
+    if (csv)
+        printf("tsc,tid,nr,name,arg0,arg1,arg2,arg3,arg4,arg5,ret,call\n");
+
+    while (!merge.empty())
+    {
+        STREAM * stream = merge.top();
+        merge.pop();
+
+        const BTRACE_RECORD * rec = reinterpret_cast<const BTRACE_RECORD *>(&stream->data[0]);
+        const SYSCALL_DESC * desc = SyscallLookup(table, tableSize, rec->num);
+
+        if (csv)
+        {
+            PrintCsv(stdout, desc, rec, header.abi);
+        }
+        else
+        {
+            printf("[pid %u] ", rec->tid);
+            BtracePrintCall(stdout, desc, rec, header.abi);
+            BtracePrintReturn(stdout, desc, rec, header.abi);
+            printf("\n");
+        }
+
+        if (ReadNext(in, stream)) { merge.push(stream); }
+    }
+
+    fclose(in);
+    return 0;
+}
@@ -0,0 +1,615 @@
+/*! @file
+ *  Issue the file I/O recorded by "BtraceTool -replay_log" again, without
+ *  the application, and report throughput and latency. Run it on different
+ *  file systems or mount options to compare them under a real workload.
+ *
+ *  Usage: btrace-replay [-scratch dir] [-speed factor] [-threads n] <replay log>
+ *
+ *      -scratch dir    directory the I/O goes to (default ./btrace-scratch)
+ *      -speed factor   1 keeps the recorded gaps between calls, 2 halves
+ *                      them, 0 issues every call as soon as the last one
+ *                      returned (default 1)
+ *      -threads n      run n copies of the workload at the same time, each
+ *                      in its own subdirectory of the scratch directory
+ *                      (default 1)
+ *
+ *  Every line of the log is one completed system call:
+ *
+ *      <start ns> <tid> <duration ns> <op> <return value> <operands...>
+ *
+ *      open      <path> <flags, hex> <mode, octal>    returns the descriptor
+ *      close     <fd>
+ *      read      <fd> <size>
+ *      write     <fd> <size>
+ *      pread     <fd> <size> <offset>
+ *      pwrite    <fd> <size> <offset>
+ *      lseek     <fd> <offset> <whence>
+ *      fsync     <fd>
+ *      fdatasync <fd>
+ *      ftruncate <fd> <length>
+ *      stat      <path>
+ *      unlink    <path>
+ *      mkdir     <path> <mode, octal>
+ *      rmdir     <path>
+ *      rename    <old path> <new path>
+ *
+ *  Paths have blanks, '%' and unprintable bytes written as %XX. Every path,
+ *  absolute or relative, is replayed below the scratch directory. Calls on
+ *  descriptors the log did not open (the terminal, pipes, sockets) are
+ *  skipped. Before the replay starts, the files the application found in
+ *  place are created and filled up to the last byte it read from them, so
+ *  that reads hit real data; paths it failed to open or stat are left out.
+ *  The calls of all application threads are replayed in the order they
+ *  started, by one thread per copy.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+
+using std::string;
+using std::vector;
+using std::map;
+using std::set;
+
+enum OP_TYPE
+{
+    OP_OPEN, OP_CLOSE, OP_READ, OP_WRITE, OP_PREAD, OP_PWRITE, OP_LSEEK, OP_FSYNC,
+    OP_FDATASYNC, OP_FTRUNCATE, OP_STAT, OP_UNLINK, OP_MKDIR, OP_RMDIR, OP_RENAME, NUM_OPS
+};
+
+static const char * OpNames[NUM_OPS] =
+{
+    "open", "close", "read", "write", "pread", "pwrite", "lseek", "fsync",
+    "fdatasync", "ftruncate", "stat", "unlink", "mkdir", "rmdir", "rename"
+};
+
+// One recorded call.
+struct OP
+{
+    unsigned long long start;   // recorded start time, ns
+    unsigned long long dur;     // recorded latency, ns
+    int       type;             // OP_*
+    long long ret;              // recorded return value
+    int       fd;               // descriptor operand
+    long long size;             // bytes, or new length for ftruncate
+    long long offset;           // pread/pwrite/lseek offset
+    int       whence;           // lseek whence
+    int       flags;            // open flags
+    int       mode;             // open/mkdir mode
+    string    path;             // first path operand
+    string    path2;            // second path operand of rename
+};
+
+// A file to create before the replay starts.
+struct SEED
+{
+    bool      dir;              // create a directory, not a file
+    long long size;             // bytes of data to put in the file
+};
+
+// Latencies of one copy of the workload, by op type.
+struct COPY_STATS
+{
+    vector<double> latency[NUM_OPS];   // microseconds
+    unsigned long  diverged;           // calls whose success differed from the recording
+    long long      bytesRead;
+    long long      bytesWritten;
+};
+
+struct COPY
+{
+    const vector<OP> * ops;
+    string             root;
+    double             speed;
+    char *             buffer;
+    COPY_STATS         stats;
+};
+
+static inline unsigned long long NowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*!
+ * Undo the %XX escapes of a path in the log.
+ */
+static string UnescapePath(const char * text)
+{
+    string out;
+    for (const char * p = text; *p != '\0'; p++)
+    {
+        if (p[0] == '%' && p[1] != '\0' && p[2] != '\0')
+        {
+            char hex[3] = { p[1], p[2], '\0' };
+            out += (char)strtol(hex, 0, 16);
+            p += 2;
+        }
+        else
+        {
+            out += *p;
+        }
+    }
+    return out;
+}
+
+/*!
+ * Parse one line of the log.
+ * @return false for comments and lines that are not understood
+ */
+static bool ParseOp(char * line, OP * op)
+{
+    char * field[8];
+    int n = 0;
+
+    for (char * tok = strtok(line, " \t\n"); tok != 0 && n < 8; tok = strtok(0, " \t\n"))
+    {
+        field[n++] = tok;
+    }
+    if (n < 5 || field[0][0] == '#') { return false; }
+
+    op->type = -1;
+    for (int i = 0; i < NUM_OPS; i++)
+    {
+        if (strcmp(field[3], OpNames[i]) == 0) { op->type = i; }
+    }
+    if (op->type < 0) { return false; }
+
+    op->start = strtoull(field[0], 0, 10);
+    op->dur = strtoull(field[2], 0, 10);
+    op->ret = strtoll(field[4], 0, 10);
+    op->fd = -1;
+    op->size = op->offset = 0;
+    op->whence = op->flags = op->mode = 0;
+
+    char ** arg = field + 5;
+    int nargs = n - 5;
+
+    switch (op->type)
+    {
+      case OP_OPEN:
+        if (nargs < 3) { return false; }
+        op->path = UnescapePath(arg[0]);
+        op->flags = (int)strtol(arg[1], 0, 16);
+        op->mode = (int)strtol(arg[2], 0, 8);
+        break;
+      case OP_READ:
+      case OP_WRITE:
+      case OP_FTRUNCATE:
+        if (nargs < 2) { return false; }
+        op->fd = atoi(arg[0]);
+        op->size = strtoll(arg[1], 0, 10);
+        break;
+      case OP_PREAD:
+      case OP_PWRITE:
+        if (nargs < 3) { return false; }
+        op->fd = atoi(arg[0]);
+        op->size = strtoll(arg[1], 0, 10);
+        op->offset = strtoll(arg[2], 0, 10);
+        break;
+      case OP_LSEEK:
+        if (nargs < 3) { return false; }
+        op->fd = atoi(arg[0]);
+        op->offset = strtoll(arg[1], 0, 10);
+        op->whence = atoi(arg[2]);
+        break;
+      case OP_CLOSE:
+      case OP_FSYNC:
+      case OP_FDATASYNC:
+        if (nargs < 1) { return false; }
+        op->fd = atoi(arg[0]);
+        break;
+      case OP_MKDIR:
+        if (nargs < 2) { return false; }
+        op->path = UnescapePath(arg[0]);
+        op->mode = (int)strtol(arg[1], 0, 8);
+        break;
+      case OP_RENAME:
+        if (nargs < 2) { return false; }
+        op->path = UnescapePath(arg[0]);
+        op->path2 = UnescapePath(arg[1]);
+        break;
+      default:
+        if (nargs < 1) { return false; }
+        op->path = UnescapePath(arg[0]);
+        break;
+    }
+    return true;
+}
+
+/*!
+ * Orders calls by the time they were made.
+ */
+static bool EarlierStart(const OP & a, const OP & b)
+{
+    return a.start < b.start;
+}
+
+static bool Succeeded(const OP & op)
+{
+    return op.ret >= 0;
+}
+
+/*!
+ * Seed the directories on the way to a path, unless the workload made them.
+ */
+static void SeedParents(map<string, SEED> & seeds, const set<string> & made, const string & path)
+{
+    for (size_t at = path.find('/', 1); at != string::npos; at = path.find('/', at + 1))
+    {
+        string dir = path.substr(0, at);
+        if (made.count(dir) == 0 && seeds.count(dir) == 0)
+        {
+            SEED seed = { true, 0 };
+            seeds[dir] = seed;
+        }
+    }
+}
+
+/*!
+ * Work out which files and directories the application found in place,
+ * and how much data it read from each, by following the recorded
+ * descriptors and file positions.
+ */
+static map<string, SEED> FindSeeds(const vector<OP> & ops)
+{
+    map<string, SEED> seeds;
+    set<string> made;                   // created by the workload itself
+    map<int, string> paths;             // open descriptors
+    map<int, long long> position;
+
+    for (size_t i = 0; i < ops.size(); i++)
+    {
+        const OP & op = ops[i];
+        bool ok = Succeeded(op);
+
+        if (!op.path.empty()) { SeedParents(seeds, made, op.path); }
+        if (!op.path2.empty()) { SeedParents(seeds, made, op.path2); }
+
+        switch (op.type)
+        {
+          case OP_OPEN:
+            if (!ok) { break; }
+            if (made.count(op.path) == 0 && seeds.count(op.path) == 0)
+            {
+                // A file that was created by this open needs no seed.
+                if ((op.flags & O_CREAT) && (op.flags & (O_EXCL | O_TRUNC)))
+                    made.insert(op.path);
+                else
+                {
+                    SEED seed = { (op.flags & O_DIRECTORY) != 0, 0 };
+                    seeds[op.path] = seed;
+                }
+            }
+            paths[(int)op.ret] = op.path;
+            position[(int)op.ret] = 0;
+            break;
+          case OP_CLOSE:
+            paths.erase(op.fd);
+            break;
+          case OP_READ:
+          case OP_PREAD:
+          case OP_WRITE:
+          case OP_PWRITE:
+          {
+            if (!ok || paths.count(op.fd) == 0) { break; }
+            bool positioned = op.type == OP_PREAD || op.type == OP_PWRITE;
+            long long at = positioned ? op.offset : position[op.fd];
+            long long end = at + op.ret;
+            bool read = op.type == OP_READ || op.type == OP_PREAD;
+
+            if (read && seeds.count(paths[op.fd]) && end > seeds[paths[op.fd]].size)
+                seeds[paths[op.fd]].size = end;
+            if (!positioned) { position[op.fd] = end; }
+            break;
+          }
+          case OP_LSEEK:
+            if (ok && paths.count(op.fd)) { position[op.fd] = op.ret; }
+            break;
+          case OP_STAT:
+            if (ok && made.count(op.path) == 0 && seeds.count(op.path) == 0)
+            {
+                SEED seed = { false, 0 };
+                seeds[op.path] = seed;
+            }
+            break;
+          case OP_MKDIR:
+            if (ok) { made.insert(op.path); }
+            break;
+          case OP_RENAME:
+            if (ok) { made.insert(op.path2); }
+            break;
+          default:
+            break;
+        }
+    }
+    return seeds;
+}
+
+/*!
+ * @return the place of a recorded path below a copy's root
+ */
+static string Remap(const string & root, const string & path)
+{
+    size_t skip = 0;
+    while (skip < path.size() && path[skip] == '/') { skip++; }
+    return root + "/" + path.substr(skip);
+}
+
+/*!
+ * Create every directory on the way to a path, like "mkdir -p" of its parent.
+ */
+static void MakeParents(const string & path)
+{
+    for (size_t at = path.find('/', 1); at != string::npos; at = path.find('/', at + 1))
+    {
+        mkdir(path.substr(0, at).c_str(), 0755);
+    }
+}
+
+/*!
+ * Create the seeds of one copy and fill the files with data.
+ */
+static bool PlantSeeds(const string & root, const map<string, SEED> & seeds, char * buffer, size_t bufsize)
+{
+    for (map<string, SEED>::const_iterator it = seeds.begin(); it != seeds.end(); ++it)
+    {
+        string path = Remap(root, it->first);
+        MakeParents(path);
+
+        if (it->second.dir)
+        {
+            mkdir(path.c_str(), 0755);
+            continue;
+        }
+
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            perror(path.c_str());
+            return false;
+        }
+        for (long long done = 0; done < it->second.size; )
+        {
+            size_t chunk = it->second.size - done < (long long)bufsize ? it->second.size - done : bufsize;
+            ssize_t n = write(fd, buffer, chunk);
+            if (n <= 0) { perror(path.c_str()); close(fd); return false; }
+            done += n;
+        }
+        fsync(fd);
+        close(fd);
+    }
+    return true;
+}
+
+/*!
+ * Replay the whole log once, below copy->root.
+ */
+static void * ReplayCopy(void * arg)
+{
+    COPY * copy = static_cast<COPY *>(arg);
+    const vector<OP> & ops = *copy->ops;
+    map<int, int> fds;                  // recorded descriptor -> real one
+    unsigned long long base = NowNs();
+    struct stat st;
+
+    for (size_t i = 0; i < ops.size(); i++)
+    {
+        const OP & op = ops[i];
+
+        if (copy->speed > 0)
+        {
+            unsigned long long due = base + (unsigned long long)((op.start - ops[0].start) / copy->speed);
+            unsigned long long now = NowNs();
+            if (due > now)
+            {
+                struct timespec ts = { (time_t)((due - now) / 1000000000ULL), (long)((due - now) % 1000000000ULL) };
+                nanosleep(&ts, 0);
+            }
+        }
+
+        bool hasFd = op.fd >= 0 && fds.count(op.fd) != 0;
+        int fd = hasFd ? fds[op.fd] : -1;
+        bool needsFd = op.type != OP_OPEN && op.type != OP_STAT && op.type != OP_UNLINK
+                    && op.type != OP_MKDIR && op.type != OP_RMDIR && op.type != OP_RENAME;
+        if (needsFd && !hasFd) { continue; }
+
+        string path = op.path.empty() ? "" : Remap(copy->root, op.path);
+        long long ret = 0;
+        unsigned long long start = NowNs();
+
+        switch (op.type)
+        {
+          case OP_OPEN:      ret = open(path.c_str(), op.flags, op.mode); break;
+          case OP_CLOSE:     ret = close(fd); fds.erase(op.fd); break;
+          case OP_READ:      ret = read(fd, copy->buffer, op.size); break;
+          case OP_WRITE:     ret = write(fd, copy->buffer, op.size); break;
+          case OP_PREAD:     ret = pread(fd, copy->buffer, op.size, op.offset); break;
+          case OP_PWRITE:    ret = pwrite(fd, copy->buffer, op.size, op.offset); break;
+          case OP_LSEEK:     ret = lseek(fd, op.offset, op.whence); break;
+          case OP_FSYNC:     ret = fsync(fd); break;
+          case OP_FDATASYNC: ret = fdatasync(fd); break;
+          case OP_FTRUNCATE: ret = ftruncate(fd, op.size); break;
+          case OP_STAT:      ret = stat(path.c_str(), &st); break;
+          case OP_UNLINK:    ret = unlink(path.c_str()); break;
+          case OP_MKDIR:     ret = mkdir(path.c_str(), op.mode); break;
+          case OP_RMDIR:     ret = rmdir(path.c_str()); break;
+          case OP_RENAME:
+            MakeParents(Remap(copy->root, op.path2));
+            ret = rename(path.c_str(), Remap(copy->root, op.path2).c_str());
+            break;
+        }
+
+        copy->stats.latency[op.type].push_back((NowNs() - start) / 1000.0);
+        if ((ret >= 0) != Succeeded(op)) { copy->stats.diverged++; }
+
+        if (op.type == OP_OPEN && ret >= 0)
+        {
+            // The recording may have missed a close, e.g. across exec.
+            if (fds.count((int)op.ret)) { close(fds[(int)op.ret]); }
+            fds[(int)op.ret] = (int)ret;
+        }
+        if ((op.type == OP_READ || op.type == OP_PREAD) && ret > 0)  { copy->stats.bytesRead += ret; }
+        if ((op.type == OP_WRITE || op.type == OP_PWRITE) && ret > 0) { copy->stats.bytesWritten += ret; }
+    }
+
+    for (map<int, int>::iterator it = fds.begin(); it != fds.end(); ++it) { close(it->second); }
+    return 0;
+}
+
+/*!
+ * @return the p-th percentile of sorted latencies
+ */
+static double Percentile(const vector<double> & sorted, double p)
+{
+    if (sorted.empty()) { return 0; }
+    size_t i = (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[i];
+}
+
+int main(int argc, char * argv[])
+{
+    const char * scratch = "btrace-scratch";
+    double speed = 1.0;
+    int threads = 1;
+    const char * path = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-scratch") == 0 && i + 1 < argc)       scratch = argv[++i];
+        else if (strcmp(argv[i], "-speed") == 0 && i + 1 < argc)    speed = atof(argv[++i]);
+        else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)  threads = atoi(argv[++i]);
+        else                                                        path = argv[i];
+    }
+
+    if (path == 0 || threads < 1 || speed < 0)
+    {
+        fprintf(stderr, "usage: %s [-scratch dir] [-speed factor] [-threads n] <replay log>\n", argv[0]);
+        return 1;
+    }
+
+    FILE * in = fopen(path, "r");
+    if (in == 0)
+    {
+        perror(path);
+        return 1;
+    }
+
+    vector<OP> ops;
+    char line[16384];
+    long long maxSize = 1 << 20;
+    while (fgets(line, sizeof(line), in) != 0)
+    {
+        OP op;
+        if (!ParseOp(line, &op)) { continue; }
+        if (op.size > maxSize && op.type != OP_FTRUNCATE) { maxSize = op.size; }
+        ops.push_back(op);
+    }
+    fclose(in);
+
+    if (ops.empty())
+    {
+        fprintf(stderr, "%s: no calls to replay\n", path);
+        return 1;
+    }
+
+    // Threads of the application wrote their lines as their calls returned.
+    std::stable_sort(ops.begin(), ops.end(), EarlierStart);
+
+    map<string, SEED> seeds = FindSeeds(ops);
+    vector<COPY> copies(threads);
+
+    mkdir(scratch, 0755);
+    for (int i = 0; i < threads; i++)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "/copy%d", i);
+
+        copies[i].ops = &ops;
+        copies[i].root = string(scratch) + name;
+        copies[i].speed = speed;
+        // Calls on files opened with O_DIRECT need a page aligned buffer.
+        void * buffer = 0;
+        if (posix_memalign(&buffer, 4096, maxSize) != 0)
+        {
+            fprintf(stderr, "%s: cannot allocate %lld bytes\n", argv[0], maxSize);
+            return 1;
+        }
+        copies[i].buffer = static_cast<char *>(buffer);
+        memset(copies[i].buffer, 'x', maxSize);
+        copies[i].stats.diverged = 0;
+        copies[i].stats.bytesRead = 0;
+        copies[i].stats.bytesWritten = 0;
+
+        mkdir(copies[i].root.c_str(), 0755);
+        if (!PlantSeeds(copies[i].root, seeds, copies[i].buffer, maxSize)) { return 1; }
+    }
+
+    unsigned long long start = NowNs();
+    vector<pthread_t> tids(threads);
+    for (int i = 0; i < threads; i++) { pthread_create(&tids[i], 0, ReplayCopy, &copies[i]); }
+    for (int i = 0; i < threads; i++) { pthread_join(tids[i], 0); }
+    double elapsed = (NowNs() - start) / 1e9;
+
+    // Merge the copies and report.
+    vector<double> latency[NUM_OPS];
+    double recorded[NUM_OPS] = { 0 };
+    unsigned long recordedCalls[NUM_OPS] = { 0 };
+    unsigned long diverged = 0, calls = 0;
+    long long bytesRead = 0, bytesWritten = 0;
+
+    for (int i = 0; i < threads; i++)
+    {
+        for (int t = 0; t < NUM_OPS; t++)
+        {
+            latency[t].insert(latency[t].end(), copies[i].stats.latency[t].begin(), copies[i].stats.latency[t].end());
+        }
+        diverged += copies[i].stats.diverged;
+        bytesRead += copies[i].stats.bytesRead;
+        bytesWritten += copies[i].stats.bytesWritten;
+    }
+    for (size_t i = 0; i < ops.size(); i++)
+    {
+        recorded[ops[i].type] += ops[i].dur / 1000.0;
+        recordedCalls[ops[i].type]++;
+    }
+
+    printf("replayed %s: %lu calls recorded, %d cop%s, speed %g, %lu file%s seeded\n", path,
+        (unsigned long)ops.size(), threads, threads == 1 ? "y" : "ies", speed,
+        (unsigned long)seeds.size(), seeds.size() == 1 ? "" : "s");
+    printf("\n%-10s %10s %12s %12s %12s %12s %14s\n", "op", "calls", "mean us", "p50 us", "p99 us", "max us", "recorded us");
+    for (int t = 0; t < NUM_OPS; t++)
+    {
+        if (latency[t].empty()) { continue; }
+        std::sort(latency[t].begin(), latency[t].end());
+
+        double sum = 0;
+        for (size_t i = 0; i < latency[t].size(); i++) { sum += latency[t][i]; }
+        calls += latency[t].size();
+
+        printf("%-10s %10lu %12.2f %12.2f %12.2f %12.2f %14.2f\n", OpNames[t], (unsigned long)latency[t].size(),
+            sum / latency[t].size(), Percentile(latency[t], 50), Percentile(latency[t], 99),
+            latency[t].back(), recordedCalls[t] ? recorded[t] / recordedCalls[t] : 0.0);
+    }
+
+    printf("\nelapsed %.3f s, %.0f calls/s, read %.2f MB/s, written %.2f MB/s\n", elapsed,
+        calls / elapsed, bytesRead / elapsed / 1e6, bytesWritten / elapsed / 1e6);
+    if (diverged != 0)
+    {
+        printf("%lu calls succeeded or failed unlike in the recording\n", diverged);
+    }
+    return 0;
+}
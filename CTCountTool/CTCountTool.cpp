@@ -7,9 +7,19 @@
 #include "pin.H"
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <stdio.h>
+#include "ScopeFilter.h"
+#include "SelfProf.h"
+#include "Attach.h"
 using std::cerr;
 using std::string;
 using std::endl;
+using std::vector;
+using std::map;
 /* ================================================================== */
 // Global variables 
 /* ================================================================== */
@@ -19,6 +29,61 @@ UINT64 indirectCTCount = 0;
 UINT64 otherCTCount = 0;
 PIN_LOCK lock1, lock2, lock3;
 std::ostream * out = &cerr;
+UINT32 profDirect, profIndirect, profOther, profMix, profIns;    // kinds of the -selfprof report
+
+// -mix: what an instruction is, one bit each; an instruction may be several.
+// Scalar and packed follow the SIMD_SCALAR attribute of XED.
+enum MIX
+{
+    MIX_INS,                // every instruction
+    MIX_X87,
+    MIX_SSE_SCALAR,         // SSE to SSE4
+    MIX_SSE_PACKED,
+    MIX_AVX_SCALAR,         // AVX, AVX2, FMA, F16C
+    MIX_AVX_PACKED,
+    MIX_AVX512_SCALAR,
+    MIX_AVX512_PACKED,
+    MIX_STRING,             // string instructions, with or without REP
+    MIX_LOCK,               // lock prefix, or XCHG with memory
+    MIX_DIV,                // integer and floating point divides
+    MIX_DIRECT,             // direct control flow transfers
+    MIX_INDIRECT,           // indirect control flow transfers
+    MIX_KINDS
+};
+
+static const char * MixNames[MIX_KINDS] =
+{
+    "ins", "x87", "sse.s", "sse.p", "avx.s", "avx.p", "avx512.s", "avx512.p",
+    "string", "lock", "div", "direct", "indirect"
+};
+
+// -mix: a basic block, by the address it starts at and its length, with the
+// kinds of its instructions, found once when it is first instrumented. Pin
+// may cut a block short in one trace and not in another, so blocks that
+// start at the same address are told apart by how many instructions they hold.
+// When its image is unloaded a block is added into its routine and dropped,
+// as another image may then be loaded at its address.
+struct MIX_BLOCK
+{
+    UINT64  runs;
+    UINT32  routine;            // in mixRoutines
+    ADDRINT address;
+    UINT32  mix[MIX_KINDS];     // instructions of each kind
+};
+
+// -mix: a routine, its loops and the instructions its retired blocks executed.
+struct MIX_ROUTINE
+{
+    string                                  name;
+    string                                  image;
+    std::set<std::pair<ADDRINT, ADDRINT> >  loops;              // [target, branch] of its backward branches
+    UINT64                                  mix[MIX_KINDS];     // executed
+    UINT64                                  loopMix[MIX_KINDS]; // executed inside a loop
+};
+
+map<std::pair<ADDRINT, UINT32>, MIX_BLOCK *> mixBlocks;   // by address and instructions
+vector<MIX_ROUTINE> mixRoutines;
+map<string, UINT32> mixRoutineIds;      // by image and routine name
 
 /* ===================================================================== */
 // Command line switches
@@ -29,6 +94,12 @@ KNOB<string> KnobOutputFile(KNOB_MODE_WRITEONCE,  "pintool",
 KNOB<BOOL>   KnobCount(KNOB_MODE_WRITEONCE,  "pintool",
     "count", "1", "count instructions, basic blocks and threads in the application");
 
+KNOB<BOOL>   KnobMix(KNOB_MODE_WRITEONCE,  "pintool",
+    "mix", "0", "report the instruction mix (x87, SSE, AVX, AVX-512, string, lock, divide) per image and routine");
+
+KNOB<UINT32> KnobMixTop(KNOB_MODE_WRITEONCE,  "pintool",
+    "mix_top", "20", "routines listed in each table of the -mix report");
+
 
 /* ===================================================================== */
 // Utilities
@@ -61,6 +132,7 @@ INT32 Usage()
 
 VOID docount1 (THREADID threadid)
 {
+  SELFPROF_CALL_SCOPE(profDirect);
   PIN_GetLock(&lock1, threadid+1);
 	directCTCount++;
   PIN_ReleaseLock(&lock1);
@@ -68,6 +140,7 @@ VOID docount1 (THREADID threadid)
 
 VOID docount2 (THREADID threadid)
 {
+  SELFPROF_CALL_SCOPE(profIndirect);
   PIN_GetLock(&lock2, threadid+1);
 	indirectCTCount++;
   PIN_ReleaseLock(&lock2);
@@ -75,11 +148,30 @@ VOID docount2 (THREADID threadid)
 
 VOID docount3 (THREADID threadid)
 {
+  SELFPROF_CALL_SCOPE(profOther);
   PIN_GetLock(&lock3, threadid+1);
 	otherCTCount++;
   PIN_ReleaseLock(&lock3);
 }
 
+/*!
+ * -mix: count one run of a basic block; its instructions are added up at Fini.
+ * @param[in]   runs    counter of the block
+ */
+VOID MixBbl(UINT64 * runs)
+{
+    __sync_fetch_and_add(runs, 1);
+}
+
+/*!
+ * MixBbl() under -selfprof. The plain one stays inlinable.
+ */
+VOID MixBblProf(UINT64 * runs)
+{
+    SELFPROF_CALL_SCOPE(profMix);
+    MixBbl(runs);
+}
+
 /* ===================================================================== */
 // Instrumentation callbacks
 /* ===================================================================== */
@@ -95,6 +187,10 @@ VOID docount3 (THREADID threadid)
 
 VOID Instruction(INS ins, void *v)
 {
+    SELFPROF_INSTRUMENT_SCOPE(profIns);
+
+    // Code outside -include_img, -exclude_img and -rtn runs without counting.
+    if (!ScopeIns(ins)) { return; }
 
     if (INS_IsDirectControlFlow(ins))
     {
@@ -116,6 +212,340 @@ VOID Instruction(INS ins, void *v)
     }
 
 }
+/*!
+ * -mix: classify an instruction.
+ * @return the MIX kinds it belongs to, one bit each, besides MIX_INS
+ */
+UINT32 MixClassify(INS ins)
+{
+    UINT32 bits = 0;
+    BOOL scalar = xed_decoded_inst_get_attribute(INS_XedDec(ins), XED_ATTRIBUTE_SIMD_SCALAR) != 0;
+
+    switch (INS_Extension(ins))
+    {
+      case XED_EXTENSION_X87:
+        bits |= 1 << MIX_X87;
+        break;
+      case XED_EXTENSION_SSE:
+      case XED_EXTENSION_SSE2:
+      case XED_EXTENSION_SSE3:
+      case XED_EXTENSION_SSSE3:
+      case XED_EXTENSION_SSE4:
+      case XED_EXTENSION_SSE4A:
+        bits |= 1 << (scalar ? MIX_SSE_SCALAR : MIX_SSE_PACKED);
+        break;
+      case XED_EXTENSION_AVX:
+      case XED_EXTENSION_AVX2:
+      case XED_EXTENSION_AVX2GATHER:
+      case XED_EXTENSION_FMA:
+      case XED_EXTENSION_F16C:
+        bits |= 1 << (scalar ? MIX_AVX_SCALAR : MIX_AVX_PACKED);
+        break;
+      case XED_EXTENSION_AVX512EVEX:
+      case XED_EXTENSION_AVX512VEX:
+        bits |= 1 << (scalar ? MIX_AVX512_SCALAR : MIX_AVX512_PACKED);
+        break;
+      default:
+        break;
+    }
+
+    if (INS_Category(ins) == XED_CATEGORY_STRINGOP) { bits |= 1 << MIX_STRING; }
+
+    // XCHG with memory is locked without the prefix.
+    if (INS_LockPrefix(ins) || (INS_Opcode(ins) == XED_ICLASS_XCHG && INS_IsMemoryRead(ins)))
+    {
+        bits |= 1 << MIX_LOCK;
+    }
+
+    switch (INS_Opcode(ins))
+    {
+      case XED_ICLASS_DIV:    case XED_ICLASS_IDIV:
+      case XED_ICLASS_DIVSS:  case XED_ICLASS_DIVSD:  case XED_ICLASS_DIVPS:  case XED_ICLASS_DIVPD:
+      case XED_ICLASS_VDIVSS: case XED_ICLASS_VDIVSD: case XED_ICLASS_VDIVPS: case XED_ICLASS_VDIVPD:
+      case XED_ICLASS_FDIV:   case XED_ICLASS_FDIVP:  case XED_ICLASS_FDIVR:  case XED_ICLASS_FDIVRP:
+      case XED_ICLASS_FIDIV:  case XED_ICLASS_FIDIVR:
+        bits |= 1 << MIX_DIV;
+        break;
+      default:
+        break;
+    }
+
+    if (INS_IsDirectControlFlow(ins))           { bits |= 1 << MIX_DIRECT; }
+    else if (INS_IsIndirectControlFlow(ins))    { bits |= 1 << MIX_INDIRECT; }
+    return bits;
+}
+
+/*!
+ * -mix: the entry of the routine holding an address, created on first use.
+ */
+UINT32 MixRoutine(ADDRINT addr)
+{
+    RTN rtn = RTN_FindByAddress(addr);
+    IMG img = IMG_FindByAddress(addr);
+    string image = IMG_Valid(img) ? IMG_Name(img) : "<no image>";
+    string name = RTN_Valid(rtn) ? RTN_Name(rtn) : "<no symbol>";
+
+    image = image.substr(image.rfind('/') + 1);
+    map<string, UINT32>::iterator it = mixRoutineIds.find(image + ":" + name);
+    if (it != mixRoutineIds.end()) { return it->second; }
+
+    MIX_ROUTINE routine;
+    routine.name = name;
+    routine.image = image;
+    std::fill(routine.mix, routine.mix + MIX_KINDS, 0);
+    std::fill(routine.loopMix, routine.loopMix + MIX_KINDS, 0);
+    mixRoutines.push_back(routine);
+    mixRoutineIds[image + ":" + name] = mixRoutines.size() - 1;
+    return mixRoutines.size() - 1;
+}
+
+/*!
+ * -mix: classify the instructions of every basic block of the trace once,
+ * remember the backward branches as loops, and count the runs of the block.
+ */
+VOID MixTrace(TRACE trace, VOID *v)
+{
+    SELFPROF_INSTRUMENT_SCOPE(profIns);
+
+    if (!ScopeTrace(trace)) { return; }
+
+    BOOL prof = SelfProfOn();
+    for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl))
+    {
+        MIX_BLOCK *& block = mixBlocks[std::make_pair(BBL_Address(bbl), BBL_NumIns(bbl))];
+        if (block == 0)
+        {
+            block = new MIX_BLOCK();
+            block->runs = 0;
+            block->address = BBL_Address(bbl);
+            block->routine = MixRoutine(block->address);
+
+            for (INS ins = BBL_InsHead(bbl); INS_Valid(ins); ins = INS_Next(ins))
+            {
+                UINT32 bits = MixClassify(ins);
+                block->mix[MIX_INS]++;
+                for (UINT32 k = 1; k < MIX_KINDS; k++) { block->mix[k] += (bits >> k) & 1; }
+
+                if (INS_IsBranch(ins) && INS_IsDirectControlFlow(ins) &&
+                    INS_DirectControlFlowTargetAddress(ins) <= INS_Address(ins))
+                {
+                    ADDRINT target = INS_DirectControlFlowTargetAddress(ins);
+                    if (MixRoutine(target) == block->routine)
+                    {
+                        mixRoutines[block->routine].loops.insert(std::make_pair(target, INS_Address(ins)));
+                    }
+                }
+            }
+        }
+
+        BBL_InsertCall(bbl, IPOINT_BEFORE, prof ? (AFUNPTR)MixBblProf : (AFUNPTR)MixBbl,
+                       IARG_PTR, &block->runs, IARG_END);
+    }
+}
+
+/*!
+ * -mix: add the instructions a block executed into its routine.
+ */
+VOID MixRetire(const MIX_BLOCK * block)
+{
+    MIX_ROUTINE & routine = mixRoutines[block->routine];
+
+    // A block lies in a loop if a backward branch of its routine jumps over it.
+    BOOL inLoop = FALSE;
+    for (std::set<std::pair<ADDRINT, ADDRINT> >::iterator l = routine.loops.begin(); l != routine.loops.end(); ++l)
+    {
+        if (l->first <= block->address && block->address <= l->second) { inLoop = TRUE; break; }
+    }
+
+    for (UINT32 k = 0; k < MIX_KINDS; k++)
+    {
+        UINT64 executed = block->runs * block->mix[k];
+        routine.mix[k] += executed;
+        if (inLoop) { routine.loopMix[k] += executed; }
+    }
+}
+
+/*!
+ * -mix: retire the blocks and the loops of an image that is unloaded, so
+ * that an image loaded at its addresses later starts afresh.
+ * @param[in]   img     the image
+ * @param[in]   v       value specified by the tool in the IMG_AddUnloadFunction
+ *                      function call
+ */
+VOID MixUnload(IMG img, VOID *v)
+{
+    ADDRINT low = IMG_LowAddress(img), high = IMG_HighAddress(img);
+
+    map<std::pair<ADDRINT, UINT32>, MIX_BLOCK *>::iterator it = mixBlocks.lower_bound(std::make_pair(low, 0));
+    while (it != mixBlocks.end() && it->first.first <= high)
+    {
+        MixRetire(it->second);
+        delete it->second;
+        mixBlocks.erase(it++);
+    }
+
+    for (size_t i = 0; i < mixRoutines.size(); i++)
+    {
+        std::set<std::pair<ADDRINT, ADDRINT> > & loops = mixRoutines[i].loops;
+        std::set<std::pair<ADDRINT, ADDRINT> >::iterator l = loops.lower_bound(std::make_pair(low, (ADDRINT)0));
+        while (l != loops.end() && l->first <= high) { loops.erase(l++); }
+    }
+}
+
+/*!
+ * @return "part" as a percentage of "whole", 0 for an empty whole
+ */
+static double Percent(UINT64 part, UINT64 whole)
+{
+    return whole == 0 ? 0.0 : 100.0 * part / whole;
+}
+
+/*!
+ * -mix: one row of a table: a name, the instructions executed and the
+ * share of each kind among them.
+ */
+static VOID MixRow(const string & name, const UINT64 * mix)
+{
+    char line[64];
+
+    snprintf(line, sizeof(line), "  %-40s %14llu", name.substr(0, 40).c_str(), (unsigned long long)mix[MIX_INS]);
+    *out << line;
+    for (UINT32 k = MIX_X87; k <= MIX_DIV; k++)
+    {
+        snprintf(line, sizeof(line), " %8.2f", Percent(mix[k], mix[MIX_INS]));
+        *out << line;
+    }
+    *out << endl;
+}
+
+/*!
+ * -mix: the header of a table made of MixRow() rows.
+ */
+static VOID MixHeader(const char * title)
+{
+    char line[64];
+
+    *out << title << endl;
+    snprintf(line, sizeof(line), "  %-40s %14s", "", "instructions");
+    *out << line;
+    for (UINT32 k = MIX_X87; k <= MIX_DIV; k++)
+    {
+        snprintf(line, sizeof(line), " %7s%%", MixNames[k]);
+        *out << line;
+    }
+    *out << endl;
+}
+
+static bool MoreInstructions(const MIX_ROUTINE * a, const MIX_ROUTINE * b)
+{
+    return a->mix[MIX_INS] > b->mix[MIX_INS];
+}
+
+static bool MoreScalarInLoops(const MIX_ROUTINE * a, const MIX_ROUTINE * b)
+{
+    return a->loopMix[MIX_X87] + a->loopMix[MIX_SSE_SCALAR] + a->loopMix[MIX_AVX_SCALAR] + a->loopMix[MIX_AVX512_SCALAR]
+           > b->loopMix[MIX_X87] + b->loopMix[MIX_SSE_SCALAR] + b->loopMix[MIX_AVX_SCALAR] + b->loopMix[MIX_AVX512_SCALAR];
+}
+
+static bool MoreLocked(const MIX_ROUTINE * a, const MIX_ROUTINE * b)
+{
+    return a->mix[MIX_LOCK] > b->mix[MIX_LOCK];
+}
+
+/*!
+ * -mix: add up the blocks into their routines and images, and print the
+ * mix of the program, of every image and of the hottest routines, the
+ * routines whose loops run scalar floating point (SIMD code the compiler
+ * did not vectorize, or x87), and the routines with the most locked
+ * instructions.
+ */
+VOID MixReport()
+{
+    UINT64 total[MIX_KINDS] = { 0 };
+    map<string, vector<UINT64> > images;
+
+    // The blocks of the images still loaded.
+    for (map<std::pair<ADDRINT, UINT32>, MIX_BLOCK *>::iterator it = mixBlocks.begin(); it != mixBlocks.end(); ++it)
+    {
+        MixRetire(it->second);
+    }
+
+    for (size_t i = 0; i < mixRoutines.size(); i++)
+    {
+        if (mixRoutines[i].mix[MIX_INS] == 0) { continue; }
+
+        vector<UINT64> & image = images[mixRoutines[i].image];
+        image.resize(MIX_KINDS);
+        for (UINT32 k = 0; k < MIX_KINDS; k++)
+        {
+            image[k] += mixRoutines[i].mix[k];
+            total[k] += mixRoutines[i].mix[k];
+        }
+    }
+
+    // The control flow counts of the plain mode, from the same blocks.
+    directCTCount = total[MIX_DIRECT];
+    indirectCTCount = total[MIX_INDIRECT];
+    otherCTCount = total[MIX_INS] - total[MIX_DIRECT] - total[MIX_INDIRECT];
+
+    *out << "===============================================" << endl;
+    MixHeader("Instruction mix:");
+    MixRow("all", total);
+
+    *out << endl;
+    MixHeader("Instruction mix by image:");
+    for (map<string, vector<UINT64> >::iterator it = images.begin(); it != images.end(); ++it)
+    {
+        MixRow(it->first, &it->second[0]);
+    }
+
+    vector<MIX_ROUTINE *> routines;
+    for (size_t i = 0; i < mixRoutines.size(); i++) { routines.push_back(&mixRoutines[i]); }
+    size_t top = std::min((size_t)KnobMixTop.Value(), routines.size());
+    char line[160];
+
+    *out << endl;
+    MixHeader("Instruction mix of the routines that execute the most instructions:");
+    std::sort(routines.begin(), routines.end(), MoreInstructions);
+    for (size_t i = 0; i < top && routines[i]->mix[MIX_INS] != 0; i++)
+    {
+        MixRow(routines[i]->image + ":" + routines[i]->name, routines[i]->mix);
+    }
+
+    *out << endl << "Scalar floating point in loops (not vectorized, or x87):" << endl;
+    snprintf(line, sizeof(line), "  %-40s %14s %14s %14s %8s\n", "", "in loops", "scalar+x87", "packed", "scalar%");
+    *out << line;
+    std::sort(routines.begin(), routines.end(), MoreScalarInLoops);
+    for (size_t i = 0; i < top; i++)
+    {
+        const UINT64 * mix = routines[i]->loopMix;
+        UINT64 scalar = mix[MIX_X87] + mix[MIX_SSE_SCALAR] + mix[MIX_AVX_SCALAR] + mix[MIX_AVX512_SCALAR];
+        UINT64 packed = mix[MIX_SSE_PACKED] + mix[MIX_AVX_PACKED] + mix[MIX_AVX512_PACKED];
+        if (scalar == 0) { break; }
+
+        string name = routines[i]->image + ":" + routines[i]->name;
+        snprintf(line, sizeof(line), "  %-40s %14llu %14llu %14llu %8.2f\n", name.substr(0, 40).c_str(),
+                 (unsigned long long)mix[MIX_INS], (unsigned long long)scalar, (unsigned long long)packed,
+                 Percent(scalar, scalar + packed));
+        *out << line;
+    }
+
+    *out << endl << "Locked instructions:" << endl;
+    snprintf(line, sizeof(line), "  %-40s %14s %14s %10s\n", "", "locked", "per 1000 ins", "of all%");
+    *out << line;
+    std::sort(routines.begin(), routines.end(), MoreLocked);
+    for (size_t i = 0; i < top && routines[i]->mix[MIX_LOCK] != 0; i++)
+    {
+        const UINT64 * mix = routines[i]->mix;
+        string name = routines[i]->image + ":" + routines[i]->name;
+        snprintf(line, sizeof(line), "  %-40s %14llu %14.2f %10.2f\n", name.substr(0, 40).c_str(),
+                 (unsigned long long)mix[MIX_LOCK], 1000.0 * mix[MIX_LOCK] / mix[MIX_INS],
+                 Percent(mix[MIX_LOCK], total[MIX_LOCK]));
+        *out << line;
+    }
+    *out << "===============================================" << endl;
+}
+
 /*!
  * Print out analysis results.
  * This function is called when the application exits.
@@ -125,9 +555,14 @@ VOID Instruction(INS ins, void *v)
  */
 VOID Fini(INT32 code, VOID *v)
 {
+    if (KnobMix) { MixReport(); }
+
     *out <<  "Number of direct control flow transfer instructions: " << directCTCount << endl;
 		*out <<  "Number of indirect control flow transfer instructions: " << indirectCTCount << endl;
 		*out <<  "Number of other control flow transfer instructions: " << otherCTCount << endl;
+    *out << ScopeReport();
+    *out << SelfProfReport();
+    out->flush();
 }
 /*!
  * The main procedure of the tool.
@@ -138,6 +573,9 @@ VOID Fini(INT32 code, VOID *v)
  */
 int main(int argc, char *argv[])
 {
+    // Routine names for -rtn.
+    PIN_InitSymbols();
+
     // Initialize PIN library. Print help message if -h(elp) is specified
     // in the command line or the command line is invalid 
     if( PIN_Init(argc,argv) )
@@ -149,13 +587,36 @@ int main(int argc, char *argv[])
 
     if (!fileName.empty()) { out = new std::ofstream(fileName.c_str());}
 
+    ScopeInit();
+    SelfProfInit();
+    profDirect = SelfProfKind("docount1 (direct)");
+    profIndirect = SelfProfKind("docount2 (indirect)");
+    profOther = SelfProfKind("docount3 (other)");
+    profMix = SelfProfKind("MixBbl");
+    profIns = SelfProfCallback("instructions");
+
     if (KnobCount)
     {
-        // Register Instruction to be called to instrument instructions
-        INS_AddInstrumentFunction(Instruction, 0);
+        if (KnobMix)
+        {
+            // One counter per basic block; the kinds of its instructions are known statically.
+            TRACE_AddInstrumentFunction(MixTrace, 0);
+            IMG_AddUnloadFunction(MixUnload, 0);
+        }
+        else
+        {
+            // Register Instruction to be called to instrument instructions
+            INS_AddInstrumentFunction(Instruction, 0);
+        }
 
         // Register function to be called when the application exits
         PIN_AddFiniFunction(Fini, 0);
+
+        if (!AttachInit(Fini))
+        {
+            cerr << "Cannot start the detach timer thread." << endl;
+            return 1;
+        }
     }
     
     /*
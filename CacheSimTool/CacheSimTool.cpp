@@ -0,0 +1,751 @@
+/*! @file
+ *  Simulate a data cache hierarchy (L1D, L2 and a last level cache) on the
+ *  loads and stores of an application, and report the misses of every
+ *  level in all, per routine and per instruction, as miss rates and as
+ *  misses per thousand instructions (MPKI). Data layout changes can so be
+ *  compared without hardware counters.
+ *
+ *  Every level is set associative with LRU replacement, write-allocate,
+ *  and neither inclusive nor exclusive: a miss goes on to the next level
+ *  and fills every level it missed. Write backs are not modelled. The
+ *  geometry of every level is a knob, "<size>:<ways>:<line bytes>".
+ *
+ *  The tags of a cache are packed in one array, the ways of a set side by
+ *  side in LRU order, so that a lookup scans one or two host cache lines.
+ *  Every thread has its own L1D and L2, as every core does, found through
+ *  a tool register, so they take no lock. The LLC is shared by default;
+ *  its sets are split into stripes with a lock each, so threads only wait
+ *  for one another when they touch the same stripe. "-llc_private" gives
+ *  every thread its own LLC instead. The counters of the routines and
+ *  instructions are kept per thread as well, in pages allocated when the
+ *  thread first touches one, so a thread only pays for the code it runs,
+ *  and are added to the totals when the thread exits.
+ */
+
+#include "pin.H"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ScopeFilter.h"
+#include "SelfProf.h"
+#include "Attach.h"
+
+using std::cerr;
+using std::string;
+using std::endl;
+using std::vector;
+using std::map;
+/* ================================================================== */
+// Global variables
+/* ================================================================== */
+
+enum LEVEL { LEVEL_L1, LEVEL_L2, LEVEL_LLC, LEVELS };
+
+static const char * LevelNames[LEVELS] = { "L1D", "L2", "LLC" };
+
+#define LLC_STRIPES     64      // locks of the shared LLC, each over every 64th set
+#define COUNTER_PAGE    256     // counters allocated together in a COUNTER_TABLE
+
+/*!
+ * A set associative cache with LRU replacement. The ways of a set hold the
+ * numbers of the lines they cache, most recently used first; an empty way
+ * holds ~0, which no line number reaches.
+ */
+class CACHE
+{
+  public:
+    CACHE(UINT32 sets, UINT32 ways) : _ways(ways), _setMask(sets - 1), _tags((size_t)sets * ways, ~(ADDRINT)0) {}
+
+    /*!
+     * @return the set a line maps to
+     */
+    UINT32 Set(ADDRINT line) const { return line & _setMask; }
+
+    /*!
+     * Look a line up and make it the most recently used of its set,
+     * filling it in place of the least recently used one on a miss.
+     * @return TRUE on a hit
+     */
+    BOOL Access(ADDRINT line)
+    {
+        ADDRINT * set = &_tags[(size_t)Set(line) * _ways];
+        UINT32 way = 0;
+        while (way < _ways && set[way] != line) { way++; }
+
+        BOOL hit = way < _ways;
+        if (!hit) { way = _ways - 1; }
+        memmove(set + 1, set, way * sizeof(ADDRINT));
+        set[0] = line;
+        return hit;
+    }
+
+  private:
+    UINT32          _ways;
+    UINT32          _setMask;
+    vector<ADDRINT> _tags;      // sets * ways line numbers
+};
+
+/*!
+ * Counters of a thread by number, allocated a page of COUNTER_PAGE at a
+ * time when one of them is first touched. The numbers are handed out in
+ * the order code is instrumented, so the code a thread runs falls into few
+ * pages, and the pages of code it never runs are never allocated.
+ */
+template <class T>
+class COUNTER_TABLE
+{
+  public:
+    ~COUNTER_TABLE()
+    {
+        for (size_t p = 0; p < _pages.size(); p++) { delete [] _pages[p]; }
+    }
+
+    /*!
+     * @return the counter of a number, allocating its page when it is new
+     */
+    T & operator[](UINT32 index)
+    {
+        size_t p = index / COUNTER_PAGE;
+        if (p >= _pages.size()) { _pages.resize(std::max(p + 1, 2 * _pages.size()), 0); }
+        if (_pages[p] == 0) { _pages[p] = new T[COUNTER_PAGE](); }
+        return _pages[p][index % COUNTER_PAGE];
+    }
+
+    size_t Pages() const { return _pages.size(); }
+
+    /*!
+     * @return the counters of numbers p * COUNTER_PAGE and up, NULL if never touched
+     */
+    const T * Page(size_t p) const { return _pages[p]; }
+
+  private:
+    vector<T *> _pages;
+};
+
+// Geometry of a level, from its knob.
+struct GEOMETRY
+{
+    UINT64  size;
+    UINT32  ways;
+    UINT32  lineShift;      // log2 of the line size
+    UINT32  sets;
+};
+
+static GEOMETRY geometry[LEVELS];
+
+// What one instruction or routine did at every level.
+struct COUNTS
+{
+    UINT64  accesses[LEVELS];   // lookups; those of L2 and LLC are misses of the level above
+    UINT64  misses[LEVELS];
+};
+
+// A memory instruction, numbered when it is instrumented.
+struct INS_INFO
+{
+    ADDRINT ip;
+    UINT32  rtn;
+};
+
+// A routine, numbered when one of its blocks is instrumented.
+struct ROUTINE
+{
+    string  name;       // without parameters, unless overloads clash (NameOverloads)
+    string  complete;   // with parameters
+    string  image;
+};
+
+static vector<INS_INFO> instructions;
+static map<ADDRINT, UINT32> instructionIds; // by address
+static vector<ROUTINE> routines;
+static map<string, UINT32> routineIds;      // by image and mangled routine name
+
+// Everything the tool keeps about one thread. Only the thread itself
+// writes to it; its counters are added to the totals when it exits, or at
+// Fini for the threads still running.
+struct THREAD_DATA
+{
+    THREADID                threadid;       // Pin id of the thread
+    CACHE *                 cache[LEVELS];  // the LLC is shared unless -llc_private
+    COUNTER_TABLE<COUNTS>   ins;            // by instruction number
+    COUNTER_TABLE<COUNTS>   rtn;            // by routine number
+    COUNTER_TABLE<UINT64>   rtnIns;         // instructions executed, by routine number
+};
+
+// Tool register that holds the THREAD_DATA of the running thread.
+static REG RegThreadData;
+
+// Data of the threads still running, in the order they started.
+static vector<THREAD_DATA *> threads;
+static UINT32 numThreads;       // threads the application had
+static PIN_LOCK lock;
+
+// Counters of the threads that exited, by instruction and routine number.
+static vector<COUNTS> insTotals, rtnTotals;
+static vector<UINT64> rtnInsTotals;
+
+static CACHE * sharedLlc = 0;
+static PIN_LOCK llcLocks[LLC_STRIPES];
+
+// Kinds of the -selfprof report.
+static UINT32 profAccess, profCount, profTrace;
+
+FILE * out = stderr;
+
+/* ===================================================================== */
+// Command line switches
+/* ===================================================================== */
+KNOB<string> KnobOutputFile(KNOB_MODE_WRITEONCE,  "pintool",
+    "o", "", "specify file name for CacheSimTool output");
+
+KNOB<string> KnobL1(KNOB_MODE_WRITEONCE,  "pintool",
+    "l1", "32K:8:64", "L1 data cache of every thread, <size>:<ways>:<line bytes>");
+
+KNOB<string> KnobL2(KNOB_MODE_WRITEONCE,  "pintool",
+    "l2", "1M:16:64", "L2 cache of every thread, <size>:<ways>:<line bytes>");
+
+KNOB<string> KnobLlc(KNOB_MODE_WRITEONCE,  "pintool",
+    "llc", "8M:16:64", "last level cache, <size>:<ways>:<line bytes>");
+
+KNOB<BOOL>   KnobLlcPrivate(KNOB_MODE_WRITEONCE,  "pintool",
+    "llc_private", "0", "give every thread its own LLC instead of sharing one");
+
+KNOB<UINT32> KnobTop(KNOB_MODE_WRITEONCE,  "pintool",
+    "top", "20", "routines and instructions listed, those with the most misses, 0 for all");
+
+/* ===================================================================== */
+// Utilities
+/* ===================================================================== */
+
+/*!
+ *  Print out help message.
+ */
+INT32 Usage()
+{
+    cerr << "This tool simulates an L1D, L2 and LLC cache hierarchy on the loads and" << endl <<
+            "stores of the application and reports their misses by routine and instruction." << endl << endl;
+
+    cerr << KNOB_BASE::StringKnobSummary() << endl;
+
+    return -1;
+}
+
+/*!
+ * Read the geometry of a level from "<size>[K|M]:<ways>:<line bytes>".
+ * @return FALSE unless the sets and the line size are powers of 2
+ */
+static BOOL ParseGeometry(const string & spec, GEOMETRY & g)
+{
+    char * end;
+    g.size = strtoull(spec.c_str(), &end, 10);
+    if (*end == 'K' || *end == 'k')      { g.size <<= 10; end++; }
+    else if (*end == 'M' || *end == 'm') { g.size <<= 20; end++; }
+
+    unsigned ways, line;
+    if (sscanf(end, ":%u:%u", &ways, &line) != 2 || ways == 0 || line == 0) { return FALSE; }
+    if ((line & (line - 1)) != 0 || g.size % ((UINT64)ways * line) != 0) { return FALSE; }
+
+    g.ways = ways;
+    g.sets = g.size / ((UINT64)ways * line);
+    if (g.sets == 0 || (g.sets & (g.sets - 1)) != 0) { return FALSE; }
+    for (g.lineShift = 0; (1u << g.lineShift) != line; g.lineShift++) {}
+    return TRUE;
+}
+
+/*!
+ * @return the number of a routine, which is added on first use. Routines
+ *         are told apart by their mangled names, so overloads stay apart.
+ */
+static UINT32 RoutineId(ADDRINT addr)
+{
+    RTN rtn = RTN_FindByAddress(addr);
+    IMG img = IMG_FindByAddress(addr);
+    string image = IMG_Valid(img) ? IMG_Name(img) : "<no image>";
+    string mangled = RTN_Valid(rtn) ? RTN_Name(rtn) : "<no symbol>";
+
+    image = image.substr(image.rfind('/') + 1);
+    map<string, UINT32>::iterator it = routineIds.find(image + ":" + mangled);
+    if (it != routineIds.end()) { return it->second; }
+
+    ROUTINE routine = { mangled, mangled, image };
+    if (RTN_Valid(rtn))
+    {
+        routine.name = PIN_UndecorateSymbolName(mangled, UNDECORATION_NAME_ONLY);
+        routine.complete = PIN_UndecorateSymbolName(mangled, UNDECORATION_COMPLETE);
+    }
+    routines.push_back(routine);
+    routineIds[image + ":" + mangled] = routines.size() - 1;
+    return routines.size() - 1;
+}
+
+/*!
+ * Name the routines whose short names clash, overloads and template
+ * instances of one image, by their complete names instead.
+ */
+static VOID NameOverloads()
+{
+    map<string, UINT32> uses;
+    for (size_t i = 0; i < routines.size(); i++) { uses[routines[i].image + ":" + routines[i].name]++; }
+    for (size_t i = 0; i < routines.size(); i++)
+    {
+        if (uses[routines[i].image + ":" + routines[i].name] > 1) { routines[i].name = routines[i].complete; }
+    }
+}
+
+/* ===================================================================== */
+// Analysis routines
+/* ===================================================================== */
+
+/*!
+ * Run one line through the hierarchy and count where it missed.
+ */
+static inline VOID AccessLine(THREAD_DATA * td, ADDRINT addr, COUNTS & ins, COUNTS & rtn)
+{
+    for (UINT32 level = LEVEL_L1; level < LEVELS; level++)
+    {
+        ADDRINT line = addr >> geometry[level].lineShift;
+        CACHE * cache = td->cache[level];
+        BOOL hit;
+
+        ins.accesses[level]++;
+        rtn.accesses[level]++;
+        if (cache == sharedLlc)
+        {
+            PIN_LOCK * stripe = &llcLocks[cache->Set(line) % LLC_STRIPES];
+            PIN_GetLock(stripe, td->threadid+1);
+            hit = cache->Access(line);
+            PIN_ReleaseLock(stripe);
+        }
+        else
+        {
+            hit = cache->Access(line);
+        }
+        if (hit) { return; }
+
+        ins.misses[level]++;
+        rtn.misses[level]++;
+    }
+}
+
+/*!
+ * Simulate a load or a store, on every line it touches.
+ * @param[in]   td      data of the thread
+ * @param[in]   ins     number of the instruction
+ * @param[in]   rtn     number of its routine
+ * @param[in]   addr    first byte referenced
+ * @param[in]   size    bytes referenced
+ */
+VOID Access(THREAD_DATA * td, UINT32 ins, UINT32 rtn, ADDRINT addr, UINT32 size)
+{
+    SELFPROF_CALL_SCOPE(profAccess);
+
+    // The global tables grow under the instrumentation of other threads;
+    // only the tables of the thread are touched here.
+    COUNTS & insCounts = td->ins[ins];
+    COUNTS & rtnCounts = td->rtn[rtn];
+
+    // An access that straddles lines of L1 looks every one of them up.
+    UINT32 shift = geometry[LEVEL_L1].lineShift;
+    ADDRINT last = (addr + (size ? size - 1 : 0)) >> shift;
+    for (ADDRINT line = addr >> shift; line <= last; line++)
+    {
+        AccessLine(td, line << shift, insCounts, rtnCounts);
+    }
+}
+
+/*!
+ * Count the instructions of a basic block for its routine.
+ * @param[in]   td      data of the thread
+ * @param[in]   rtn     number of the routine
+ * @param[in]   count   instructions in the block
+ */
+VOID CountIns(THREAD_DATA * td, UINT32 rtn, UINT32 count)
+{
+    SELFPROF_CALL_SCOPE(profCount);
+
+    td->rtnIns[rtn] += count;
+}
+
+/* ===================================================================== */
+// Instrumentation callbacks
+/* ===================================================================== */
+
+/*!
+ * Count the instructions of every basic block and simulate every memory
+ * operand of its instructions.
+ * @param[in]   trace    trace to be instrumented
+ * @param[in]   v        value specified by the tool in the TRACE_AddInstrumentFunction
+ *                       function call
+ */
+VOID Trace(TRACE trace, VOID *v)
+{
+    SELFPROF_INSTRUMENT_SCOPE(profTrace);
+
+    // Code outside -include_img, -exclude_img and -rtn runs without analysis calls.
+    if (!ScopeTrace(trace)) { return; }
+
+    for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl))
+    {
+        UINT32 rtn = RoutineId(BBL_Address(bbl));
+        BBL_InsertCall(bbl, IPOINT_BEFORE, (AFUNPTR)CountIns, IARG_REG_VALUE, RegThreadData,
+                       IARG_UINT32, rtn, IARG_UINT32, BBL_NumIns(bbl), IARG_END);
+
+        for (INS ins = BBL_InsHead(bbl); INS_Valid(ins); ins = INS_Next(ins))
+        {
+            // Gathers and scatters have no single address per operand.
+            if (INS_MemoryOperandCount(ins) == 0 || INS_HasScatteredMemoryAccess(ins)) { continue; }
+
+            // A trace may be instrumented again; its instructions keep their numbers.
+            map<ADDRINT, UINT32>::iterator it = instructionIds.find(INS_Address(ins));
+            UINT32 id;
+            if (it != instructionIds.end())
+            {
+                id = it->second;
+            }
+            else
+            {
+                INS_INFO info = { INS_Address(ins), rtn };
+                id = instructions.size();
+                instructions.push_back(info);
+                instructionIds[INS_Address(ins)] = id;
+            }
+
+            for (UINT32 op = 0; op < INS_MemoryOperandCount(ins); op++)
+            {
+                INS_InsertPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)Access, IARG_REG_VALUE, RegThreadData,
+                                         IARG_UINT32, id, IARG_UINT32, rtn, IARG_MEMORYOP_EA, op,
+                                         IARG_UINT32, (UINT32)INS_MemoryOperandSize(ins, op), IARG_END);
+            }
+        }
+    }
+}
+
+/*!
+ * Give a new thread its caches and point its tool register at its data.
+ * @param[in]   threadid    Pin id of the new thread
+ */
+VOID ThreadStart(THREADID threadid, CONTEXT *ctxt, INT32 flags, VOID *v)
+{
+    THREAD_DATA * td = new THREAD_DATA();
+
+    td->threadid = threadid;
+    td->cache[LEVEL_L1] = new CACHE(geometry[LEVEL_L1].sets, geometry[LEVEL_L1].ways);
+    td->cache[LEVEL_L2] = new CACHE(geometry[LEVEL_L2].sets, geometry[LEVEL_L2].ways);
+    td->cache[LEVEL_LLC] = KnobLlcPrivate ? new CACHE(geometry[LEVEL_LLC].sets, geometry[LEVEL_LLC].ways) : sharedLlc;
+    PIN_SetContextReg(ctxt, RegThreadData, reinterpret_cast<ADDRINT>(td));
+
+    PIN_GetLock(&lock, threadid+1);
+    threads.push_back(td);
+    numThreads++;
+    PIN_ReleaseLock(&lock);
+}
+
+static inline VOID AddCount(UINT64 & total, UINT64 count)
+{
+    total += count;
+}
+
+static inline VOID AddCount(COUNTS & total, const COUNTS & counts)
+{
+    for (UINT32 level = 0; level < LEVELS; level++)
+    {
+        total.accesses[level] += counts.accesses[level];
+        total.misses[level] += counts.misses[level];
+    }
+}
+
+/*!
+ * Add the counters of a thread to the totals. The caller holds the lock.
+ */
+template <class T>
+static VOID AddCounts(vector<T> & totals, const COUNTER_TABLE<T> & table)
+{
+    for (size_t p = 0; p < table.Pages(); p++)
+    {
+        const T * page = table.Page(p);
+        if (page == 0) { continue; }
+
+        size_t first = p * COUNTER_PAGE;
+        if (totals.size() < first + COUNTER_PAGE) { totals.resize(first + COUNTER_PAGE); }
+        for (size_t i = 0; i < COUNTER_PAGE; i++) { AddCount(totals[first + i], page[i]); }
+    }
+}
+
+/*!
+ * Add the counters of a thread to the totals and forget the thread.
+ * The caller holds the lock.
+ */
+static VOID RetireThread(THREAD_DATA * td)
+{
+    AddCounts(insTotals, td->ins);
+    AddCounts(rtnTotals, td->rtn);
+    AddCounts(rtnInsTotals, td->rtnIns);
+    threads.erase(std::find(threads.begin(), threads.end(), td));
+}
+
+/*!
+ * Add the counters of a thread that exits to the totals and free its data,
+ * so that the memory of the tool does not grow with every thread the
+ * application ever had.
+ * @param[in]   threadid    Pin id of the thread
+ */
+VOID ThreadFini(THREADID threadid, const CONTEXT *ctxt, INT32 code, VOID *v)
+{
+    THREAD_DATA * td = reinterpret_cast<THREAD_DATA *>(PIN_GetContextReg(ctxt, RegThreadData));
+
+    // Fini may have added the thread already, at a detach.
+    PIN_GetLock(&lock, threadid+1);
+    if (std::find(threads.begin(), threads.end(), td) != threads.end()) { RetireThread(td); }
+    PIN_ReleaseLock(&lock);
+
+    delete td->cache[LEVEL_L1];
+    delete td->cache[LEVEL_L2];
+    if (td->cache[LEVEL_LLC] != sharedLlc) { delete td->cache[LEVEL_LLC]; }
+    delete td;
+}
+
+/* ===================================================================== */
+// Report
+/* ===================================================================== */
+
+static bool MoreRoutineMisses(UINT32 a, UINT32 b)
+{
+    for (INT32 level = LEVELS - 1; level >= 0; level--)
+    {
+        if (rtnTotals[a].misses[level] != rtnTotals[b].misses[level])
+        {
+            return rtnTotals[a].misses[level] > rtnTotals[b].misses[level];
+        }
+    }
+    return false;
+}
+
+static bool MoreInsMisses(UINT32 a, UINT32 b)
+{
+    for (INT32 level = LEVELS - 1; level >= 0; level--)
+    {
+        if (insTotals[a].misses[level] != insTotals[b].misses[level])
+        {
+            return insTotals[a].misses[level] > insTotals[b].misses[level];
+        }
+    }
+    return false;
+}
+
+/*!
+ * Print the misses of every level of one row: misses, miss rate and MPKI.
+ */
+static VOID PrintMisses(const COUNTS & counts, UINT64 executed)
+{
+    for (UINT32 level = 0; level < LEVELS; level++)
+    {
+        fprintf(out, " %12llu %6.2f%% %8.3f", (unsigned long long)counts.misses[level],
+                counts.accesses[level] ? 100.0 * counts.misses[level] / counts.accesses[level] : 0.0,
+                executed ? 1000.0 * counts.misses[level] / executed : 0.0);
+    }
+}
+
+/*!
+ * Print the header of a table of PrintMisses() rows.
+ */
+static VOID PrintMissHeader(const char * first, const char * second)
+{
+    fprintf(out, "  %-40s %14s", first, second);
+    for (UINT32 level = 0; level < LEVELS; level++)
+    {
+        fprintf(out, " %12s %7s %8s", (string(LevelNames[level]) + " miss").c_str(), "rate", "MPKI");
+    }
+    fprintf(out, "\n");
+}
+
+/*!
+ * Print the misses of the whole program, of the routines and of the
+ * instructions that miss most, deepest level first.
+ * This function is called when the application exits.
+ * @param[in]   code            exit code of the application
+ * @param[in]   v               value specified by the tool in the
+ *                              PIN_AddFiniFunction function call
+ */
+VOID Fini(INT32 code, VOID *v)
+{
+    // Threads that are still running have not added their counters yet.
+    PIN_GetLock(&lock, PIN_ThreadId()+1);
+    while (!threads.empty()) { RetireThread(threads.back()); }
+    PIN_ReleaseLock(&lock);
+    NameOverloads();
+    insTotals.resize(instructions.size());
+    rtnTotals.resize(routines.size());
+    rtnInsTotals.resize(routines.size());
+
+    COUNTS total = COUNTS();
+    UINT64 executed = 0;
+    vector<UINT32> order;
+    for (UINT32 r = 0; r < routines.size(); r++)
+    {
+        for (UINT32 level = 0; level < LEVELS; level++)
+        {
+            total.accesses[level] += rtnTotals[r].accesses[level];
+            total.misses[level] += rtnTotals[r].misses[level];
+        }
+        executed += rtnInsTotals[r];
+        if (rtnTotals[r].accesses[LEVEL_L1] != 0) { order.push_back(r); }
+    }
+
+    fprintf(out, "===============================================\n");
+    for (UINT32 level = 0; level < LEVELS; level++)
+    {
+        const GEOMETRY & g = geometry[level];
+        fprintf(out, "%-4s %8llu KB, %2u ways, %3u byte lines, %6u sets%s\n", LevelNames[level],
+                (unsigned long long)(g.size >> 10), g.ways, 1u << g.lineShift, g.sets,
+                level == LEVEL_LLC ? (KnobLlcPrivate ? ", one per thread" : ", shared") :
+                                     ", one per thread");
+    }
+    fprintf(out, "Instructions executed: %llu, memory accesses: %llu, in %lu threads\n",
+            (unsigned long long)executed, (unsigned long long)total.accesses[LEVEL_L1],
+            (unsigned long)numThreads);
+    for (UINT32 level = 0; level < LEVELS; level++)
+    {
+        fprintf(out, "%-4s accesses: %14llu  misses: %14llu  miss rate: %6.2f%%  MPKI: %8.3f\n",
+                LevelNames[level], (unsigned long long)total.accesses[level],
+                (unsigned long long)total.misses[level],
+                total.accesses[level] ? 100.0 * total.misses[level] / total.accesses[level] : 0.0,
+                executed ? 1000.0 * total.misses[level] / executed : 0.0);
+    }
+
+    size_t top = KnobTop == 0 ? order.size() : std::min((size_t)KnobTop.Value(), order.size());
+    fprintf(out, "\nRoutines with the most misses (MPKI per instruction of the routine):\n");
+    PrintMissHeader("routine", "instructions");
+    std::sort(order.begin(), order.end(), MoreRoutineMisses);
+    for (size_t i = 0; i < top; i++)
+    {
+        UINT32 r = order[i];
+        string name = routines[r].image + ":" + routines[r].name;
+        fprintf(out, "  %-40s %14llu", name.substr(0, 40).c_str(), (unsigned long long)rtnInsTotals[r]);
+        PrintMisses(rtnTotals[r], rtnInsTotals[r]);
+        fprintf(out, "\n");
+    }
+
+    order.clear();
+    for (UINT32 i = 0; i < instructions.size(); i++)
+    {
+        if (insTotals[i].misses[LEVEL_L1] != 0) { order.push_back(i); }
+    }
+    top = KnobTop == 0 ? order.size() : std::min((size_t)KnobTop.Value(), order.size());
+    fprintf(out, "\nInstructions with the most misses (MPKI of all instructions):\n");
+    PrintMissHeader("instruction", "accesses");
+    std::sort(order.begin(), order.end(), MoreInsMisses);
+
+    // The source lines come from the symbols Pin holds.
+    PIN_LockClient();
+    for (size_t i = 0; i < top; i++)
+    {
+        const INS_INFO & info = instructions[order[i]];
+        INT32 column = 0, line = 0;
+        string file;
+        PIN_GetSourceLocation(info.ip, &column, &line, &file);
+
+        char where[256];
+        if (line > 0)
+        {
+            snprintf(where, sizeof(where), "%s:%d", file.substr(file.rfind('/') + 1).c_str(), line);
+        }
+        else
+        {
+            snprintf(where, sizeof(where), "0x%llx %s", (unsigned long long)info.ip,
+                     routines[info.rtn].name.c_str());
+        }
+        fprintf(out, "  %-40.40s %14llu", where, (unsigned long long)insTotals[order[i]].accesses[LEVEL_L1]);
+        PrintMisses(insTotals[order[i]], executed);
+        fprintf(out, "\n");
+    }
+    PIN_UnlockClient();
+
+    fputs(ScopeReport().c_str(), out);
+    fputs(SelfProfReport().c_str(), out);
+    fflush(out);
+}
+
+/*!
+ * The main procedure of the tool.
+ * This function is called when the application image is loaded but not yet started.
+ * @param[in]   argc            total number of elements in the argv array
+ * @param[in]   argv            array of command line arguments,
+ *                              including pin -t <toolname> -- ...
+ */
+int main(int argc, char *argv[])
+{
+    // Routines are found by their symbols, source lines by the debug information.
+    PIN_InitSymbols();
+
+    // Initialize PIN library. Print help message if -h(elp) is specified
+    // in the command line or the command line is invalid
+    if( PIN_Init(argc,argv) )
+    {
+        return Usage();
+    }
+
+    if (!ParseGeometry(KnobL1, geometry[LEVEL_L1]) || !ParseGeometry(KnobL2, geometry[LEVEL_L2]) ||
+        !ParseGeometry(KnobLlc, geometry[LEVEL_LLC]))
+    {
+        cerr << "cachesim: a cache is <size>[K|M]:<ways>:<line bytes>, with a power of 2 of sets and line bytes" << endl;
+        return Usage();
+    }
+
+    string fileName = KnobOutputFile.Value();
+
+    if (!fileName.empty())
+    {
+        out = fopen(fileName.c_str(), "w");
+        if (out == 0)
+        {
+            cerr << "cachesim: cannot open " << fileName << endl;
+            return 1;
+        }
+    }
+
+    // Every analysis routine finds the caches of its thread in this register.
+    RegThreadData = PIN_ClaimToolRegister();
+    if (!REG_valid(RegThreadData))
+    {
+        cerr << "Cannot allocate a scratch register." << endl;
+        return 1;
+    }
+
+    if (!KnobLlcPrivate)
+    {
+        sharedLlc = new CACHE(geometry[LEVEL_LLC].sets, geometry[LEVEL_LLC].ways);
+        for (UINT32 i = 0; i < LLC_STRIPES; i++) { PIN_InitLock(&llcLocks[i]); }
+    }
+
+    PIN_InitLock(&lock);
+    ScopeInit();
+    SelfProfInit();
+    profAccess = SelfProfKind("Access");
+    profCount = SelfProfKind("CountIns");
+    profTrace = SelfProfCallback("traces");
+    PIN_AddThreadStartFunction(ThreadStart, 0);
+    PIN_AddThreadFiniFunction(ThreadFini, 0);
+    TRACE_AddInstrumentFunction(Trace, 0);
+
+    // Register function to be called when the application exits
+    PIN_AddFiniFunction(Fini, 0);
+    if (!AttachInit(Fini))
+    {
+        cerr << "Cannot start the detach timer thread." << endl;
+        return 1;
+    }
+
+    // Start the program, never returns
+    PIN_StartProgram();
+
+    return 0;
+}
+
+/* ===================================================================== */
+/* eof */
+/* ===================================================================== */
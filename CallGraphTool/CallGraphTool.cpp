@@ -0,0 +1,571 @@
+/*! @file
+ *  Call graph profile of the instructions an application executes: the
+ *  instructions of every routine itself (exclusive) and of everything it
+ *  called (inclusive), the calls along every caller-callee edge, and the
+ *  instructions of every call path as folded stacks for flame graphs.
+ *
+ *  Every thread keeps a shadow stack of the calls it is in and a calling
+ *  context tree, one node per call path, that the instructions of every
+ *  basic block are charged to. Both are found through a tool register and
+ *  written only by their thread, so no analysis routine takes a lock. The
+ *  trees of all threads are added up when the application exits.
+ *
+ *  A frame of the shadow stack remembers where the return address of its
+ *  call lies on the stack. A return pops the frames at or below its stack
+ *  pointer, and a call or a basic block drops the frames below theirs, so
+ *  frames that longjmp or an exception unwound are popped by the next
+ *  block that runs. A jump to the entry of another routine (a tail call,
+ *  or a PLT stub jumping to its target) moves the frame to that routine.
+ */
+
+#include "pin.H"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <stdio.h>
+#include "ScopeFilter.h"
+#include "SelfProf.h"
+#include "Attach.h"
+
+using std::cerr;
+using std::string;
+using std::endl;
+using std::vector;
+using std::map;
+/* ================================================================== */
+// Global variables
+/* ================================================================== */
+
+// Routines of the application, by id. The first two stand for code that no
+// symbol covers and for the bottom of every thread.
+struct ROUTINE
+{
+    string  name;           // undecorated, without parameters unless that is ambiguous
+    string  complete;       // undecorated, with parameters and template arguments
+    string  image;          // file name of the image
+    UINT64  self;           // instructions executed in the routine itself
+    UINT64  inclusive;      // instructions executed in it and its callees
+    UINT64  calls;
+};
+
+#define RTN_UNKNOWN     0
+#define RTN_THREAD      1
+
+static vector<ROUTINE> routines;
+static map<string, UINT32> routineIds;      // by image and mangled name
+
+// A node of the calling context tree: one call path of a thread.
+struct NODE
+{
+    UINT32              rtn;
+    NODE *              parent;
+    UINT64              calls;      // times the path was entered
+    UINT64              ins;        // instructions executed in the routine on this path
+    map<UINT32, NODE *> children;   // by routine
+
+    // Filled in at Fini.
+    UINT64              total;      // ins of the node and of all its descendants
+    BOOL                outer;      // the routine is not also further up the path
+
+    NODE(UINT32 r, NODE * p) : rtn(r), parent(p), calls(0), ins(0), total(0), outer(FALSE) {}
+};
+
+// A frame of the shadow stack.
+struct FRAME
+{
+    ADDRINT sp;         // where the return address of the call lies
+    NODE *  caller;     // node the call was made from
+    NODE *  node;       // node of the routine called, 0 until its first block runs
+};
+
+// Everything the tool keeps about one thread. Only the thread itself
+// writes to it; Fini reads all of them once the threads are done.
+struct THREAD_DATA
+{
+    THREADID        threadid;   // Pin id of the thread
+    NODE *          root;       // bottom of the calling context tree
+    vector<FRAME>   stack;      // shadow stack, never empty
+};
+
+// Tool register that holds the THREAD_DATA of the running thread.
+static REG RegThreadData;
+
+// Data of every thread the application had, in the order they started.
+static vector<THREAD_DATA *> threads;
+static PIN_LOCK lock;
+
+// Kinds of the -selfprof report.
+static UINT32 profBlock, profCall, profReturn, profTrace;
+
+FILE * out = stderr;
+
+/* ===================================================================== */
+// Command line switches
+/* ===================================================================== */
+KNOB<string> KnobOutputFile(KNOB_MODE_WRITEONCE,  "pintool",
+    "o", "", "specify file name for CallGraphTool output");
+
+KNOB<string> KnobFolded(KNOB_MODE_WRITEONCE,  "pintool",
+    "folded", "", "also write the instructions of every call path to this file as folded stacks, for flamegraph.pl");
+
+KNOB<UINT32> KnobTop(KNOB_MODE_WRITEONCE,  "pintool",
+    "top", "50", "routines listed in the flat profile and the call graph, 0 for all");
+
+/* ===================================================================== */
+// Utilities
+/* ===================================================================== */
+
+/*!
+ *  Print out help message.
+ */
+INT32 Usage()
+{
+    cerr << "This tool profiles the instructions executed by every routine of the" << endl <<
+            "application, by itself and with its callees, along its call paths." << endl << endl;
+
+    cerr << KNOB_BASE::StringKnobSummary() << endl;
+
+    return -1;
+}
+
+/*!
+ * Overloads and template instances have a mangled name each, so routines
+ * are told apart by it; they are only named without their parameters in
+ * the report.
+ * @return the id of a routine, which is added on first use
+ * @param[in]   image   file name of its image
+ * @param[in]   mangled name of the routine in the symbol table
+ */
+static UINT32 RoutineId(const string & image, const string & mangled)
+{
+    map<string, UINT32>::iterator it = routineIds.find(image + ":" + mangled);
+    if (it != routineIds.end()) { return it->second; }
+
+    ROUTINE routine = { PIN_UndecorateSymbolName(mangled, UNDECORATION_NAME_ONLY),
+                        PIN_UndecorateSymbolName(mangled, UNDECORATION_COMPLETE), image, 0, 0, 0 };
+    routines.push_back(routine);
+    routineIds[image + ":" + mangled] = routines.size() - 1;
+    return routines.size() - 1;
+}
+
+/*!
+ * Name the routines whose short names clash, overloads and template
+ * instances of one image, by their complete names instead.
+ */
+static VOID NameOverloads()
+{
+    map<string, UINT32> uses;
+    for (size_t i = 0; i < routines.size(); i++) { uses[routines[i].image + ":" + routines[i].name]++; }
+    for (size_t i = 0; i < routines.size(); i++)
+    {
+        if (uses[routines[i].image + ":" + routines[i].name] > 1) { routines[i].name = routines[i].complete; }
+    }
+}
+
+/*!
+ * @return the child of a node for a routine, created on first use
+ */
+static inline NODE * Child(NODE * node, UINT32 rtn)
+{
+    NODE *& child = node->children[rtn];
+    if (child == 0) { child = new NODE(rtn, node); }
+    return child;
+}
+
+/* ===================================================================== */
+// Analysis routines
+/* ===================================================================== */
+
+/*!
+ * Charge a basic block to the routine at the top of the shadow stack.
+ * @param[in]   td      data of the thread
+ * @param[in]   sp      stack pointer at the start of the block
+ * @param[in]   rtn     routine the block belongs to
+ * @param[in]   entry   the block starts at the entry of its routine
+ * @param[in]   ins     instructions in the block
+ */
+VOID Block(THREAD_DATA * td, ADDRINT sp, UINT32 rtn, BOOL entry, UINT32 ins)
+{
+    SELFPROF_CALL_SCOPE(profBlock);
+
+    // Frames below the stack pointer were left by longjmp or an exception.
+    while (td->stack.back().sp < sp) { td->stack.pop_back(); }
+
+    // The first block of a call names the routine called; a jump to the
+    // entry of another routine replaces the routine of the frame.
+    FRAME & frame = td->stack.back();
+    if (frame.node == 0 || (entry && frame.node->rtn != rtn))
+    {
+        frame.node = Child(frame.caller, rtn);
+        frame.node->calls++;
+    }
+    frame.node->ins += ins;
+}
+
+/*!
+ * Push the frame of a call; the routine called is known at its first block.
+ * @param[in]   td      data of the thread
+ * @param[in]   sp      stack pointer before the call
+ */
+VOID Call(THREAD_DATA * td, ADDRINT sp)
+{
+    SELFPROF_CALL_SCOPE(profCall);
+
+    ADDRINT slot = sp - sizeof(ADDRINT);
+    while (td->stack.back().sp <= slot) { td->stack.pop_back(); }
+
+    FRAME frame = { slot, td->stack.back().node, 0 };
+    if (frame.caller == 0) { frame.caller = td->stack.back().caller; }
+    td->stack.push_back(frame);
+}
+
+/*!
+ * Pop the frame of the call a return goes back from, and any frame below it.
+ * @param[in]   td      data of the thread
+ * @param[in]   sp      stack pointer before the return, at the return address
+ */
+VOID Return(THREAD_DATA * td, ADDRINT sp)
+{
+    SELFPROF_CALL_SCOPE(profReturn);
+
+    while (td->stack.back().sp <= sp) { td->stack.pop_back(); }
+}
+
+/* ===================================================================== */
+// Instrumentation callbacks
+/* ===================================================================== */
+
+/*!
+ * Charge every basic block to its routine and follow the calls and returns.
+ * @param[in]   trace    trace to be instrumented
+ * @param[in]   v        value specified by the tool in the TRACE_AddInstrumentFunction
+ *                       function call
+ */
+VOID Trace(TRACE trace, VOID *v)
+{
+    SELFPROF_INSTRUMENT_SCOPE(profTrace);
+
+    // Code outside -include_img, -exclude_img and -rtn runs without analysis calls.
+    if (!ScopeTrace(trace)) { return; }
+
+    for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl))
+    {
+        RTN rtn = RTN_FindByAddress(BBL_Address(bbl));
+        UINT32 id = RTN_UNKNOWN;
+        BOOL entry = FALSE;
+        if (RTN_Valid(rtn))
+        {
+            string image = IMG_Name(SEC_Img(RTN_Sec(rtn)));
+            id = RoutineId(image.substr(image.rfind('/') + 1), RTN_Name(rtn));
+            entry = RTN_Address(rtn) == BBL_Address(bbl);
+        }
+
+        BBL_InsertCall(bbl, IPOINT_BEFORE, (AFUNPTR)Block,
+                       IARG_REG_VALUE, RegThreadData, IARG_REG_VALUE, REG_STACK_PTR,
+                       IARG_UINT32, id, IARG_BOOL, entry, IARG_UINT32, BBL_NumIns(bbl), IARG_END);
+
+        INS tail = BBL_InsTail(bbl);
+        if (INS_IsCall(tail))
+        {
+            INS_InsertCall(tail, IPOINT_BEFORE, (AFUNPTR)Call,
+                           IARG_REG_VALUE, RegThreadData, IARG_REG_VALUE, REG_STACK_PTR, IARG_END);
+        }
+        else if (INS_IsRet(tail))
+        {
+            INS_InsertCall(tail, IPOINT_BEFORE, (AFUNPTR)Return,
+                           IARG_REG_VALUE, RegThreadData, IARG_REG_VALUE, REG_STACK_PTR, IARG_END);
+        }
+    }
+}
+
+/*!
+ * Allocate the data of a new thread and point its tool register at it.
+ * @param[in]   threadid    Pin id of the new thread
+ */
+VOID ThreadStart(THREADID threadid, CONTEXT *ctxt, INT32 flags, VOID *v)
+{
+    THREAD_DATA * td = new THREAD_DATA();
+
+    td->threadid = threadid;
+    td->root = new NODE(RTN_THREAD, 0);
+
+    // The bottom frame is never popped; its routine is the one the thread starts in.
+    FRAME bottom = { ~(ADDRINT)0, td->root, td->root };
+    td->stack.reserve(256);
+    td->stack.push_back(bottom);
+    PIN_SetContextReg(ctxt, RegThreadData, reinterpret_cast<ADDRINT>(td));
+
+    PIN_GetLock(&lock, threadid+1);
+    threads.push_back(td);
+    PIN_ReleaseLock(&lock);
+}
+
+/* ===================================================================== */
+// Report
+/* ===================================================================== */
+
+// An edge of the call graph, added up over all the nodes it joins.
+struct EDGE
+{
+    UINT64  calls;
+    UINT64  inclusive;      // instructions of the callee and its callees, recursion counted once
+};
+
+static map<std::pair<UINT32, UINT32>, EDGE> edges;     // by caller and callee
+static map<string, UINT64> folded;                     // instructions by call path
+
+/*!
+ * Walk the tree of a thread depth first, without recursing on the stack of
+ * the tool, and add it to the routines, the edges and, under -folded, the
+ * folded stacks. A node counts for the inclusive cost of its routine only
+ * when the routine is not also further up the path, so recursion is
+ * counted once.
+ */
+static VOID AddTree(NODE * root)
+{
+    struct VISIT
+    {
+        NODE *                          node;
+        map<UINT32, NODE *>::iterator   next;
+        size_t                          length;     // of the stack before the node was added
+    };
+
+    BOOL folding = !KnobFolded.Value().empty();
+    string stack;           // routines of the path from its outermost one, without the thread
+    vector<UINT32> active(routines.size(), 0);
+    vector<VISIT> path;
+    VISIT start = { root, root->children.begin(), 0 };
+    path.push_back(start);
+    active[root->rtn]++;
+    root->outer = TRUE;
+
+    while (!path.empty())
+    {
+        VISIT & visit = path.back();
+        if (visit.next != visit.node->children.end())
+        {
+            NODE * child = visit.next->second;
+            ++visit.next;
+
+            child->outer = active[child->rtn] == 0;
+            active[child->rtn]++;
+
+            VISIT next = { child, child->children.begin(), stack.size() };
+            if (folding)
+            {
+                if (!stack.empty()) { stack += ';'; }
+                stack += routines[child->rtn].name;
+                if (child->ins != 0) { folded[stack] += child->ins; }
+            }
+            path.push_back(next);
+            continue;
+        }
+
+        // All the children of the node are done.
+        NODE * node = visit.node;
+        stack.resize(visit.length);
+        path.pop_back();
+        node->total += node->ins;
+        active[node->rtn]--;
+
+        ROUTINE & routine = routines[node->rtn];
+        routine.self += node->ins;
+        routine.calls += node->calls;
+        if (node->outer) { routine.inclusive += node->total; }
+
+        if (node->parent != 0)
+        {
+            node->parent->total += node->total;
+
+            EDGE & edge = edges[std::make_pair(node->parent->rtn, node->rtn)];
+            edge.calls += node->calls;
+            if (node->outer) { edge.inclusive += node->total; }
+        }
+    }
+}
+
+static bool MoreSelf(UINT32 a, UINT32 b)
+{
+    return routines[a].self > routines[b].self;
+}
+
+static bool MoreInclusive(UINT32 a, UINT32 b)
+{
+    return routines[a].inclusive > routines[b].inclusive;
+}
+
+/*!
+ * @return "part" as a percentage of "whole", 0 for an empty whole
+ */
+static double Percent(UINT64 part, UINT64 whole)
+{
+    return whole == 0 ? 0.0 : 100.0 * part / whole;
+}
+
+/*!
+ * @return the name of a routine with its image
+ */
+static string FullName(UINT32 rtn)
+{
+    if (routines[rtn].image.empty()) { return routines[rtn].name; }
+    return routines[rtn].name + " [" + routines[rtn].image + "]";
+}
+
+/*!
+ * Print the flat profile and the call graph, and write the folded stacks.
+ * This function is called when the application exits.
+ * @param[in]   code            exit code of the application
+ * @param[in]   v               value specified by the tool in the
+ *                              PIN_AddFiniFunction function call
+ */
+VOID Fini(INT32 code, VOID *v)
+{
+    NameOverloads();
+    for (size_t i = 0; i < threads.size(); i++) { AddTree(threads[i]->root); }
+
+    UINT64 total = 0;
+    for (size_t i = 0; i < routines.size(); i++) { total += routines[i].self; }
+
+    vector<UINT32> order;
+    for (UINT32 i = 0; i < routines.size(); i++)
+    {
+        // The bottom of the threads only shows when code ran there before any routine.
+        if (routines[i].self != 0 || (i != RTN_THREAD && routines[i].inclusive != 0)) { order.push_back(i); }
+    }
+    size_t top = KnobTop == 0 ? order.size() : std::min((size_t)KnobTop.Value(), order.size());
+
+    fprintf(out, "===============================================\n");
+    fprintf(out, "Number of instructions executed: %llu in %lu threads\n",
+            (unsigned long long)total, (unsigned long)threads.size());
+
+    fprintf(out, "\nFlat profile:\n");
+    fprintf(out, "  %7s %16s %16s %7s %12s  %s\n", "self%", "self", "inclusive", "incl%", "calls", "routine");
+    std::sort(order.begin(), order.end(), MoreSelf);
+    for (size_t i = 0; i < top; i++)
+    {
+        const ROUTINE & routine = routines[order[i]];
+        fprintf(out, "  %7.2f %16llu %16llu %7.2f %12llu  %s\n", Percent(routine.self, total),
+                (unsigned long long)routine.self, (unsigned long long)routine.inclusive,
+                Percent(routine.inclusive, total), (unsigned long long)routine.calls, FullName(order[i]).c_str());
+    }
+
+    // As gprof: the callers of every routine above it, its callees below it.
+    fprintf(out, "\nCall graph:\n");
+    fprintf(out, "  %7s %16s %16s %12s  %s\n", "incl%", "self", "inclusive", "calls", "routine");
+    std::sort(order.begin(), order.end(), MoreInclusive);
+    for (size_t i = 0; i < top; i++)
+    {
+        UINT32 rtn = order[i];
+        const ROUTINE & routine = routines[rtn];
+
+        for (map<std::pair<UINT32, UINT32>, EDGE>::iterator e = edges.begin(); e != edges.end(); ++e)
+        {
+            if (e->first.second != rtn || e->first.first == RTN_THREAD) { continue; }
+            fprintf(out, "  %7s %16s %16llu %12llu      %s\n", "", "", (unsigned long long)e->second.inclusive,
+                    (unsigned long long)e->second.calls, FullName(e->first.first).c_str());
+        }
+        fprintf(out, "  %7.2f %16llu %16llu %12llu  %s\n", Percent(routine.inclusive, total),
+                (unsigned long long)routine.self, (unsigned long long)routine.inclusive,
+                (unsigned long long)routine.calls, FullName(rtn).c_str());
+        for (map<std::pair<UINT32, UINT32>, EDGE>::iterator e = edges.lower_bound(std::make_pair(rtn, 0));
+             e != edges.end() && e->first.first == rtn; ++e)
+        {
+            fprintf(out, "  %7s %16s %16llu %12llu      %s\n", "", "", (unsigned long long)e->second.inclusive,
+                    (unsigned long long)e->second.calls, FullName(e->first.second).c_str());
+        }
+        fprintf(out, "  -----------------------------------------------\n");
+    }
+
+    if (!KnobFolded.Value().empty())
+    {
+        FILE * file = fopen(KnobFolded.Value().c_str(), "w");
+        if (file == 0)
+        {
+            fprintf(out, "Cannot write %s\n", KnobFolded.Value().c_str());
+        }
+        else
+        {
+            for (map<string, UINT64>::iterator f = folded.begin(); f != folded.end(); ++f)
+            {
+                fprintf(file, "%s %llu\n", f->first.c_str(), (unsigned long long)f->second);
+            }
+            fclose(file);
+        }
+    }
+
+    fputs(ScopeReport().c_str(), out);
+    fputs(SelfProfReport().c_str(), out);
+    fflush(out);
+}
+
+/*!
+ * The main procedure of the tool.
+ * This function is called when the application image is loaded but not yet started.
+ * @param[in]   argc            total number of elements in the argv array
+ * @param[in]   argv            array of command line arguments,
+ *                              including pin -t <toolname> -- ...
+ */
+int main(int argc, char *argv[])
+{
+    // Routines are found by their symbols.
+    PIN_InitSymbols();
+
+    // Initialize PIN library. Print help message if -h(elp) is specified
+    // in the command line or the command line is invalid
+    if( PIN_Init(argc,argv) )
+    {
+        return Usage();
+    }
+
+    string fileName = KnobOutputFile.Value();
+
+    if (!fileName.empty())
+    {
+        out = fopen(fileName.c_str(), "w");
+        if (out == 0)
+        {
+            cerr << "callgraph: cannot open " << fileName << endl;
+            return 1;
+        }
+    }
+
+    // Every analysis routine finds the shadow stack of its thread in this register.
+    RegThreadData = PIN_ClaimToolRegister();
+    if (!REG_valid(RegThreadData))
+    {
+        cerr << "Cannot allocate a scratch register." << endl;
+        return 1;
+    }
+
+    RoutineId("", "<unknown>");
+    RoutineId("", "<thread>");
+
+    PIN_InitLock(&lock);
+    ScopeInit();
+    SelfProfInit();
+    profBlock = SelfProfKind("Block");
+    profCall = SelfProfKind("Call");
+    profReturn = SelfProfKind("Return");
+    profTrace = SelfProfCallback("traces");
+    PIN_AddThreadStartFunction(ThreadStart, 0);
+    TRACE_AddInstrumentFunction(Trace, 0);
+
+    // Register function to be called when the application exits
+    PIN_AddFiniFunction(Fini, 0);
+    if (!AttachInit(Fini))
+    {
+        cerr << "Cannot start the detach timer thread." << endl;
+        return 1;
+    }
+
+    // Start the program, never returns
+    PIN_StartProgram();
+
+    return 0;
+}
+
+/* ===================================================================== */
+/* eof */
+/* ===================================================================== */
@@ -0,0 +1,539 @@
+/*! @file
+ *  Run the analyses of BBCountTool, CTCountTool, MallocWrapTool,
+ *  MaxStackTool and BtraceTool in a single pass over the application.
+ *
+ *  Every analysis is a module switched on or off by its knob. The modules
+ *  share one Trace callback, so every trace is decoded and compiled once,
+ *  and one per-thread block of counters, found through a tool register, so
+ *  that no analysis routine takes a lock. The counters of all threads are
+ *  added up into one report when the application exits.
+ */
+
+#include "pin.H"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include "../BtraceTool/BtraceFormat.h"
+#include "ScopeFilter.h"
+#include "SelfProf.h"
+#include "Attach.h"
+
+using std::cerr;
+using std::string;
+using std::endl;
+using std::vector;
+/* ================================================================== */
+// Global variables
+/* ================================================================== */
+
+#if defined(TARGET_MAC)
+#define MALLOC "_malloc"
+#else
+#define MALLOC "malloc"
+#endif
+
+#if defined(TARGET_IA32E)
+#define SYSCALL_TABLE SyscallTableX86_64
+#define SYSCALL_ABI   BTRACE_ABI_X86_64
+#else
+#define SYSCALL_TABLE SyscallTableI386
+#define SYSCALL_ABI   BTRACE_ABI_I386
+#endif
+
+// Everything the modules keep about one thread. Only the thread itself
+// writes to its block; Fini reads all of them once the threads are done.
+struct THREAD_DATA
+{
+    THREADID    threadid;       // Pin id of the thread
+    UINT32      tid;            // OS thread id
+
+    // -bbl and -ct
+    UINT64      bbls;           // basic blocks executed
+    UINT64      direct;         // direct control flow transfers executed
+    UINT64      indirect;       // indirect control flow transfers executed
+    UINT64      other;          // other instructions executed
+
+    // -malloc
+    UINT64      mallocs;        // calls to malloc
+    UINT64      mallocBytes;    // bytes allocated by the calls that succeeded
+    UINT64      mallocSize;     // size passed to the malloc in progress
+
+    // -stack
+    ADDRINT     stackBase;      // stack pointer when the thread started
+    ADDRINT     maxStack;       // most stack used so far
+
+    // -syscalls
+    BOOL        pending;        // a system call has been entered and not yet returned
+    UINT64      syscalls;       // system calls made
+
+    // The record of the pending system call, followed by room for its strings.
+    UINT64 staging[(sizeof(BTRACE_RECORD) + BTRACE_MAX_PAYLOAD + 7) / 8];
+
+    BTRACE_RECORD * Record() { return reinterpret_cast<BTRACE_RECORD *>(staging); }
+};
+
+// Tool register that holds the THREAD_DATA of the running thread.
+static REG RegThreadData;
+
+// Blocks of every thread the application had, in the order they started.
+static vector<THREAD_DATA *> threads;
+static PIN_LOCK lock;
+
+// Kinds of the -selfprof report.
+static UINT32 profCountBbl, profStackGrew, profStackMax, profBeforeMalloc, profAfterMalloc;
+static UINT32 profSysBefore, profSysAfter, profTrace, profImage;
+
+FILE * out = stderr;
+
+/* ===================================================================== */
+// Command line switches
+/* ===================================================================== */
+KNOB<string> KnobOutputFile(KNOB_MODE_WRITEONCE,  "pintool",
+    "o", "", "specify file name for CombinedTool output");
+
+KNOB<BOOL>   KnobBbl(KNOB_MODE_WRITEONCE,  "pintool",
+    "bbl", "1", "count the basic blocks executed, as BBCountTool does");
+
+KNOB<BOOL>   KnobCt(KNOB_MODE_WRITEONCE,  "pintool",
+    "ct", "1", "count control flow transfer instructions, as CTCountTool does");
+
+KNOB<BOOL>   KnobMalloc(KNOB_MODE_WRITEONCE,  "pintool",
+    "malloc", "1", "count calls to malloc and the memory allocated, as MallocWrapTool does");
+
+KNOB<BOOL>   KnobStack(KNOB_MODE_WRITEONCE,  "pintool",
+    "stack", "1", "report the maximum stack used by every thread, as MaxStackTool does");
+
+KNOB<BOOL>   KnobSyscalls(KNOB_MODE_WRITEONCE,  "pintool",
+    "syscalls", "1", "trace the system calls, as BtraceTool does");
+
+/* ===================================================================== */
+// Utilities
+/* ===================================================================== */
+
+/*!
+ *  Print out help message.
+ */
+INT32 Usage()
+{
+    cerr << "This tool runs the analyses of BBCountTool, CTCountTool, MallocWrapTool," << endl <<
+            "MaxStackTool and BtraceTool in one pass over the application." << endl << endl;
+
+    cerr << KNOB_BASE::StringKnobSummary() << endl;
+
+    return -1;
+}
+
+/*!
+ * Copy a NUL-terminated string of the application into a record payload.
+ * @param[in]   rec     record of the system call
+ * @param[in]   arg     index of the argument that points to the string
+ */
+static VOID AddString(BTRACE_RECORD * rec, UINT32 arg)
+{
+    size_t room = BTRACE_MAX_PAYLOAD - rec->payload;
+
+    if (room <= sizeof(BTRACE_ITEM)) { return; }
+    room -= sizeof(BTRACE_ITEM);
+    if (room > BTRACE_MAX_STRING) { room = BTRACE_MAX_STRING; }
+
+    BTRACE_ITEM * item = reinterpret_cast<BTRACE_ITEM *>(reinterpret_cast<char *>(rec + 1) + rec->payload);
+
+    item->arg = arg;
+    item->flags = 0;
+    item->len = BtraceCopyString(reinterpret_cast<char *>(item + 1), rec->args[arg], room, &item->flags);
+
+    rec->payload += sizeof(BTRACE_ITEM) + item->len;
+}
+
+/* ===================================================================== */
+// Analysis routines
+/* ===================================================================== */
+
+/*!
+ * -bbl and -ct: account one executed basic block. The instruction classes
+ * of a block are known when it is instrumented, so one call per block
+ * counts all of them.
+ * @param[in]   td          block of the running thread
+ * @param[in]   bbls        1, or 0 without -bbl
+ * @param[in]   direct      direct control flow transfers in the block
+ * @param[in]   indirect    indirect control flow transfers in the block
+ * @param[in]   other       other instructions in the block
+ */
+VOID CountBbl(THREAD_DATA * td, UINT32 bbls, UINT32 direct, UINT32 indirect, UINT32 other)
+{
+    td->bbls += bbls;
+    td->direct += direct;
+    td->indirect += indirect;
+    td->other += other;
+}
+
+/*!
+ * CountBbl() under -selfprof. The plain one stays inlinable.
+ */
+VOID CountBblProf(THREAD_DATA * td, UINT32 bbls, UINT32 direct, UINT32 indirect, UINT32 other)
+{
+    SELFPROF_CALL_SCOPE(profCountBbl);
+    CountBbl(td, bbls, direct, indirect, other);
+}
+
+/*!
+ * -malloc: remember the size of a malloc that starts.
+ */
+VOID BeforeMalloc(ADDRINT size, THREAD_DATA * td)
+{
+    SELFPROF_CALL_SCOPE(profBeforeMalloc);
+    td->mallocs++;
+    td->mallocSize = size;
+}
+
+/*!
+ * -malloc: account the memory of a malloc that returns.
+ */
+VOID AfterMalloc(ADDRINT ret, THREAD_DATA * td)
+{
+    SELFPROF_CALL_SCOPE(profAfterMalloc);
+    if (ret != 0) { td->mallocBytes += td->mallocSize; }
+}
+
+/*!
+ * -stack: tell whether the stack pointer went past the deepest point so far.
+ * The stack pointer may go above the base slightly, as the dynamic loader
+ * does briefly during start-up.
+ */
+ADDRINT StackGrew(ADDRINT sp, THREAD_DATA * td)
+{
+    return (sp <= td->stackBase) & (td->stackBase - sp > td->maxStack);
+}
+
+/*!
+ * -stack: record the new deepest point of the stack.
+ */
+VOID StackMax(ADDRINT sp, THREAD_DATA * td)
+{
+    td->maxStack = td->stackBase - sp;
+}
+
+/*!
+ * StackGrew() and StackMax() under -selfprof. The plain ones stay inlinable.
+ */
+ADDRINT StackGrewProf(ADDRINT sp, THREAD_DATA * td)
+{
+    SELFPROF_CALL_SCOPE(profStackGrew);
+    return StackGrew(sp, td);
+}
+
+VOID StackMaxProf(ADDRINT sp, THREAD_DATA * td)
+{
+    SELFPROF_CALL_SCOPE(profStackMax);
+    StackMax(sp, td);
+}
+
+/*!
+ * -syscalls: record the number, arguments and path strings of a system call.
+ * @param[in]   threadid    Pin id of the calling thread
+ * @param[in]   ctx         application context at the system call
+ * @param[in]   std         calling standard used to fetch number and arguments
+ */
+VOID SysBefore(THREADID threadid, CONTEXT * ctx, SYSCALL_STANDARD std, VOID * v)
+{
+    SELFPROF_CALL_SCOPE(profSysBefore);
+    THREAD_DATA * td = reinterpret_cast<THREAD_DATA *>(PIN_GetContextReg(ctx, RegThreadData));
+    BTRACE_RECORD * rec = td->Record();
+    const SYSCALL_DESC * desc;
+
+    rec->num = PIN_GetSyscallNumber(ctx, std);
+    rec->tid = td->tid;
+    rec->ret = 0;
+    rec->payload = 0;
+    rec->flags = 0;
+    for (UINT32 i = 0; i < BTRACE_MAX_ARGS; i++)
+    {
+        rec->args[i] = PIN_GetSyscallArgument(ctx, std, i);
+    }
+    td->syscalls++;
+
+    desc = SyscallLookup(SYSCALL_TABLE, SYSCALL_TABLE_SIZE(SYSCALL_TABLE), rec->num);
+    for (UINT32 i = 0; desc != 0 && desc->args[i] != '\0'; i++)
+    {
+        if (desc->args[i] == 's') { AddString(rec, i); }
+    }
+
+    // Calls that do not return never reach SysAfter.
+    if (desc != 0 && desc->ret == 'n')
+    {
+        rec->flags |= BTRACE_NORETURN;
+        PIN_GetLock(&lock, threadid+1);
+        fprintf(out, "[pid %u] ", rec->tid);
+        BtracePrintCall(out, desc, rec, SYSCALL_ABI);
+        BtracePrintReturn(out, desc, rec, SYSCALL_ABI);
+        fputc('\n', out);
+        PIN_ReleaseLock(&lock);
+        return;
+    }
+    td->pending = true;
+}
+
+/*!
+ * -syscalls: print the system call started in SysBefore with its result.
+ * @param[in]   threadid    Pin id of the calling thread
+ * @param[in]   ctx         application context after the system call
+ * @param[in]   std         calling standard used to fetch the return value
+ */
+VOID SysAfter(THREADID threadid, CONTEXT * ctx, SYSCALL_STANDARD std, VOID * v)
+{
+    SELFPROF_CALL_SCOPE(profSysAfter);
+    THREAD_DATA * td = reinterpret_cast<THREAD_DATA *>(PIN_GetContextReg(ctx, RegThreadData));
+    BTRACE_RECORD * rec = td->Record();
+
+    if (!td->pending) { return; }
+    td->pending = false;
+
+    rec->ret = (ADDRDELTA)PIN_GetSyscallReturn(ctx, std);
+    const SYSCALL_DESC * desc = SyscallLookup(SYSCALL_TABLE, SYSCALL_TABLE_SIZE(SYSCALL_TABLE), rec->num);
+
+    PIN_GetLock(&lock, threadid+1);
+    fprintf(out, "[pid %u] ", rec->tid);
+    BtracePrintCall(out, desc, rec, SYSCALL_ABI);
+    BtracePrintReturn(out, desc, rec, SYSCALL_ABI);
+    fputc('\n', out);
+    PIN_ReleaseLock(&lock);
+}
+
+/* ===================================================================== */
+// Instrumentation callbacks
+/* ===================================================================== */
+
+/*!
+ * Insert the calls of every enabled module into a trace: one call per
+ * basic block for -bbl and -ct, and a check after every instruction that
+ * writes the stack pointer for -stack.
+ * This function is called every time a new trace is encountered.
+ * @param[in]   trace    trace to be instrumented
+ * @param[in]   v        value specified by the tool in the TRACE_AddInstrumentFunction
+ *                       function call
+ */
+VOID Trace(TRACE trace, VOID *v)
+{
+    SELFPROF_INSTRUMENT_SCOPE(profTrace);
+
+    // Code outside -include_img, -exclude_img and -rtn runs without analysis calls.
+    if (!ScopeTrace(trace)) { return; }
+
+    BOOL prof = SelfProfOn();
+
+    for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl))
+    {
+        UINT32 direct = 0, indirect = 0, other = 0;
+
+        for (INS ins = BBL_InsHead(bbl); INS_Valid(ins); ins = INS_Next(ins))
+        {
+            if (KnobCt)
+            {
+                if (INS_IsDirectControlFlow(ins))           { direct++; }
+                else if (INS_IsIndirectControlFlow(ins))    { indirect++; }
+                else                                        { other++; }
+            }
+
+            if (KnobStack && INS_RegWContain(ins, REG_STACK_PTR) && !INS_IsSysenter(ins))
+            {
+                IPOINT where = IPOINT_AFTER;
+                if (!INS_IsValidForIpointAfter(ins))
+                {
+                    if (!INS_IsValidForIpointTakenBranch(ins)) { continue; }
+                    where = IPOINT_TAKEN_BRANCH;
+                }
+                INS_InsertIfCall(ins, where, prof ? (AFUNPTR)StackGrewProf : (AFUNPTR)StackGrew,
+                                 IARG_REG_VALUE, REG_STACK_PTR, IARG_REG_VALUE, RegThreadData, IARG_END);
+                INS_InsertThenCall(ins, where, prof ? (AFUNPTR)StackMaxProf : (AFUNPTR)StackMax,
+                                   IARG_REG_VALUE, REG_STACK_PTR, IARG_REG_VALUE, RegThreadData, IARG_END);
+            }
+        }
+
+        if (KnobBbl || KnobCt)
+        {
+            BBL_InsertCall(bbl, IPOINT_BEFORE, prof ? (AFUNPTR)CountBblProf : (AFUNPTR)CountBbl,
+                           IARG_REG_VALUE, RegThreadData,
+                           IARG_UINT32, KnobBbl ? 1 : 0, IARG_UINT32, direct, IARG_UINT32, indirect,
+                           IARG_UINT32, other, IARG_END);
+        }
+    }
+}
+
+/*!
+ * -malloc: instrument malloc in every image that has one.
+ * @param[in]   img     image that was loaded
+ */
+VOID Image(IMG img, VOID *v)
+{
+    SELFPROF_INSTRUMENT_SCOPE(profImage);
+
+    RTN mallocRtn = RTN_FindByName(img, MALLOC);
+    if (RTN_Valid(mallocRtn))
+    {
+        RTN_Open(mallocRtn);
+        RTN_InsertCall(mallocRtn, IPOINT_BEFORE, (AFUNPTR)BeforeMalloc,
+                       IARG_FUNCARG_ENTRYPOINT_VALUE, 0, IARG_REG_VALUE, RegThreadData, IARG_END);
+        RTN_InsertCall(mallocRtn, IPOINT_AFTER, (AFUNPTR)AfterMalloc,
+                       IARG_FUNCRET_EXITPOINT_VALUE, IARG_REG_VALUE, RegThreadData, IARG_END);
+        RTN_Close(mallocRtn);
+    }
+}
+
+/*!
+ * Allocate the block of a new thread and point its tool register at it.
+ * @param[in]   threadid    Pin id of the new thread
+ */
+VOID ThreadStart(THREADID threadid, CONTEXT *ctxt, INT32 flags, VOID *v)
+{
+    THREAD_DATA * td = new THREAD_DATA();
+
+    td->threadid = threadid;
+    td->tid = PIN_GetTid();
+    td->stackBase = AttachStackBase(PIN_GetContextReg(ctxt, REG_STACK_PTR));
+    PIN_SetContextReg(ctxt, RegThreadData, reinterpret_cast<ADDRINT>(td));
+
+    PIN_GetLock(&lock, threadid+1);
+    threads.push_back(td);
+    PIN_ReleaseLock(&lock);
+}
+
+/*!
+ * Print the report of every enabled module, in the words of the tool it
+ * stands in for.
+ * This function is called when the application exits.
+ * @param[in]   code            exit code of the application
+ * @param[in]   v               value specified by the tool in the
+ *                              PIN_AddFiniFunction function call
+ */
+VOID Fini(INT32 code, VOID *v)
+{
+    UINT64 bbls = 0, direct = 0, indirect = 0, other = 0, mallocs = 0, mallocBytes = 0, syscalls = 0;
+
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        bbls += threads[i]->bbls;
+        direct += threads[i]->direct;
+        indirect += threads[i]->indirect;
+        other += threads[i]->other;
+        mallocs += threads[i]->mallocs;
+        mallocBytes += threads[i]->mallocBytes;
+        syscalls += threads[i]->syscalls;
+    }
+
+    fprintf(out, "===============================================\n");
+    if (KnobBbl)
+    {
+        fprintf(out, "Number of basic blocks executed: %llu\n", (unsigned long long)bbls);
+    }
+    if (KnobCt)
+    {
+        fprintf(out, "Number of direct control flow transfer instructions: %llu\n", (unsigned long long)direct);
+        fprintf(out, "Number of indirect control flow transfer instructions: %llu\n", (unsigned long long)indirect);
+        fprintf(out, "Number of other control flow transfer instructions: %llu\n", (unsigned long long)other);
+    }
+    if (KnobMalloc)
+    {
+        fprintf(out, "Number of calls made to malloc: %llu\n", (unsigned long long)mallocs);
+        fprintf(out, "Total amount of memory allocated: %llu\n", (unsigned long long)mallocBytes);
+    }
+    if (KnobStack)
+    {
+        for (size_t i = 0; i < threads.size(); i++)
+        {
+            fprintf(out, "Thread ID:%u | Max Stack Used:%lu\n", threads[i]->threadid,
+                    (unsigned long)threads[i]->maxStack);
+        }
+    }
+    if (KnobSyscalls)
+    {
+        fprintf(out, "Number of system calls: %llu\n", (unsigned long long)syscalls);
+    }
+    fputs(ScopeReport().c_str(), out);
+    fputs(SelfProfReport().c_str(), out);
+    fclose(out);
+}
+
+/*!
+ * The main procedure of the tool.
+ * This function is called when the application image is loaded but not yet started.
+ * @param[in]   argc            total number of elements in the argv array
+ * @param[in]   argv            array of command line arguments,
+ *                              including pin -t <toolname> -- ...
+ */
+int main(int argc, char *argv[])
+{
+    // malloc is found by its symbol.
+    PIN_InitSymbols();
+
+    // Initialize PIN library. Print help message if -h(elp) is specified
+    // in the command line or the command line is invalid
+    if( PIN_Init(argc,argv) )
+    {
+        return Usage();
+    }
+
+    string fileName = KnobOutputFile.Value();
+
+    if (!fileName.empty())
+    {
+        out = fopen(fileName.c_str(), "w");
+        if (out == 0)
+        {
+            cerr << "combined: cannot open " << fileName << endl;
+            return 1;
+        }
+    }
+
+    // Every analysis routine finds the counters of its thread in this register.
+    RegThreadData = PIN_ClaimToolRegister();
+    if (!REG_valid(RegThreadData))
+    {
+        cerr << "Cannot allocate a scratch register." << endl;
+        return 1;
+    }
+
+    PIN_InitLock(&lock);
+    ScopeInit();
+    SelfProfInit();
+    profCountBbl = SelfProfKind("CountBbl");
+    profStackGrew = SelfProfKind("StackGrew");
+    profStackMax = SelfProfKind("StackMax");
+    profBeforeMalloc = SelfProfKind("BeforeMalloc");
+    profAfterMalloc = SelfProfKind("AfterMalloc");
+    profSysBefore = SelfProfKind("SysBefore");
+    profSysAfter = SelfProfKind("SysAfter");
+    profTrace = SelfProfCallback("traces");
+    profImage = SelfProfCallback("images");
+    PIN_AddThreadStartFunction(ThreadStart, 0);
+
+    if (KnobBbl || KnobCt || KnobStack)
+    {
+        TRACE_AddInstrumentFunction(Trace, 0);
+    }
+    if (KnobMalloc)
+    {
+        IMG_AddInstrumentFunction(Image, 0);
+    }
+    if (KnobSyscalls)
+    {
+        PIN_AddSyscallEntryFunction(SysBefore, 0);
+        PIN_AddSyscallExitFunction(SysAfter, 0);
+    }
+
+    // Register function to be called when the application exits
+    PIN_AddFiniFunction(Fini, 0);
+    if (!AttachInit(Fini))
+    {
+        cerr << "Cannot start the detach timer thread." << endl;
+        return 1;
+    }
+
+    // Start the program, never returns
+    PIN_StartProgram();
+
+    return 0;
+}
+
+/* ===================================================================== */
+/* eof */
+/* ===================================================================== */
@@ -0,0 +1,148 @@
+/*! @file
+ *  Timed detach, shared by all the tools, so that they can profile a
+ *  process they were attached to with "pin -pid" and leave it running.
+ *
+ *      -detach_after <s>     detach after this many seconds
+ *      -detach_file <path>   detach as soon as this file exists
+ *
+ *  Either way the tool writes its results as if the application had exited
+ *  and Pin lets go of the process, which runs on natively. Once the results
+ *  are written, at detach or at exit, "<path>.done" is created, so that a
+ *  launcher knows when to read them. Common/attach is that launcher.
+ *
+ *  A tool calls AttachInit() with its Fini function, after it registered
+ *  it, and its Fini must flush what it wrote. Threads that were running
+ *  when Pin attached start in the middle of their stack: AttachStackBase()
+ *  finds where it begins.
+ */
+
+#ifndef ATTACH_H
+#define ATTACH_H
+
+#include "pin.H"
+#include <string>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+KNOB<UINT32> KnobDetachAfter(KNOB_MODE_WRITEONCE,  "pintool",
+    "detach_after", "0", "write the results and detach from the application after this many seconds, 0 for never");
+
+KNOB<std::string> KnobDetachFile(KNOB_MODE_WRITEONCE,  "pintool",
+    "detach_file", "", "write the results and detach from the application as soon as this file exists; "
+    "<file>.done is created when the results are written");
+
+#define ATTACH_POLL_MS  100     // how often the timer thread looks at the clock and the file
+
+static FINI_CALLBACK attach_report;     // Fini of the tool
+static PIN_THREAD_UID attach_uid;
+static volatile BOOL attach_exit = FALSE;
+
+/*!
+ * Create "<-detach_file>.done", to tell that the results are written.
+ */
+static VOID AttachDone()
+{
+    if (KnobDetachFile.Value().empty()) { return; }
+
+    FILE * done = fopen((KnobDetachFile.Value() + ".done").c_str(), "w");
+    if (done != 0) { fclose(done); }
+}
+
+/*!
+ * Pin let go of the application, which no longer runs any analysis code:
+ * write the results the tool would have written at exit.
+ */
+static VOID AttachDetached(VOID * v)
+{
+    attach_report(0, 0);
+    AttachDone();
+}
+
+/*!
+ * Body of the timer thread: ask Pin to detach when the time is up or the
+ * file appears, or leave when the application exits first.
+ */
+static VOID AttachTimer(VOID * arg)
+{
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while (!attach_exit)
+    {
+        PIN_Sleep(ATTACH_POLL_MS);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        BOOL due = KnobDetachAfter != 0 && now.tv_sec - start.tv_sec >= (time_t)KnobDetachAfter.Value();
+        due = due || (!KnobDetachFile.Value().empty() && access(KnobDetachFile.Value().c_str(), F_OK) == 0);
+        if (due && !attach_exit)
+        {
+            PIN_Detach();
+            return;
+        }
+    }
+}
+
+/*!
+ * The application exits before the tool detached: stop the timer thread.
+ */
+static VOID AttachPrepareForFini(VOID * v)
+{
+    attach_exit = TRUE;
+}
+
+/*!
+ * Registered after the Fini of the tool, so it runs once the results are out.
+ */
+static VOID AttachFini(INT32 code, VOID * v)
+{
+    PIN_WaitForThreadTermination(attach_uid, 2 * ATTACH_POLL_MS, 0);
+    AttachDone();
+}
+
+/*!
+ * Set up -detach_after and -detach_file. Call in main, after the Fini of
+ * the tool was registered.
+ * @param[in]   fini    Fini of the tool, called with code 0 at detach
+ * @return FALSE if the timer thread cannot be started
+ */
+inline BOOL AttachInit(FINI_CALLBACK fini)
+{
+    if (KnobDetachAfter == 0 && KnobDetachFile.Value().empty()) { return TRUE; }
+
+    attach_report = fini;
+    PIN_AddDetachFunction(AttachDetached, 0);
+    PIN_AddPrepareForFiniFunction(AttachPrepareForFini, 0);
+    PIN_AddFiniFunction(AttachFini, 0);
+    return PIN_SpawnInternalThread(AttachTimer, 0, 0, &attach_uid) != INVALID_THREADID;
+}
+
+/*!
+ * @return the base (highest address) of the stack of a thread that starts
+ *         with this stack pointer. A thread created under Pin starts at
+ *         its base; one that was running when Pin attached is somewhere in
+ *         its stack, whose base is then the end of the mapping holding sp.
+ */
+inline ADDRINT AttachStackBase(ADDRINT sp)
+{
+    if (!PIN_IsAttaching()) { return sp; }
+
+    FILE * maps = fopen("/proc/self/maps", "r");
+    if (maps == 0) { return sp; }
+
+    char line[4096];
+    ADDRINT base = sp;
+    while (fgets(line, sizeof(line), maps) != 0)
+    {
+        unsigned long low, high;
+        if (sscanf(line, "%lx-%lx", &low, &high) == 2 && low <= sp && sp < high)
+        {
+            base = high;
+            break;
+        }
+    }
+    fclose(maps);
+    return base;
+}
+
+#endif // ATTACH_H
@@ -0,0 +1,97 @@
+/*! @file
+ *  Names of the output files of a tool that follows forks and execs, so
+ *  that every process writes its own files and none truncates another's.
+ *
+ *  A "%p" in the name given on the command line is replaced by the process
+ *  id; a forked child whose name has no "%p" gets ".<pid>" appended. A
+ *  program that execs keeps its pid, and its new image would reopen the
+ *  files of the old one: a file that is already there gets a ".1", ".2",
+ *  ... inserted before its extension instead, out.<pid>.log then
+ *  out.<pid>.1.log, or out.log then out.1.log without "%p". A file left by
+ *  an earlier run is overwritten as usual: a name without "%p" or ".<pid>"
+ *  only gets the counter when its file was written since this process
+ *  started.
+ */
+
+#ifndef OUTPUT_FILE_H
+#define OUTPUT_FILE_H
+
+#include "pin.H"
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*!
+ * @return when this process started, in seconds since the epoch; an exec
+ * keeps it. 0 if /proc cannot tell.
+ */
+static time_t OutputProcessStart()
+{
+    unsigned long long ticks = 0, boot = 0;
+    char line[1024];
+
+    // Field 22 of /proc/self/stat, counted past the command name, which
+    // may hold spaces and parentheses.
+    FILE * file = fopen("/proc/self/stat", "r");
+    if (file == 0) { return 0; }
+    char * fields = fgets(line, sizeof(line), file) != 0 ? strrchr(line, ')') : 0;
+    fclose(file);
+    if (fields == 0) { return 0; }
+    char * field = strtok(fields + 1, " ");
+    for (UINT32 i = 3; field != 0 && i < 22; i++) { field = strtok(0, " "); }
+    if (field == 0) { return 0; }
+    ticks = strtoull(field, 0, 10);
+
+    file = fopen("/proc/stat", "r");
+    if (file == 0) { return 0; }
+    while (fgets(line, sizeof(line), file) != 0 && sscanf(line, "btime %llu", &boot) != 1) { }
+    fclose(file);
+    if (boot == 0) { return 0; }
+
+    return boot + ticks / sysconf(_SC_CLK_TCK);
+}
+
+/*!
+ * @param[in]   templ   file name given on the command line
+ * @param[in]   child   TRUE in a child process created by fork
+ * @return the name of the output file of this process
+ */
+static std::string OutputFileName(const std::string & templ, BOOL child)
+{
+    std::string pid = decstr(PIN_GetPid());
+    std::string name = templ;
+    BOOL expanded = FALSE;
+
+    for (size_t at = name.find("%p"); at != std::string::npos; at = name.find("%p", at + pid.size()))
+    {
+        name.replace(at, 2, pid);
+        expanded = TRUE;
+    }
+    if (child && !expanded)
+    {
+        name += "." + pid;
+        expanded = TRUE;
+    }
+
+    struct stat st;
+    if (stat(name.c_str(), &st) != 0) { return name; }
+    if (!expanded && st.st_mtime < OutputProcessStart()) { return name; }
+
+    // The counter goes before the extension, so that "*.log" still matches.
+    size_t dot = name.rfind('.');
+    size_t slash = name.rfind('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) { dot = name.size(); }
+
+    std::string unique = name;
+    for (UINT32 i = 1; stat(unique.c_str(), &st) == 0; i++)
+    {
+        unique = name.substr(0, dot) + "." + decstr(i) + name.substr(dot);
+    }
+    return unique;
+}
+
+#endif
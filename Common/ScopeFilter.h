@@ -0,0 +1,236 @@
+/*! @file
+ *  Image and routine filters shared by the instrumenting tools.
+ *
+ *      -include_img <glob>   instrument only images whose name matches
+ *      -exclude_img <glob>   do not instrument images whose name matches
+ *      -rtn <glob>           instrument only routines whose name matches
+ *
+ *  Every switch may be given more than once. A glob matches the full path
+ *  of an image or its file name alone, and knows '*' and '?'. Code outside
+ *  the scope is left as it is, without any analysis call.
+ *
+ *  The image filters are decided once per image, when it is loaded, into a
+ *  sorted table of address ranges; the Trace or Instruction callback of a
+ *  tool only looks up an address in it. A tool calls ScopeInit() after
+ *  PIN_Init(), ScopeTrace() or ScopeIns() in its instrumentation callback,
+ *  and prints ScopeReport() with its results. -rtn needs PIN_InitSymbols().
+ */
+
+#ifndef SCOPE_FILTER_H
+#define SCOPE_FILTER_H
+
+#include "pin.H"
+#include <string>
+#include <vector>
+#include <algorithm>
+
+KNOB<std::string> KnobIncludeImg(KNOB_MODE_APPEND,  "pintool",
+    "include_img", "", "instrument only images whose path or file name matches this glob (repeatable)");
+
+KNOB<std::string> KnobExcludeImg(KNOB_MODE_APPEND,  "pintool",
+    "exclude_img", "", "do not instrument images whose path or file name matches this glob (repeatable)");
+
+KNOB<std::string> KnobRtn(KNOB_MODE_APPEND,  "pintool",
+    "rtn", "", "instrument only routines whose name matches this glob (repeatable)");
+
+// One loaded image that is in scope, [low, high].
+struct SCOPE_RANGE
+{
+    ADDRINT low;
+    ADDRINT high;
+    UINT32  id;     // IMG_Id() of the image
+
+    bool operator<(const SCOPE_RANGE & other) const { return low < other.low; }
+};
+
+static BOOL scope_by_img = FALSE;               // -include_img or -exclude_img given
+static BOOL scope_by_rtn = FALSE;               // -rtn given
+static std::vector<SCOPE_RANGE> scope_ranges;   // sorted by low
+static std::vector<std::string> scope_images;   // every image loaded, with its verdict
+static UINT64 scope_traces, scope_traces_in;    // traces seen, and instrumented
+static UINT64 scope_ins, scope_ins_in;          // instructions seen, and instrumented
+
+/*!
+ * @return TRUE if a name matches a glob of '*', '?' and literal characters
+ */
+inline BOOL ScopeGlob(const char * pattern, const char * name)
+{
+    const char * star = 0;      // last '*' seen in the pattern
+    const char * resume = 0;    // where in the name that '*' stopped matching
+
+    while (*name != '\0')
+    {
+        if (*pattern == '*')                            { star = pattern++; resume = name; }
+        else if (*pattern == '?' || *pattern == *name)  { pattern++; name++; }
+        else if (star != 0)                             { pattern = star + 1; name = ++resume; }
+        else                                            { return FALSE; }
+    }
+    while (*pattern == '*') { pattern++; }
+    return *pattern == '\0';
+}
+
+/*!
+ * @return TRUE if a name matches any value of an APPEND knob
+ * @param[in]   basename    TRUE to try the part after the last '/' as well
+ */
+inline BOOL ScopeMatchAny(KNOB<std::string> & knob, const std::string & name, BOOL basename)
+{
+    std::string file = name.substr(name.rfind('/') + 1);
+
+    for (UINT32 i = 0; i < knob.NumberOfValues(); i++)
+    {
+        const std::string & glob = knob.Value(i);
+        if (glob.empty()) { continue; }
+        if (ScopeGlob(glob.c_str(), name.c_str())) { return TRUE; }
+        if (basename && ScopeGlob(glob.c_str(), file.c_str())) { return TRUE; }
+    }
+    return FALSE;
+}
+
+/*!
+ * @return TRUE if the knob was given a non-empty value
+ */
+inline BOOL ScopeGiven(KNOB<std::string> & knob)
+{
+    for (UINT32 i = 0; i < knob.NumberOfValues(); i++)
+    {
+        if (!knob.Value(i).empty()) { return TRUE; }
+    }
+    return FALSE;
+}
+
+/*!
+ * @return TRUE if any scope switch was given
+ */
+inline BOOL ScopeActive()
+{
+    return scope_by_img || scope_by_rtn;
+}
+
+/*!
+ * Decide whether a newly loaded image is in scope and enter its range.
+ */
+static VOID ScopeImageLoad(IMG img, VOID * v)
+{
+    const std::string & name = IMG_Name(img);
+    BOOL in = (!ScopeGiven(KnobIncludeImg) || ScopeMatchAny(KnobIncludeImg, name, TRUE))
+              && !ScopeMatchAny(KnobExcludeImg, name, TRUE);
+
+    scope_images.push_back((in ? "  + " : "  - ") + name);
+    if (!in) { return; }
+
+    SCOPE_RANGE range = { IMG_LowAddress(img), IMG_HighAddress(img), IMG_Id(img) };
+    scope_ranges.insert(std::upper_bound(scope_ranges.begin(), scope_ranges.end(), range), range);
+}
+
+/*!
+ * Remove the range of an image that is unloaded; its addresses may be reused.
+ */
+static VOID ScopeImageUnload(IMG img, VOID * v)
+{
+    for (size_t i = 0; i < scope_ranges.size(); i++)
+    {
+        if (scope_ranges[i].id == IMG_Id(img))
+        {
+            scope_ranges.erase(scope_ranges.begin() + i);
+            return;
+        }
+    }
+}
+
+/*!
+ * Register the image callbacks of the filters. Call after PIN_Init().
+ */
+inline VOID ScopeInit()
+{
+    scope_by_img = ScopeGiven(KnobIncludeImg) || ScopeGiven(KnobExcludeImg);
+    scope_by_rtn = ScopeGiven(KnobRtn);
+    if (!scope_by_img) { return; }
+    IMG_AddInstrumentFunction(ScopeImageLoad, 0);
+    IMG_AddUnloadFunction(ScopeImageUnload, 0);
+}
+
+/*!
+ * @return TRUE if code at an address of a routine is in scope
+ */
+inline BOOL ScopeAddress(ADDRINT addr, RTN rtn)
+{
+    if (scope_by_img)
+    {
+        // Find the last range starting at or below addr.
+        SCOPE_RANGE key = { addr, addr, 0 };
+        std::vector<SCOPE_RANGE>::iterator it = std::upper_bound(scope_ranges.begin(), scope_ranges.end(), key);
+        if (it == scope_ranges.begin() || addr > (--it)->high) { return FALSE; }
+    }
+    if (scope_by_rtn)
+    {
+        if (!RTN_Valid(rtn) || !ScopeMatchAny(KnobRtn, RTN_Name(rtn), FALSE)) { return FALSE; }
+    }
+    return TRUE;
+}
+
+/*!
+ * For a Trace callback.
+ * @return TRUE if the trace is to be instrumented
+ */
+inline BOOL ScopeTrace(TRACE trace)
+{
+    if (!ScopeActive()) { return TRUE; }
+
+    BOOL in = ScopeAddress(TRACE_Address(trace), TRACE_Rtn(trace));
+    scope_traces++;
+    if (in) { scope_traces_in++; }
+    return in;
+}
+
+/*!
+ * For an Instruction callback.
+ * @return TRUE if the instruction is to be instrumented
+ */
+inline BOOL ScopeIns(INS ins)
+{
+    if (!ScopeActive()) { return TRUE; }
+
+    BOOL in = ScopeAddress(INS_Address(ins), INS_Rtn(ins));
+    scope_ins++;
+    if (in) { scope_ins_in++; }
+    return in;
+}
+
+/*!
+ * @return the lines that tell what was instrumented, one per loaded image
+ *         ("+" in scope, "-" not) and the share of the code instrumented;
+ *         empty when no scope switch was given
+ */
+inline std::string ScopeReport()
+{
+    if (!ScopeActive()) { return ""; }
+
+    std::string report = "Scope:";
+    for (UINT32 i = 0; i < KnobIncludeImg.NumberOfValues(); i++)
+    {
+        if (!KnobIncludeImg.Value(i).empty()) { report += " -include_img " + KnobIncludeImg.Value(i); }
+    }
+    for (UINT32 i = 0; i < KnobExcludeImg.NumberOfValues(); i++)
+    {
+        if (!KnobExcludeImg.Value(i).empty()) { report += " -exclude_img " + KnobExcludeImg.Value(i); }
+    }
+    for (UINT32 i = 0; i < KnobRtn.NumberOfValues(); i++)
+    {
+        if (!KnobRtn.Value(i).empty()) { report += " -rtn " + KnobRtn.Value(i); }
+    }
+    report += "\n";
+
+    for (size_t i = 0; i < scope_images.size(); i++) { report += scope_images[i] + "\n"; }
+    if (scope_traces != 0)
+    {
+        report += "Traces instrumented: " + decstr(scope_traces_in) + " of " + decstr(scope_traces) + "\n";
+    }
+    if (scope_ins != 0)
+    {
+        report += "Instructions instrumented: " + decstr(scope_ins_in) + " of " + decstr(scope_ins) + "\n";
+    }
+    return report;
+}
+
+#endif // SCOPE_FILTER_H
@@ -0,0 +1,254 @@
+/*! @file
+ *  Overhead report of a tool itself, shared by all the tools.
+ *
+ *      -selfprof             print where the tool spent its time at Fini
+ *
+ *  The report tells, for every kind of analysis call the tool registered,
+ *  how often it ran and about how long it took in all, for every
+ *  instrumentation callback how often it ran and how long it took, and what
+ *  Pin's code cache holds. With it one can tell whether a slow run pays for
+ *  the JIT, for the analysis calls or for the output.
+ *
+ *  Analysis calls are counted in per-thread counters; one call of every
+ *  SELFPROF_PERIOD of a kind is timed and the total is estimated from those.
+ *  Without -selfprof a profiled routine only tests a flag.
+ *
+ *  A tool calls SelfProfKind() for each kind of analysis call and
+ *  SelfProfInit() in main, opens its analysis routines with
+ *  SELFPROF_CALL_SCOPE(kind) and its instrumentation callbacks with
+ *  SELFPROF_INSTRUMENT_SCOPE(kind), and prints SelfProfReport() at Fini.
+ *  Routines that Pin would inline get a profiled twin instead, inserted
+ *  only under -selfprof, so that the flag test does not keep them from
+ *  being inlined; their times are then those of a call that is not.
+ */
+
+#ifndef SELF_PROF_H
+#define SELF_PROF_H
+
+#include "pin.H"
+#include <string>
+#include <stdio.h>
+#include <time.h>
+
+KNOB<BOOL> KnobSelfProf(KNOB_MODE_WRITEONCE,  "pintool",
+    "selfprof", "0", "report the analysis calls, instrumentation time and code cache of the tool at Fini");
+
+#define SELFPROF_MAX_KINDS  16
+#define SELFPROF_PERIOD     256     // one call in this many is timed, a power of 2
+
+// What one thread did in one kind of analysis call.
+struct SELFPROF_COUNT
+{
+    UINT64  calls;
+    UINT64  samples;        // calls timed
+    UINT64  sampledNs;      // time of the calls timed
+};
+
+// Counters of a thread, only ever written by that thread.
+struct SELFPROF_THREAD
+{
+    SELFPROF_COUNT  kinds[SELFPROF_MAX_KINDS];
+};
+
+// An instrumentation callback.
+struct SELFPROF_CALLBACK
+{
+    const char *    name;
+    UINT64          calls;
+    UINT64          ns;
+};
+
+static BOOL selfprof_on = FALSE;
+static const char * selfprof_names[SELFPROF_MAX_KINDS];
+static UINT32 selfprof_num_kinds;
+static SELFPROF_CALLBACK selfprof_callbacks[SELFPROF_MAX_KINDS];
+static UINT32 selfprof_num_callbacks;
+static SELFPROF_THREAD * selfprof_threads[PIN_MAX_THREADS];
+static UINT64 selfprof_start_ns;
+static UINT64 selfprof_traces_inserted, selfprof_trace_bytes;   // traces Pin put in the code cache
+static UINT64 selfprof_flushes;                                 // times the code cache was flushed
+
+/*!
+ * @return a monotonic time stamp in nanoseconds
+ */
+static inline UINT64 SelfProfNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UINT64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*!
+ * Register a kind of analysis call. Call in main, before PIN_StartProgram().
+ * @return the kind, for SELFPROF_CALL_SCOPE()
+ */
+inline UINT32 SelfProfKind(const char * name)
+{
+    ASSERTX(selfprof_num_kinds < SELFPROF_MAX_KINDS);
+    selfprof_names[selfprof_num_kinds] = name;
+    return selfprof_num_kinds++;
+}
+
+/*!
+ * Register an instrumentation callback, named after what it is given
+ * ("traces", "instructions", "images"). Call in main.
+ * @return the kind, for SELFPROF_INSTRUMENT_SCOPE()
+ */
+inline UINT32 SelfProfCallback(const char * name)
+{
+    ASSERTX(selfprof_num_callbacks < SELFPROF_MAX_KINDS);
+    selfprof_callbacks[selfprof_num_callbacks].name = name;
+    return selfprof_num_callbacks++;
+}
+
+/*!
+ * @return TRUE under -selfprof, to choose profiled twins of inlined routines
+ */
+inline BOOL SelfProfOn()
+{
+    return selfprof_on;
+}
+
+/*!
+ * Counts and, once in SELFPROF_PERIOD, times an analysis call, from its
+ * construction to the end of the enclosing scope.
+ */
+class SELFPROF_CALL
+{
+  public:
+    SELFPROF_CALL(UINT32 kind) : _count(0), _start(0)
+    {
+        if (!selfprof_on) { return; }
+
+        // A thread only ever touches its own slot, so it may fill it itself.
+        THREADID tid = PIN_ThreadId();
+        if (tid == INVALID_THREADID) { return; }
+        if (selfprof_threads[tid] == 0) { selfprof_threads[tid] = new SELFPROF_THREAD(); }
+
+        _count = &selfprof_threads[tid]->kinds[kind];
+        if ((++_count->calls & (SELFPROF_PERIOD - 1)) == 0) { _start = SelfProfNow(); }
+    }
+
+    ~SELFPROF_CALL()
+    {
+        if (_start == 0) { return; }
+        _count->sampledNs += SelfProfNow() - _start;
+        _count->samples++;
+    }
+
+  private:
+    SELFPROF_COUNT *    _count;
+    UINT64              _start;
+};
+
+/*!
+ * Counts and times an instrumentation callback. Pin runs those one at a
+ * time, so their counters are shared.
+ */
+class SELFPROF_INSTRUMENT
+{
+  public:
+    SELFPROF_INSTRUMENT(UINT32 kind) : _callback(&selfprof_callbacks[kind]), _start(0)
+    {
+        if (selfprof_on) { _start = SelfProfNow(); }
+    }
+
+    ~SELFPROF_INSTRUMENT()
+    {
+        if (_start == 0) { return; }
+        _callback->calls++;
+        _callback->ns += SelfProfNow() - _start;
+    }
+
+  private:
+    SELFPROF_CALLBACK * _callback;
+    UINT64              _start;
+};
+
+#define SELFPROF_CALL_SCOPE(kind)       SELFPROF_CALL selfprof_call(kind)
+#define SELFPROF_INSTRUMENT_SCOPE(kind) SELFPROF_INSTRUMENT selfprof_instrument(kind)
+
+/*!
+ * Count the traces Pin compiles into the code cache.
+ */
+static VOID SelfProfTraceInserted(TRACE trace, VOID * v)
+{
+    selfprof_traces_inserted++;
+    selfprof_trace_bytes += TRACE_CodeCacheSize(trace);
+}
+
+/*!
+ * Count the flushes of the code cache; every trace in it is compiled again.
+ */
+static VOID SelfProfCacheFlushed(VOID * v)
+{
+    selfprof_flushes++;
+}
+
+/*!
+ * Turn the profile on under -selfprof. Call after PIN_Init().
+ */
+inline VOID SelfProfInit()
+{
+    if (!KnobSelfProf) { return; }
+
+    selfprof_on = TRUE;
+    selfprof_start_ns = SelfProfNow();
+    CODECACHE_AddTraceInsertedFunction(SelfProfTraceInserted, 0);
+    CODECACHE_AddCacheFlushedFunction(SelfProfCacheFlushed, 0);
+}
+
+/*!
+ * @return the self profile, empty without -selfprof
+ */
+inline std::string SelfProfReport()
+{
+    if (!selfprof_on) { return ""; }
+
+    char line[256];
+    double run = (SelfProfNow() - selfprof_start_ns) / 1e9;
+    std::string report;
+
+    snprintf(line, sizeof(line), "Self profile: %.3f s from start to Fini\n", run);
+    report += line;
+
+    snprintf(line, sizeof(line), "  %-24s %16s %12s %10s %10s\n",
+             "analysis call", "calls", "timed", "ns/call", "est. s");
+    report += line;
+    for (UINT32 k = 0; k < selfprof_num_kinds; k++)
+    {
+        SELFPROF_COUNT total = { 0, 0, 0 };
+        for (UINT32 t = 0; t < PIN_MAX_THREADS; t++)
+        {
+            if (selfprof_threads[t] == 0) { continue; }
+            total.calls += selfprof_threads[t]->kinds[k].calls;
+            total.samples += selfprof_threads[t]->kinds[k].samples;
+            total.sampledNs += selfprof_threads[t]->kinds[k].sampledNs;
+        }
+
+        double perCall = total.samples ? (double)total.sampledNs / total.samples : 0;
+        snprintf(line, sizeof(line), "  %-24s %16llu %12llu %10.1f %10.3f\n", selfprof_names[k],
+                 (unsigned long long)total.calls, (unsigned long long)total.samples,
+                 perCall, perCall * total.calls / 1e9);
+        report += line;
+    }
+
+    for (UINT32 c = 0; c < selfprof_num_callbacks; c++)
+    {
+        const SELFPROF_CALLBACK & cb = selfprof_callbacks[c];
+        snprintf(line, sizeof(line), "  instrumented %llu %s in %.3f s (%.1f%% of the run)\n",
+                 (unsigned long long)cb.calls, cb.name, cb.ns / 1e9, run > 0 ? cb.ns / 1e7 / run : 0);
+        report += line;
+    }
+
+    snprintf(line, sizeof(line), "  code cache: %llu traces compiled (%llu KB), %llu flushes; "
+             "%u traces and %u exit stubs in the cache, %u KB used of %u KB reserved\n",
+             (unsigned long long)selfprof_traces_inserted, (unsigned long long)(selfprof_trace_bytes / 1024),
+             (unsigned long long)selfprof_flushes, CODECACHE_NumTracesInCache(),
+             CODECACHE_NumExitStubsInCache(), CODECACHE_CodeMemUsed() / 1024,
+             CODECACHE_CodeMemReserved() / 1024);
+    report += line;
+    return report;
+}
+
+#endif // SELF_PROF_H
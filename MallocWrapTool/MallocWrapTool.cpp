@@ -14,6 +14,9 @@
 #include <iostream>
 #include <fstream>
 #include <map>
+#include "SelfProf.h"
+#include "Attach.h"
+#include "OutputFile.h"
 
 using std::hex;
 using std::cerr;
@@ -41,22 +44,38 @@ UINT64 memorySize = 0;     //size to be allocated by malloc
 map<THREADID, UINT64> thread_map;
 std::ofstream TraceFile;
 PIN_LOCK lock1, lock2;
+UINT32 profBefore, profAfter, profImage;   // kinds of the -selfprof report
 /* ===================================================================== */
 /* Commandline Switches */
 /* ===================================================================== */
 
 KNOB<string> KnobOutputFile(KNOB_MODE_WRITEONCE, "pintool",
-    "o", "malloctrace.out", "specify trace file name");
+    "o", "malloctrace.out", "specify trace file name, %p is replaced by the process id; "
+    "forked children without %p write to <file>.<pid>");
 
 /* ===================================================================== */
 
 
+/* ===================================================================== */
+/* Utilities                                                             */
+/* ===================================================================== */
+
+/*!
+ * Open the trace file of this process, named as OutputFile.h tells.
+ * @param[in]   child   TRUE in a child process created by fork
+ */
+VOID OpenTraceFile(BOOL child)
+{
+    TraceFile.open(OutputFileName(KnobOutputFile.Value(), child).c_str());
+}
+
 /* ===================================================================== */
 /* Analysis routines                                                     */
 /* ===================================================================== */
  
 VOID BeforeMalloc (CHAR * name, ADDRINT size, THREADID threadid)
 {
+    SELFPROF_CALL_SCOPE(profBefore);
     PIN_GetLock(&lock1, threadid+1);
 		mallocCount++;
     thread_map[threadid] = (UINT64) size;
@@ -65,6 +84,7 @@ VOID BeforeMalloc (CHAR * name, ADDRINT size, THREADID threadid)
 
 VOID AfterMalloc (ADDRINT ret, THREADID threadid)
 {
+    SELFPROF_CALL_SCOPE(profAfter);
     PIN_GetLock(&lock1, threadid+1);
 		if ( ret != 0 ) {
 			totalMemorySize += thread_map[threadid];
@@ -82,6 +102,8 @@ VOID AfterMalloc (ADDRINT ret, THREADID threadid)
    
 VOID Image(IMG img, VOID *v)
 {
+    SELFPROF_INSTRUMENT_SCOPE(profImage);
+
     // Instrument the malloc() function.
 
     //  Find the malloc() function.
@@ -106,6 +128,60 @@ VOID Image(IMG img, VOID *v)
 
 /* ===================================================================== */
 
+/*!
+ * Make the child of a fork count its own calls, in its own trace file.
+ * Only the forking thread exists in the child, so the locks are set up
+ * again in case another thread held one at the time of the fork.
+ */
+VOID AfterForkInChild(THREADID threadid, const CONTEXT *ctxt, VOID *v)
+{
+    PIN_InitLock(&lock1);
+    PIN_InitLock(&lock2);
+
+    mallocCount = 0;
+    totalMemorySize = 0;
+
+    // Keep only the pending malloc of the forking thread.
+    UINT64 size = thread_map[threadid];
+    thread_map.clear();
+    thread_map[threadid] = size;
+
+    // Every line is ended with endl, so no output of the parent is left in
+    // the stream buffer to be written twice.
+    TraceFile.close();
+    OpenTraceFile(TRUE);
+}
+
+/*!
+ * Write the counts of this process to the trace file.
+ */
+VOID PrintCounts()
+{
+    TraceFile <<  "Number of calls made to malloc: " << mallocCount  << endl;
+    TraceFile <<  "Total amount of memory allocated: " << totalMemorySize  << endl;
+}
+
+/*!
+ * Let Pin follow the application into a program it executes (needs the
+ * -follow_execv switch of Pin); the new program gets a copy of this tool,
+ * with a trace file of its own. Fini does not run in a program that execs,
+ * so its counts are written here, and counting starts from zero again in
+ * case the exec fails.
+ */
+BOOL FollowChild(CHILD_PROCESS child, VOID *v)
+{
+    THREADID threadid = PIN_ThreadId();
+
+    PIN_GetLock(&lock1, threadid+1);
+    PrintCounts();
+    mallocCount = 0;
+    totalMemorySize = 0;
+    PIN_ReleaseLock(&lock1);
+
+    TraceFile.flush();
+    return TRUE;
+}
+
 /*!
  * Print out analysis results.
  * This function is called when the application exits.
@@ -116,8 +192,8 @@ VOID Image(IMG img, VOID *v)
 VOID Fini(INT32 code, VOID *v)
 {
 
-		TraceFile <<  "Number of calls made to malloc: " << int(mallocCount)  << endl;
-		TraceFile <<  "Total amount of memory allocated: " << int(totalMemorySize)  << endl;
+    PrintCounts();
+    TraceFile << SelfProfReport();
 
     TraceFile.close();
 }
@@ -150,13 +226,25 @@ int main(int argc, char *argv[])
     }
     
     // Write to a file since cout and cerr maybe closed by the application
-    TraceFile.open(KnobOutputFile.Value().c_str());
+    OpenTraceFile(FALSE);
+
+    SelfProfInit();
+    profBefore = SelfProfKind("BeforeMalloc");
+    profAfter = SelfProfKind("AfterMalloc");
+    profImage = SelfProfCallback("images");
     // TraceFile << hex;
     // TraceFile.setf(ios::showbase);
     
     // Register Image to be called to instrument functions.
     IMG_AddInstrumentFunction(Image, 0);
+    PIN_AddForkFunction(FPOINT_AFTER_IN_CHILD, AfterForkInChild, 0);
+    PIN_AddFollowChildProcessFunction(FollowChild, 0);
     PIN_AddFiniFunction(Fini, 0);
+    if (!AttachInit(Fini))
+    {
+        cerr << "Cannot start the detach timer thread." << endl;
+        return 1;
+    }
 
     // Never returns
     PIN_StartProgram();
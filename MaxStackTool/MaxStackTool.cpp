@@ -5,6 +5,9 @@
 #include <cctype>
 #include <map>
 #include "pin.H"
+#include "ScopeFilter.h"
+#include "SelfProf.h"
+#include "Attach.h"
 using std::cerr;
 using std::string;
 using std::endl;
@@ -40,10 +43,19 @@ struct TINFO
     std::ostringstream _os; // Used to format messages.
 };
 
-typedef std::map<THREADID, TINFO *> TINFO_MAP;
+// Every thread the application ever had. Pin hands the id of a thread that
+// exited to the next one it starts, so one id may have several entries.
+// Threads start concurrently, so updates hold ThreadInfosLock.
+//
+typedef std::multimap<THREADID, TINFO *> TINFO_MAP;
 static TINFO_MAP ThreadInfos;
+static PIN_LOCK ThreadInfosLock;
 
 static std::ostream *Output = &std::cerr;
+
+// Kinds of the -selfprof report.
+//
+static UINT32 ProfStackChange, ProfBreakpoint, ProfIns;
 // static bool EnableInstrumentation = false;
 // static bool BreakOnNewMax = false;
 // static ADDRINT BreakOnSize = 0;
@@ -59,8 +71,11 @@ INT32 Usage()
 
 static VOID OnThreadStart(THREADID tid, CONTEXT *ctxt, INT32, VOID *)
 {
-    TINFO *tinfo = new TINFO(PIN_GetContextReg(ctxt, REG_STACK_PTR));
+    // A thread that was running when Pin attached is already into its stack.
+    TINFO *tinfo = new TINFO(AttachStackBase(PIN_GetContextReg(ctxt, REG_STACK_PTR)));
+    PIN_GetLock(&ThreadInfosLock, tid+1);
     ThreadInfos.insert(std::make_pair(tid, tinfo));
+    PIN_ReleaseLock(&ThreadInfosLock);
     PIN_SetContextReg(ctxt, RegTinfo, reinterpret_cast<ADDRINT>(tinfo));
     // cerr << "start Thread ID:" << tid << "Max Stack Used:" << tinfo->_max << endl;
 }
@@ -111,9 +126,18 @@ static ADDRINT OnStackChangeIf(ADDRINT sp, ADDRINT addrInfo)
 }
 
 
+// OnStackChangeIf() under -selfprof. The plain one stays inlinable.
+//
+static ADDRINT OnStackChangeIfProf(ADDRINT sp, ADDRINT addrInfo)
+{
+    SELFPROF_CALL_SCOPE(ProfStackChange);
+    return OnStackChangeIf(sp, addrInfo);
+}
+
 
 static VOID DoBreakpoint(const CONTEXT *ctxt, THREADID tid)
 {
+    SELFPROF_CALL_SCOPE(ProfBreakpoint);
     TINFO *tinfo = reinterpret_cast<TINFO *>(PIN_GetContextReg(ctxt, RegTinfo));
 
     // Keep track of the maximum reported stack usage for "stackbreak newmax".
@@ -136,7 +160,11 @@ static VOID DoBreakpoint(const CONTEXT *ctxt, THREADID tid)
 
 static VOID Instruction(INS ins, VOID *)
 {
-    
+    SELFPROF_INSTRUMENT_SCOPE(ProfIns);
+
+    // Stack changes outside -include_img, -exclude_img and -rtn are not followed.
+    if (!ScopeIns(ins)) return;
+
     if (INS_RegWContain(ins, REG_STACK_PTR))
     {   
         if (INS_IsSysenter(ins)) return; // no need to instrument system calls
@@ -153,7 +181,8 @@ static VOID Instruction(INS ins, VOID *)
                 return;
             }
         }
-        INS_InsertIfCall(ins, where, (AFUNPTR)OnStackChangeIf, IARG_REG_VALUE, REG_STACK_PTR, IARG_REG_VALUE, RegTinfo, IARG_END);
+        AFUNPTR onStackChange = SelfProfOn() ? (AFUNPTR)OnStackChangeIfProf : (AFUNPTR)OnStackChangeIf;
+        INS_InsertIfCall(ins, where, onStackChange, IARG_REG_VALUE, REG_STACK_PTR, IARG_REG_VALUE, RegTinfo, IARG_END);
         
         // We use IARG_CONST_CONTEXT here instead of IARG_CONTEXT because it is faster.
         //
@@ -169,12 +198,15 @@ VOID Fini(INT32 code, VOID *v)
 {
   // Write to a file since cout and cerr maybe closed by the application
 
-  std::map<THREADID, TINFO *>::iterator it;
+  TINFO_MAP::iterator it;
   
   for ( it = ThreadInfos.begin(); it != ThreadInfos.end(); it++ ) {
     *Output << "Thread ID:" << it->first << " | Max Stack Used:" << it->second->_max << endl;  
 
   }
+  *Output << ScopeReport();
+  *Output << SelfProfReport();
+  Output->flush();
 
 
 }
@@ -186,6 +218,13 @@ int main(int argc, char *argv[])
 
     if (PIN_Init(argc, argv)) return Usage();
 
+    PIN_InitLock(&ThreadInfosLock);
+    ScopeInit();
+    SelfProfInit();
+    ProfStackChange = SelfProfKind("OnStackChangeIf");
+    ProfBreakpoint = SelfProfKind("DoBreakpoint");
+    ProfIns = SelfProfCallback("instructions");
+
     if (!KnobOut.Value().empty())
         Output = new std::ofstream(KnobOut.Value().c_str());
 
@@ -211,6 +250,11 @@ int main(int argc, char *argv[])
     INS_AddInstrumentFunction(Instruction, 0);
     // Register Fini to be called when the application exits
     PIN_AddFiniFunction(Fini, 0);
+    if (!AttachInit(Fini))
+    {
+        std::cerr << "Cannot start the detach timer thread.\n";
+        return 1;
+    }
 
     PIN_StartProgram();
     return 0;
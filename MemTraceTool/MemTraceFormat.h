@@ -0,0 +1,224 @@
+/*! @file
+ *  Trace format shared by MemTraceTool and memtrace-read, and a reader that
+ *  simulators can include to walk a trace.
+ *
+ *  A trace is a MEMTRACE_FILE_HEADER followed by chunks. A chunk holds the
+ *  memory references of one thread, in program order, as a
+ *  MEMTRACE_CHUNK_HEADER followed by the encoded references. Chunks of
+ *  different threads are interleaved in the order their buffers filled up.
+ *
+ *  A reference is encoded against the previous one of its chunk:
+ *
+ *      varint  zigzag(ip - previous ip) << 4 | size code << 1 | write
+ *      varint  size, only for size code MEMTRACE_SIZE_OTHER
+ *      varint  zigzag(address - previous address)
+ *
+ *  where the size code is log2 of sizes 1 to 64, and a varint is 7 bits a
+ *  byte, least significant first, with the top bit set on all bytes but the
+ *  last. Code runs forward in small steps and data is mostly touched near
+ *  the previous reference, so a reference takes 3 to 5 bytes instead of 24.
+ *  Every chunk starts from 0, so that it can be decoded on its own.
+ *
+ *  Instruction pointers are assumed to fit in 59 bits, as user space
+ *  addresses do.
+ */
+
+#ifndef MEMTRACE_FORMAT_H
+#define MEMTRACE_FORMAT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define MEMTRACE_MAGIC          "MEMTRC1"
+#define MEMTRACE_ABI_I386       32
+#define MEMTRACE_ABI_X86_64     64
+
+// MEMTRACE_FILE_HEADER::flags
+#define MEMTRACE_TRUNCATED      0x1     // references were dropped at -max_mb
+
+#define MEMTRACE_SIZE_OTHER     7       // size code of sizes that follow as a varint
+#define MEMTRACE_MAX_ENCODED    25      // longest encoding of one reference
+
+struct MEMTRACE_FILE_HEADER
+{
+    char     magic[8];      // MEMTRACE_MAGIC
+    uint32_t abi;           // MEMTRACE_ABI_I386 or MEMTRACE_ABI_X86_64
+    uint32_t flags;         // MEMTRACE_TRUNCATED
+    uint64_t references;    // references in the file, 0 if the tool did not finish
+    uint64_t chunks;        // chunks in the file, 0 if the tool did not finish
+};
+
+struct MEMTRACE_CHUNK_HEADER
+{
+    uint32_t tid;           // OS thread id
+    uint32_t bytes;         // bytes of encoded references following
+    uint64_t references;    // references in the chunk
+};
+
+// A decoded reference.
+struct MEMTRACE_REF
+{
+    uint64_t ip;            // instruction that made it
+    uint64_t address;       // first byte referenced
+    uint32_t size;          // bytes referenced
+    uint32_t tid;           // OS thread id
+    bool     write;         // a store, else a load
+};
+
+// What the encoding of a chunk is relative to.
+struct MEMTRACE_STATE
+{
+    uint64_t ip;
+    uint64_t address;
+
+    MEMTRACE_STATE() : ip(0), address(0) {}
+};
+
+/*!
+ * Append a varint.
+ * @return the byte after it
+ */
+inline uint8_t * MemtracePutVarint(uint8_t * p, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        *p++ = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+    return p;
+}
+
+/*!
+ * Read a varint.
+ * @return the byte after it
+ */
+inline const uint8_t * MemtraceGetVarint(const uint8_t * p, uint64_t & value)
+{
+    uint64_t byte = *p++;
+    value = byte & 0x7f;
+    for (unsigned shift = 7; byte & 0x80; shift += 7)
+    {
+        byte = *p++;
+        value |= (byte & 0x7f) << shift;
+    }
+    return p;
+}
+
+inline uint64_t MemtraceZigzag(int64_t v)      { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+inline int64_t  MemtraceUnzigzag(uint64_t v)   { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+/*!
+ * Append the encoding of a reference, at most MEMTRACE_MAX_ENCODED bytes.
+ * @return the byte after it
+ */
+inline uint8_t * MemtraceEncode(uint8_t * p, MEMTRACE_STATE & state, uint64_t ip, uint64_t address,
+                                uint32_t size, bool write)
+{
+    uint32_t code = MEMTRACE_SIZE_OTHER;
+    if (size != 0 && (size & (size - 1)) == 0 && size <= 64)
+    {
+        for (code = 0; (1u << code) != size; code++) {}
+    }
+
+    p = MemtracePutVarint(p, MemtraceZigzag((int64_t)(ip - state.ip)) << 4 | code << 1 | (write ? 1 : 0));
+    if (code == MEMTRACE_SIZE_OTHER) { p = MemtracePutVarint(p, size); }
+    p = MemtracePutVarint(p, MemtraceZigzag((int64_t)(address - state.address)));
+
+    state.ip = ip;
+    state.address = address;
+    return p;
+}
+
+/*!
+ * Decode a reference; ref.tid is left alone.
+ * @return the byte after it
+ */
+inline const uint8_t * MemtraceDecode(const uint8_t * p, MEMTRACE_STATE & state, MEMTRACE_REF & ref)
+{
+    uint64_t head, value;
+
+    p = MemtraceGetVarint(p, head);
+    uint32_t code = (head >> 1) & 7;
+    ref.write = (head & 1) != 0;
+    ref.ip = state.ip += MemtraceUnzigzag(head >> 4);
+    if (code == MEMTRACE_SIZE_OTHER)
+    {
+        p = MemtraceGetVarint(p, value);
+        ref.size = (uint32_t)value;
+    }
+    else
+    {
+        ref.size = 1u << code;
+    }
+    p = MemtraceGetVarint(p, value);
+    ref.address = state.address += MemtraceUnzigzag(value);
+    return p;
+}
+
+/*!
+ * Walks the references of a trace file, one chunk in memory at a time.
+ *
+ *      MEMTRACE_READER reader;
+ *      MEMTRACE_REF ref;
+ *      if (!reader.Open(path)) ...
+ *      while (reader.Next(ref)) simulate(ref);
+ */
+class MEMTRACE_READER
+{
+  public:
+    MEMTRACE_READER() : _file(0), _next(0), _left(0) {}
+    ~MEMTRACE_READER() { if (_file != 0) { fclose(_file); } }
+
+    /*!
+     * @return FALSE if the file cannot be read or is not a trace
+     */
+    bool Open(const char * path)
+    {
+        _file = fopen(path, "rb");
+        if (_file == 0) { return false; }
+        setvbuf(_file, 0, _IOFBF, 1 << 20);
+        return fread(&_header, sizeof(_header), 1, _file) == 1 &&
+               memcmp(_header.magic, MEMTRACE_MAGIC, sizeof(MEMTRACE_MAGIC)) == 0;
+    }
+
+    const MEMTRACE_FILE_HEADER & Header() const { return _header; }
+
+    /*!
+     * @return FALSE at the end of the file, or at a chunk cut short
+     */
+    bool Next(MEMTRACE_REF & ref)
+    {
+        while (_left == 0)
+        {
+            MEMTRACE_CHUNK_HEADER chunk;
+            if (fread(&chunk, sizeof(chunk), 1, _file) != 1) { return false; }
+
+            // A varint is read a byte too far at worst when the chunk is cut.
+            _chunk.resize(chunk.bytes + MEMTRACE_MAX_ENCODED);
+            if (fread(&_chunk[0], 1, chunk.bytes, _file) != chunk.bytes) { return false; }
+            _next = &_chunk[0];
+            _left = chunk.references;
+            _tid = chunk.tid;
+            _state = MEMTRACE_STATE();
+        }
+
+        _next = MemtraceDecode(_next, _state, ref);
+        ref.tid = _tid;
+        _left--;
+        return true;
+    }
+
+  private:
+    FILE *                  _file;
+    MEMTRACE_FILE_HEADER    _header;
+    std::vector<uint8_t>    _chunk;     // encoded references of the current chunk
+    const uint8_t *         _next;
+    uint64_t                _left;      // references left in the chunk
+    uint32_t                _tid;
+    MEMTRACE_STATE          _state;
+};
+
+#endif // MEMTRACE_FORMAT_H
@@ -0,0 +1,493 @@
+/*! @file
+ *  Record every load and store of an application, with its address, size
+ *  and instruction pointer, into a compressed trace for offline cache and
+ *  prefetch studies. memtrace-read walks the trace.
+ *
+ *  The references go through Pin's trace buffers: the code Pin inlines
+ *  stores each one into a per-thread buffer, with no analysis call. When a
+ *  buffer is full the thread encodes it (MemTraceFormat.h) into a chunk and
+ *  queues the chunk, and an internal writer thread streams the queue to
+ *  the file. Threads encode in parallel; only the queue takes a lock. A
+ *  thread waits when the queue holds more than -queue_mb, so that a slow
+ *  disk bounds the memory, and -max_mb stops the trace at a given size.
+ *  The child of a fork writes a trace file of its own.
+ */
+
+#include "pin.H"
+#include <iostream>
+#include <fstream>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "MemTraceFormat.h"
+#include "ScopeFilter.h"
+#include "SelfProf.h"
+#include "Attach.h"
+#include "OutputFile.h"
+
+using std::cerr;
+using std::string;
+using std::endl;
+/* ================================================================== */
+// Global variables
+/* ================================================================== */
+
+#if defined(TARGET_IA32E)
+#define MEMTRACE_ABI  MEMTRACE_ABI_X86_64
+#else
+#define MEMTRACE_ABI  MEMTRACE_ABI_I386
+#endif
+
+// One reference as Pin stores it in the trace buffer.
+struct MEMREF
+{
+    ADDRINT ip;
+    ADDRINT address;
+    UINT32  size;
+    UINT32  write;
+};
+
+// An encoded chunk on its way to the trace file. Full chunks are queued for
+// the writer thread, written ones go back to the free list.
+struct CHUNK
+{
+    UINT8 * data;       // MEMTRACE_CHUNK_HEADER and the encoded references
+    size_t  used;       // bytes of data in use
+    CHUNK * next;       // next chunk in the queue or free list
+};
+
+static BUFFER_ID bufferId;
+static size_t chunkSize;                // room for a full buffer, encoded at worst
+
+// The writer thread and the chunks it drains.
+static CHUNK * full_head = 0;
+static CHUNK ** full_tail = &full_head;
+static CHUNK * free_list = 0;
+static volatile UINT64 queued = 0;      // bytes in the queue
+static PIN_LOCK queue_lock;
+static PIN_SEMAPHORE queue_sem;
+static PIN_THREAD_UID writer_uid;
+static volatile BOOL writer_exit = FALSE;
+
+// What went to the file, only touched by whoever drains the queue.
+static UINT64 references = 0, chunks = 0, written = sizeof(MEMTRACE_FILE_HEADER);
+static UINT64 dropped = 0;
+static volatile BOOL truncated = FALSE;
+
+// Kinds of the -selfprof report.
+static UINT32 profEncode, profDrain, profTrace;
+
+FILE * trace = 0;
+string traceName;
+FILE * out = stderr;
+
+/* ===================================================================== */
+// Command line switches
+/* ===================================================================== */
+KNOB<string> KnobOutputFile(KNOB_MODE_WRITEONCE,  "pintool",
+    "o", "", "specify file name for the MemTraceTool report, %p is replaced by the process id; "
+    "forked children without %p write to <file>.<pid>");
+
+KNOB<string> KnobTraceFile(KNOB_MODE_WRITEONCE,  "pintool",
+    "trace", "memtrace.out", "file the compressed memory reference trace is written to, %p is replaced by "
+    "the process id; forked children without %p write to <file>.<pid>");
+
+KNOB<UINT32> KnobBufferPages(KNOB_MODE_WRITEONCE,  "pintool",
+    "buf_pages", "256", "pages of the per-thread trace buffers");
+
+KNOB<UINT32> KnobQueueMB(KNOB_MODE_WRITEONCE,  "pintool",
+    "queue_mb", "64", "MB of encoded chunks waiting for the writer before the threads wait");
+
+KNOB<UINT64> KnobMaxMB(KNOB_MODE_WRITEONCE,  "pintool",
+    "max_mb", "0", "stop the trace when the file reaches this many MB, 0 for no limit");
+
+/* ===================================================================== */
+// Utilities
+/* ===================================================================== */
+
+/*!
+ *  Print out help message.
+ */
+INT32 Usage()
+{
+    cerr << "This tool records the address, size and instruction pointer of every" << endl <<
+            "load and store of the application into a compressed trace." << endl << endl;
+
+    cerr << KNOB_BASE::StringKnobSummary() << endl;
+
+    return -1;
+}
+
+/*!
+ * Take an empty chunk from the free list, or allocate a new one.
+ */
+static CHUNK * GetChunk(THREADID threadid)
+{
+    PIN_GetLock(&queue_lock, threadid+1);
+    CHUNK * chunk = free_list;
+    if (chunk != 0) { free_list = chunk->next; }
+    PIN_ReleaseLock(&queue_lock);
+
+    if (chunk == 0)
+    {
+        chunk = new CHUNK();
+        chunk->data = new UINT8[chunkSize];
+    }
+    chunk->used = 0;
+    chunk->next = 0;
+    return chunk;
+}
+
+/*!
+ * Hand an encoded chunk to the writer thread.
+ */
+static VOID QueueChunk(CHUNK * chunk, THREADID threadid)
+{
+    PIN_GetLock(&queue_lock, threadid+1);
+    *full_tail = chunk;
+    full_tail = &chunk->next;
+    queued += chunk->used;
+    PIN_ReleaseLock(&queue_lock);
+
+    PIN_SemaphoreSet(&queue_sem);
+}
+
+/*!
+ * Write all queued chunks to the trace file, in queue order, and put them
+ * back on the free list. Chunks past -max_mb are dropped.
+ */
+static VOID DrainQueue()
+{
+    SELFPROF_CALL_SCOPE(profDrain);
+    PIN_GetLock(&queue_lock, PIN_ThreadId()+1);
+    CHUNK * chunk = full_head;
+    full_head = 0;
+    full_tail = &full_head;
+    PIN_ReleaseLock(&queue_lock);
+
+    while (chunk != 0)
+    {
+        CHUNK * next = chunk->next;
+        const MEMTRACE_CHUNK_HEADER * header = reinterpret_cast<MEMTRACE_CHUNK_HEADER *>(chunk->data);
+
+        if (KnobMaxMB != 0 && written + chunk->used > KnobMaxMB * 1024 * 1024) { truncated = TRUE; }
+        if (truncated)
+        {
+            dropped += header->references;
+        }
+        else
+        {
+            fwrite(chunk->data, 1, chunk->used, trace);
+            written += chunk->used;
+            references += header->references;
+            chunks++;
+        }
+
+        PIN_GetLock(&queue_lock, PIN_ThreadId()+1);
+        queued -= chunk->used;
+        chunk->next = free_list;
+        free_list = chunk;
+        PIN_ReleaseLock(&queue_lock);
+
+        chunk = next;
+    }
+}
+
+/*!
+ * Body of the internal writer thread: drain the queue whenever a chunk
+ * is handed over, until the application starts to exit.
+ */
+static VOID WriterThread(VOID * arg)
+{
+    while (!writer_exit)
+    {
+        PIN_SemaphoreTimedWait(&queue_sem, 100);
+        PIN_SemaphoreClear(&queue_sem);
+        DrainQueue();
+    }
+}
+
+/*!
+ * Write the file header; at the end, with the totals.
+ */
+static VOID WriteHeader()
+{
+    MEMTRACE_FILE_HEADER header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MEMTRACE_MAGIC, sizeof(MEMTRACE_MAGIC));
+    header.abi = MEMTRACE_ABI;
+    header.flags = truncated ? MEMTRACE_TRUNCATED : 0;
+    header.references = references;
+    header.chunks = chunks;
+
+    fseek(trace, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, trace);
+}
+
+/* ===================================================================== */
+// Analysis routines
+/* ===================================================================== */
+
+/*!
+ * A trace buffer is full, or its thread exits: encode the references into
+ * a chunk and queue it, and give Pin the buffer back to fill again.
+ * @param[in]   id          buffer of the thread
+ * @param[in]   threadid    Pin id of the thread
+ * @param[in]   buf         the references
+ * @param[in]   count       number of references in the buffer
+ */
+VOID * BufferFull(BUFFER_ID id, THREADID threadid, const CONTEXT * ctxt, VOID * buf, UINT64 count, VOID * v)
+{
+    SELFPROF_CALL_SCOPE(profEncode);
+
+    if (truncated) { return buf; }
+
+    // Let the writer catch up when the disk is slower than the threads.
+    while (queued > (UINT64)KnobQueueMB * 1024 * 1024 && !writer_exit) { PIN_Sleep(1); }
+
+    CHUNK * chunk = GetChunk(threadid);
+    MEMTRACE_CHUNK_HEADER * header = reinterpret_cast<MEMTRACE_CHUNK_HEADER *>(chunk->data);
+    UINT8 * p = chunk->data + sizeof(MEMTRACE_CHUNK_HEADER);
+    MEMTRACE_STATE state;
+
+    const MEMREF * ref = static_cast<const MEMREF *>(buf);
+    for (UINT64 i = 0; i < count; i++, ref++)
+    {
+        p = MemtraceEncode(p, state, ref->ip, ref->address, ref->size, ref->write != 0);
+    }
+
+    header->tid = PIN_GetTid();
+    header->references = count;
+    header->bytes = p - chunk->data - sizeof(MEMTRACE_CHUNK_HEADER);
+    chunk->used = p - chunk->data;
+    QueueChunk(chunk, threadid);
+    return buf;
+}
+
+/* ===================================================================== */
+// Instrumentation callbacks
+/* ===================================================================== */
+
+/*!
+ * Store every memory operand of every instruction into the trace buffer.
+ * @param[in]   trace    trace to be instrumented
+ * @param[in]   v        value specified by the tool in the TRACE_AddInstrumentFunction
+ *                       function call
+ */
+VOID Trace(TRACE trace, VOID *v)
+{
+    SELFPROF_INSTRUMENT_SCOPE(profTrace);
+
+    // Code outside -include_img, -exclude_img and -rtn runs without analysis calls.
+    if (!ScopeTrace(trace)) { return; }
+
+    for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl))
+    {
+        for (INS ins = BBL_InsHead(bbl); INS_Valid(ins); ins = INS_Next(ins))
+        {
+            // Gathers and scatters have no single address per operand.
+            if (INS_HasScatteredMemoryAccess(ins)) { continue; }
+
+            for (UINT32 op = 0; op < INS_MemoryOperandCount(ins); op++)
+            {
+                UINT32 size = INS_MemoryOperandSize(ins, op);
+
+                // An operand both read and written is one load and one store.
+                for (UINT32 write = 0; write < 2; write++)
+                {
+                    if (write ? !INS_MemoryOperandIsWritten(ins, op) : !INS_MemoryOperandIsRead(ins, op))
+                    {
+                        continue;
+                    }
+                    INS_InsertFillBufferPredicated(ins, IPOINT_BEFORE, bufferId,
+                                                   IARG_INST_PTR, offsetof(MEMREF, ip),
+                                                   IARG_MEMORYOP_EA, op, offsetof(MEMREF, address),
+                                                   IARG_UINT32, size, offsetof(MEMREF, size),
+                                                   IARG_UINT32, write, offsetof(MEMREF, write),
+                                                   IARG_END);
+                }
+            }
+        }
+    }
+}
+
+/*!
+ * Set up the child of a fork as a process of its own. Only the thread that
+ * called fork exists in the child: the writer thread is gone, and so is
+ * whoever held queue_lock, so the lock is initialized again, the chunks
+ * queued for the parent's file are dropped and a new writer is started on
+ * a trace file of the child's own. The references the forking thread had
+ * not flushed yet from its trace buffer are written by both processes.
+ * @param[in]   threadid    Pin id of the thread that called fork
+ */
+VOID AfterForkInChild(THREADID threadid, const CONTEXT *ctxt, VOID *v)
+{
+    PIN_InitLock(&queue_lock);
+    PIN_SemaphoreInit(&queue_sem);
+
+    while (full_head != 0)
+    {
+        CHUNK * chunk = full_head;
+        full_head = chunk->next;
+        chunk->next = free_list;
+        free_list = chunk;
+    }
+    full_tail = &full_head;
+    queued = 0;
+
+    references = chunks = dropped = 0;
+    written = sizeof(MEMTRACE_FILE_HEADER);
+    truncated = FALSE;
+
+    // Close the parent's files without flushing them: whatever sits in
+    // their stdio buffers belongs to the parent, which writes it itself.
+    close(fileno(trace));
+    traceName = OutputFileName(KnobTraceFile.Value(), TRUE);
+    trace = fopen(traceName.c_str(), "wb");
+    if (trace == 0)
+    {
+        cerr << "memtrace: cannot open " << traceName << endl;
+        PIN_ExitProcess(1);
+    }
+    setvbuf(trace, 0, _IOFBF, 1 << 20);
+    WriteHeader();
+
+    if (out != stderr)
+    {
+        close(fileno(out));
+        out = fopen(OutputFileName(KnobOutputFile.Value(), TRUE).c_str(), "w");
+        if (out == 0) { out = stderr; }
+    }
+
+    writer_exit = FALSE;
+    if (PIN_SpawnInternalThread(WriterThread, 0, 0, &writer_uid) == INVALID_THREADID)
+    {
+        cerr << "memtrace: cannot start the writer thread in process " << PIN_GetPid() << endl;
+        PIN_ExitProcess(1);
+    }
+}
+
+/*!
+ * Ask the writer thread to finish before Pin waits for internal threads.
+ * @param[in]   v               value specified by the tool in the
+ *                              PIN_AddPrepareForFiniFunction function call
+ */
+VOID PrepareForFini(VOID *v)
+{
+    writer_exit = TRUE;
+    PIN_SemaphoreSet(&queue_sem);
+}
+
+/*!
+ * Write what is left in the queue and the totals, and print the report.
+ * This function is called when the application exits.
+ * @param[in]   code            exit code of the application
+ * @param[in]   v               value specified by the tool in the
+ *                              PIN_AddFiniFunction function call
+ */
+VOID Fini(INT32 code, VOID *v)
+{
+    // At -detach_after or -detach_file the writer thread is still running.
+    PrepareForFini(v);
+    PIN_WaitForThreadTermination(writer_uid, PIN_INFINITE_TIMEOUT, 0);
+    DrainQueue();
+    WriteHeader();
+    fclose(trace);
+
+    fprintf(out, "===============================================\n");
+    fprintf(out, "Memory references recorded: %llu in %llu chunks\n",
+            (unsigned long long)references, (unsigned long long)chunks);
+    fprintf(out, "Trace file: %s, %llu bytes, %.2f bytes per reference\n", traceName.c_str(),
+            (unsigned long long)written, references ? (double)written / references : 0.0);
+    if (truncated)
+    {
+        fprintf(out, "Trace stopped at -max_mb: %llu references dropped\n", (unsigned long long)dropped);
+    }
+    fputs(ScopeReport().c_str(), out);
+    fputs(SelfProfReport().c_str(), out);
+    fflush(out);
+}
+
+/*!
+ * The main procedure of the tool.
+ * This function is called when the application image is loaded but not yet started.
+ * @param[in]   argc            total number of elements in the argv array
+ * @param[in]   argv            array of command line arguments,
+ *                              including pin -t <toolname> -- ...
+ */
+int main(int argc, char *argv[])
+{
+    // -rtn selects routines by their symbols.
+    PIN_InitSymbols();
+
+    // Initialize PIN library. Print help message if -h(elp) is specified
+    // in the command line or the command line is invalid
+    if( PIN_Init(argc,argv) )
+    {
+        return Usage();
+    }
+
+    string fileName = KnobOutputFile.Value();
+
+    if (!fileName.empty())
+    {
+        out = fopen(OutputFileName(fileName, FALSE).c_str(), "w");
+        if (out == 0)
+        {
+            cerr << "memtrace: cannot open " << fileName << endl;
+            return 1;
+        }
+    }
+
+    traceName = OutputFileName(KnobTraceFile.Value(), FALSE);
+    trace = fopen(traceName.c_str(), "wb");
+    if (trace == 0)
+    {
+        cerr << "memtrace: cannot open " << KnobTraceFile.Value() << endl;
+        return 1;
+    }
+    setvbuf(trace, 0, _IOFBF, 1 << 20);
+    WriteHeader();
+
+    bufferId = PIN_DefineTraceBuffer(sizeof(MEMREF), KnobBufferPages, BufferFull, 0);
+    if (bufferId == BUFFER_ID_INVALID)
+    {
+        cerr << "Cannot allocate the trace buffers." << endl;
+        return 1;
+    }
+    chunkSize = sizeof(MEMTRACE_CHUNK_HEADER) + (KnobBufferPages * 4096 / sizeof(MEMREF)) * MEMTRACE_MAX_ENCODED;
+
+    PIN_InitLock(&queue_lock);
+    PIN_SemaphoreInit(&queue_sem);
+    ScopeInit();
+    SelfProfInit();
+    profEncode = SelfProfKind("BufferFull (encode)");
+    profDrain = SelfProfKind("DrainQueue (write)");
+    profTrace = SelfProfCallback("traces");
+    TRACE_AddInstrumentFunction(Trace, 0);
+
+    if (PIN_SpawnInternalThread(WriterThread, 0, 0, &writer_uid) == INVALID_THREADID)
+    {
+        cerr << "Cannot start the writer thread." << endl;
+        return 1;
+    }
+    PIN_AddPrepareForFiniFunction(PrepareForFini, 0);
+    PIN_AddForkFunction(FPOINT_AFTER_IN_CHILD, AfterForkInChild, 0);
+
+    // Register function to be called when the application exits
+    PIN_AddFiniFunction(Fini, 0);
+    if (!AttachInit(Fini))
+    {
+        cerr << "Cannot start the detach timer thread." << endl;
+        return 1;
+    }
+
+    // Start the program, never returns
+    PIN_StartProgram();
+
+    return 0;
+}
+
+/* ===================================================================== */
+/* eof */
+/* ===================================================================== */
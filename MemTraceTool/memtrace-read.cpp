@@ -0,0 +1,128 @@
+/*! @file
+ *  Print a memory reference trace written by MemTraceTool, or sum it up.
+ *
+ *  Usage: memtrace-read [-csv | -stats] <trace file>
+ *
+ *  By default every reference is printed as "tid ip R|W size address".
+ *  -csv prints the same as CSV, and -stats only counts the references and
+ *  tells how fast the trace decodes, which bounds how fast a simulator
+ *  driven by MEMTRACE_READER can go.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <map>
+#include "MemTraceFormat.h"
+
+using std::map;
+
+/*!
+ * @return a monotonic time stamp in seconds
+ */
+static double Now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*!
+ * Decode the whole trace and print what it holds.
+ */
+static int PrintStats(MEMTRACE_READER & reader)
+{
+    MEMTRACE_REF ref;
+    uint64_t refs = 0, loads = 0, stores = 0, bytes = 0;
+    uint64_t sizes[8] = { 0 };                  // by size code
+    map<uint32_t, uint64_t> threads;
+
+    double start = Now();
+    while (reader.Next(ref))
+    {
+        refs++;
+        if (ref.write) { stores++; } else { loads++; }
+        bytes += ref.size;
+
+        unsigned code = MEMTRACE_SIZE_OTHER;
+        if (ref.size != 0 && (ref.size & (ref.size - 1)) == 0 && ref.size <= 64)
+        {
+            for (code = 0; (1u << code) != ref.size; code++) {}
+        }
+        sizes[code]++;
+        threads[ref.tid]++;
+    }
+    double seconds = Now() - start;
+
+    const MEMTRACE_FILE_HEADER & header = reader.Header();
+    printf("References: %llu (%llu loads, %llu stores), %llu bytes accessed\n", (unsigned long long)refs,
+           (unsigned long long)loads, (unsigned long long)stores, (unsigned long long)bytes);
+    printf("Sizes:");
+    for (unsigned code = 0; code < MEMTRACE_SIZE_OTHER; code++)
+    {
+        printf(" %u:%llu", 1u << code, (unsigned long long)sizes[code]);
+    }
+    printf(" other:%llu\n", (unsigned long long)sizes[MEMTRACE_SIZE_OTHER]);
+    for (map<uint32_t, uint64_t>::iterator t = threads.begin(); t != threads.end(); ++t)
+    {
+        printf("Thread %u: %llu references\n", t->first, (unsigned long long)t->second);
+    }
+    printf("Decoded in %.3f s, %.1f M references/s\n", seconds, seconds > 0 ? refs / seconds / 1e6 : 0.0);
+
+    if (header.references == 0 && header.chunks == 0)
+    {
+        printf("The tool did not finish the trace; it may be cut short.\n");
+    }
+    else if (header.references != refs)
+    {
+        printf("The header announces %llu references; the trace is damaged.\n",
+               (unsigned long long)header.references);
+        return 1;
+    }
+    if (header.flags & MEMTRACE_TRUNCATED) { printf("The trace was stopped at -max_mb.\n"); }
+    return 0;
+}
+
+int main(int argc, char * argv[])
+{
+    bool csv = false, stats = false;
+    int arg = 1;
+
+    for (; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if (strcmp(argv[arg], "-csv") == 0)        { csv = true; }
+        else if (strcmp(argv[arg], "-stats") == 0) { stats = true; }
+        else                                        { break; }
+    }
+    if (arg != argc - 1)
+    {
+        fprintf(stderr, "usage: %s [-csv | -stats] <trace file>\n", argv[0]);
+        return 2;
+    }
+
+    MEMTRACE_READER reader;
+    if (!reader.Open(argv[arg]))
+    {
+        fprintf(stderr, "%s: cannot read a memory reference trace from %s\n", argv[0], argv[arg]);
+        return 1;
+    }
+
+    if (stats) { return PrintStats(reader); }
+
+    MEMTRACE_REF ref;
+    if (csv) { printf("tid,ip,write,size,address\n"); }
+    while (reader.Next(ref))
+    {
+        if (csv)
+        {
+            printf("%u,0x%llx,%d,%u,0x%llx\n", ref.tid, (unsigned long long)ref.ip, ref.write ? 1 : 0,
+                   ref.size, (unsigned long long)ref.address);
+        }
+        else
+        {
+            printf("%u 0x%llx %c %u 0x%llx\n", ref.tid, (unsigned long long)ref.ip, ref.write ? 'W' : 'R',
+                   ref.size, (unsigned long long)ref.address);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * Multithreaded stress program with deterministic work, for checking the
+ * counts of the tools with many threads. Every thread does the same work:
+ *
+ *   bbl     <work> iterations of a loop that calls no library code
+ *   malloc  <work> calls to malloc(64), each block freed again
+ *   stack   a recursion <work> frames deep
+ *
+ * The main thread starts all threads and leaves with pthread_exit, so that
+ * no join, whose cost depends on timing, adds to what the tools count.
+ *
+ * usage: stress_mt.out <bbl|malloc|stack> <threads> <work>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+static long work;
+static volatile long sink;
+
+void * loop(void * arg) {
+  long x = 0;
+
+  (void)arg;
+  for (long i = 0; i < work; i++) {
+    x = x * 3 + i;
+  }
+  sink = x;
+  return NULL;
+}
+
+void * allocate(void * arg) {
+  (void)arg;
+  for (long i = 0; i < work; i++) {
+    free(malloc(64));
+  }
+  return NULL;
+}
+
+long descend(long depth) {
+  volatile char frame[64];
+
+  frame[0] = (char)depth;
+  if (depth == 0) {
+    return frame[0];
+  }
+  return descend(depth - 1) + frame[0];
+}
+
+void * recurse(void * arg) {
+  (void)arg;
+  sink = descend(work);
+  return NULL;
+}
+
+int main (int argc, char ** argv) {
+
+  if (argc < 4) {
+    fprintf(stderr, "usage: %s <bbl|malloc|stack> <threads> <work>\n", argv[0]);
+    return 1;
+  }
+
+  void * (*body)(void *) = loop;
+  if (strcmp(argv[1], "malloc") == 0) {
+    body = allocate;
+  } else if (strcmp(argv[1], "stack") == 0) {
+    body = recurse;
+  }
+
+  int nthreads = atoi(argv[2]);
+  work = atol(argv[3]);
+
+  for (int i = 0; i < nthreads; i++) {
+    pthread_t t;
+    if (pthread_create(&t, NULL, body, NULL) != 0) {
+      perror("pthread_create");
+      return 1;
+    }
+  }
+  pthread_exit(NULL);
+}
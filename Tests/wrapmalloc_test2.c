@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+void allocate(int count) {
+  for (int i = 0; i < count; i++) {
+    if (malloc(100) == NULL) {
+      perror("malloc");
+      exit(1);
+    }
+  }
+}
+
+
+int main (int argc, char ** argv) {
+
+  if (argc < 3) {
+    return 0;
+  }
+
+  int nworkers = atoi(argv[1]);
+  int count = atoi(argv[2]);
+
+  // The master allocates once, then forks a pool of workers like a
+  // pre-fork server. Each worker allocates count times and exits.
+  allocate(1);
+
+  for (int i=0; i<nworkers; i++) {
+    if (fork() == 0) {
+      allocate(count);
+      exit(0);
+    }
+  }
+
+  for (int i=0; i<nworkers; i++) {
+    wait(NULL);
+  }
+
+  // Finally replace the master by another program.
+  if (argc > 3) {
+    execvp(argv[3], &argv[3]);
+  }
+  return 0;
+}